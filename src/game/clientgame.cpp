@@ -33,6 +33,7 @@
 #include "setup.h"
 #include "util.h"
 
+#include <miniz.h>
 #include <string.h>
 
 
@@ -103,7 +104,7 @@ ClientGame::ClientGame (char* address) {
 
 		throw E_DATA;
 
-	} else if (buffer[2] != 1) {
+	} else if ((buffer[2] < 1) || (buffer[2] > NET_PROTOCOL)) {
 
 		net->close(sock);
 
@@ -113,6 +114,13 @@ ClientGame::ClientGame (char* address) {
 
 	printf("Connected to server (version %d).\n", buffer[2]);
 
+	// Use the server's protocol
+	protocol = buffer[2];
+	memset(sentSnapshot, 0, sizeof(sentSnapshot));
+	memset(recvSnapshots, 0, sizeof(recvSnapshots));
+
+	net->resetStats();
+
 	// Copy game parameters
 	modeType = GameModeType(buffer[3]);
 	difficulty = static_cast<difficultyType>(buffer[4]);
@@ -151,6 +159,9 @@ ClientGame::ClientGame (char* address) {
 
 	levelFile = createString(LEVEL_FILE);
 	file = NULL;
+	download = NULL;
+	File::clearMemoryFile(LEVEL_FILE);
+	levelReady = false;
 
 	ret = setLevel(NULL);
 
@@ -159,6 +170,7 @@ ClientGame::ClientGame (char* address) {
 		net->close(sock);
 
 		if (file) delete file;
+		if (download) delete[] download;
 
 		delete mode;
 
@@ -189,6 +201,7 @@ ClientGame::ClientGame (char* address) {
 			net->close(sock);
 
 			if (file) delete file;
+			if (download) delete[] download;
 
 			delete mode;
 
@@ -201,6 +214,7 @@ ClientGame::ClientGame (char* address) {
 			net->close(sock);
 
 			if (file) delete file;
+			if (download) delete[] download;
 
 			delete mode;
 
@@ -218,6 +232,7 @@ ClientGame::ClientGame (char* address) {
 			net->close(sock);
 
 			if (file) delete file;
+			if (download) delete[] download;
 
 			delete mode;
 
@@ -237,7 +252,12 @@ ClientGame::~ClientGame () {
 
 	net->close(sock);
 
+	net->logStats();
+
 	if (file) delete file;
+	if (download) delete[] download;
+
+	File::clearMemoryFile(LEVEL_FILE);
 
 	delete mode;
 
@@ -259,6 +279,39 @@ int ClientGame::setLevel (char* fileName) {
 
 	video.setPalette(menuPalette);
 
+	if (protocol >= 2) {
+
+		// Wait for the level to be found locally, or to finish arriving
+		while (!levelReady && levelFile) {
+
+			if (loop(NORMAL_LOOP) == E_QUIT) return E_QUIT;
+
+			if (controls.release(C_ESCAPE)) return E_RETURN;
+
+			SDL_Delay(T_MENU_FRAME);
+
+			video.clearScreen(0);
+
+			if (download) {
+
+				fontmn2->showString("downloaded", canvasW >> 2, (canvasH >> 1) - 16);
+				fontmn2->showNumber(downloaded, (canvasW >> 2) + 56, canvasH >> 1);
+				fontmn2->showString("bytes", (canvasW >> 2) + 64, canvasH >> 1);
+
+			} else fontmn2->showStringCentered("WAITING FOR SERVER");
+
+			ret = step(0);
+
+			if (ret < 0) return ret;
+
+		}
+
+		levelReady = false;
+
+		return E_NONE;
+
+	}
+
 	// Wait for level data to start arriving
 	while (!file && levelFile) {
 
@@ -304,6 +357,111 @@ int ClientGame::setLevel (char* fileName) {
 }
 
 
+/**
+ * Look for a copy of the level being received, among the levels already
+ * received and the game's own files, and make it available to load.
+ *
+ * @param fileName The level's file name on the server
+ *
+ * @return Whether or not a copy was found
+ */
+bool ClientGame::findLevel (const char* fileName) {
+
+	std::unordered_map<unsigned int, std::vector<unsigned char>>::iterator it;
+	File* levelCopy;
+	unsigned char* data;
+	bool found;
+
+	it = levelCache.find(levelCRC);
+
+	if ((it != levelCache.end()) && (static_cast<int>(it->second.size()) == levelSize)) {
+
+		File::setMemoryFile(LEVEL_FILE, it->second.data(), levelSize);
+
+		return true;
+
+	}
+
+	if (!fileName[0]) return false;
+
+	try {
+
+		levelCopy = new File(fileName, PATH_TYPE_GAME);
+
+	} catch (int e) {
+
+		return false;
+
+	}
+
+	found = false;
+
+	if (levelCopy->getSize() == levelSize) {
+
+		data = levelCopy->loadBlock(levelSize);
+
+		// The server's copy has been modified in the same way
+		if (levelType == LT_JJ1) fixExtension(data, levelSize, fileName);
+
+		if (mz_crc32(MZ_CRC32_INIT, data, levelSize) == levelCRC) {
+
+			File::setMemoryFile(LEVEL_FILE, data, levelSize);
+			levelCache[levelCRC].assign(data, data + levelSize);
+
+			found = true;
+
+		}
+
+		delete[] data;
+
+	}
+
+	delete levelCopy;
+
+	return found;
+
+}
+
+
+/**
+ * Decompress and check the level that has been received, and make it available
+ * to load.
+ *
+ * @return Error code
+ */
+int ClientGame::loadDownload () {
+
+	mz_ulong size;
+	int ret;
+
+	std::vector<unsigned char>& level = levelCache[levelCRC];
+
+	level.resize(levelSize);
+	size = levelSize;
+
+	ret = mz_uncompress(level.data(), &size, download, downloadSize);
+
+	delete[] download;
+	download = NULL;
+
+	if ((ret != MZ_OK) || (static_cast<int>(size) != levelSize) ||
+		(mz_crc32(MZ_CRC32_INIT, level.data(), levelSize) != levelCRC)) {
+
+		levelCache.erase(levelCRC);
+
+		return E_DATA;
+
+	}
+
+	File::setMemoryFile(LEVEL_FILE, level.data(), levelSize);
+
+	levelReady = true;
+
+	return E_NONE;
+
+}
+
+
 /**
  * Send data to server
  *
@@ -311,7 +469,30 @@ int ClientGame::setLevel (char* fileName) {
  */
 void ClientGame::send (unsigned char* buffer) {
 
-	net->send(sock, buffer);
+	if (protocol >= 2) outgoing.insert(outgoing.end(), buffer, buffer + buffer[0]);
+	else net->send(sock, buffer);
+
+}
+
+
+/**
+ * Send the data waiting for the server, as much as the connection will take.
+ *
+ * @return False if the server has stopped reading
+ */
+bool ClientGame::flush () {
+
+	int length;
+
+	if (outgoing.empty()) return true;
+
+	if (outgoing.size() > MAX_OUTGOING) return false;
+
+	length = net->send(sock, outgoing.data(), outgoing.size());
+
+	if (length > 0) outgoing.erase(outgoing.begin(), outgoing.begin() + length);
+
+	return true;
 
 }
 
@@ -325,39 +506,105 @@ void ClientGame::send (unsigned char* buffer) {
  */
 int ClientGame::step (unsigned int ticks) {
 
-	int length;
+	unsigned char sendBuffer[BUFFER_LENGTH];
+	int length, ret;
+	bool more;
 
-	// Receive data from server
+	// While a level is downloading, take everything that has arrived
+	do {
 
-	if (received == 0) {
+		// Receive data from server
 
-		// Not currently receiving a message
-		// See if there is a new message to receive
+		ret = incoming.receive(sock);
 
-		length = net->recv(sock, recvBuffer, 1);
+		if (ret < 0) {
 
-		if (length > 0) received++;
+			if (file) delete file;
+			file = NULL;
 
-	}
+			return E_N_DISCONNECT;
 
-	if (received > 0) {
+		}
 
-		// Currently receiving a message
-		// See if there is any more data
+		// Handle whole messages. Snapshots of several players, and pieces of a
+		// level, arrive together, so handle those in one go, but leave anything
+		// else for the next step.
+		while (incoming.getMessage(recvBuffer)) {
 
-		length = net->recv(sock, recvBuffer + received,
-			recvBuffer[0] - received);
+			more = false;
 
-		if (length > 0) received += length;
+			switch (recvBuffer[1] & MCMASK) {
 
+				case MC_GAME:
 
-		// See if the whole message has arrived
+					if (recvBuffer[1] == MT_G_LINFO) {
 
-		if (received >= recvBuffer[0]) {
+						levelSize = (recvBuffer[2] << 24) + (recvBuffer[3] << 16) + (recvBuffer[4] << 8) + recvBuffer[5];
+						downloadSize = (recvBuffer[6] << 24) + (recvBuffer[7] << 16) + (recvBuffer[8] << 8) + recvBuffer[9];
+						levelCRC = (recvBuffer[10] << 24) + (recvBuffer[11] << 16) + (recvBuffer[12] << 8) + recvBuffer[13];
 
-			switch (recvBuffer[1] & MCMASK) {
+						if (download) delete[] download;
+						download = NULL;
 
-				case MC_GAME:
+						if (!levelSize) {
+
+							// The run of levels has ended
+							if (levelFile) delete[] levelFile;
+							levelFile = NULL;
+
+							break;
+
+						}
+
+						if ((levelSize < 0) || (downloadSize <= 0) || (recvBuffer[0] < MTL_G_LINFO)) return E_DATA;
+
+						recvBuffer[recvBuffer[0] - 1] = 0;
+
+						// Tell the server whether to send the level
+						sendBuffer[0] = MTL_G_LHAVE;
+						sendBuffer[1] = MT_G_LHAVE;
+						sendBuffer[2] = findLevel(reinterpret_cast<char*>(recvBuffer + 14));
+						memcpy(sendBuffer + 3, recvBuffer + 10, 4);
+						send(sendBuffer);
+
+						if (sendBuffer[2]) {
+
+							levelReady = true;
+
+						} else {
+
+							download = new unsigned char[downloadSize];
+							downloaded = 0;
+
+						}
+
+						break;
+
+					}
+
+					if (recvBuffer[1] == MT_G_LDATA) {
+
+						if (download) {
+
+							length = recvBuffer[0] - MTL_G_LDATA;
+							if (length > downloadSize - downloaded) length = downloadSize - downloaded;
+
+							memcpy(download + downloaded, recvBuffer + MTL_G_LDATA, length);
+							downloaded += length;
+
+							if (downloaded == downloadSize) {
+
+								ret = loadDownload();
+
+								if (ret < 0) return ret;
+
+							} else more = true;
+
+						}
+
+						break;
+
+					}
 
 					if (recvBuffer[1] == MT_G_LEVEL) {
 
@@ -497,18 +744,26 @@ int ClientGame::step (unsigned int ticks) {
 
 				case MC_PLAYER:
 
-					if (recvBuffer[2] < maxPlayers)
-						players[recvBuffer[2]].receive(recvBuffer);
+					if (recvBuffer[2] >= maxPlayers) break;
+
+					if (recvBuffer[1] == MT_P_DELTA) {
+
+						if (decodeDelta(recvBuffer, recvSnapshots[recvBuffer[2]]))
+							players[recvBuffer[2]].receive(recvSnapshots[recvBuffer[2]]);
+
+						more = true;
+
+					} else players[recvBuffer[2]].receive(recvBuffer);
 
 					break;
 
 			}
 
-			received = 0;
+			if (!more) break;
 
 		}
 
-	}
+	} while (download && (ret > 0));
 
 	if (ticks >= checkTime) {
 
@@ -523,6 +778,10 @@ int ClientGame::step (unsigned int ticks) {
 
 		}
 
+		// Periodically send all properties, in case the server's
+		// simulation of the player has drifted
+		sentSnapshot[1] = 0;
+
 		checkTime = ticks + T_CCHECK;
 
 	}
@@ -531,16 +790,46 @@ int ClientGame::step (unsigned int ticks) {
 
 		// Update server
 		unsigned char sendBuffer[BUFFER_LENGTH];
-		sendBuffer[0] = MTL_P_TEMP;
-		sendBuffer[1] = MT_P_TEMP;
-		sendBuffer[2] = 0;
-		localPlayer->send(sendBuffer);
-		send(sendBuffer);
+
+		if (protocol >= 2) {
+
+			unsigned char snapshot[MTL_P_TEMP];
+
+			memset(snapshot, 0, MTL_P_TEMP);
+			snapshot[0] = MTL_P_TEMP;
+			snapshot[1] = MT_P_TEMP;
+			snapshot[2] = 0;
+			localPlayer->send(snapshot);
+
+			// Only send what has changed
+			length = encodeDelta(sendBuffer, snapshot, sentSnapshot);
+
+			// Messages must arrive whole, so anything not sent yet is queued
+			if (length) outgoing.insert(outgoing.end(), sendBuffer, sendBuffer + length);
+
+		} else {
+
+			sendBuffer[0] = MTL_P_TEMP;
+			sendBuffer[1] = MT_P_TEMP;
+			sendBuffer[2] = 0;
+			localPlayer->send(sendBuffer);
+			send(sendBuffer);
+
+		}
 
 		sendTime = ticks + T_CSEND;
 
 	}
 
+	if (!flush()) {
+
+		if (file) delete file;
+		file = NULL;
+
+		return E_N_DISCONNECT;
+
+	}
+
 	return E_NONE;
 
 }
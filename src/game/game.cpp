@@ -34,6 +34,7 @@
 #ifdef ENABLE_JJ2
 #include "jj2/level/jj2level.h"
 #endif
+#include "loop.h"
 #include "player/player.h"
 #include "util.h"
 #include "io/log.h"
@@ -244,22 +245,15 @@ int Game::playLevel (char* fileName, bool intro, bool checkpoint) {
 
 	} else {
 
-		try {
-
-			baseLevel = level = new JJ1Level(this, fileName, checkpoint, multiplayer);
-
-		} catch (int e) {
-
-			return e;
-
-		}
+		JJ1Planet *planet = NULL;
 
-		if (intro) {
+		// There is nobody to watch the planet approach in headless and
+		// dedicated server modes
+		if (intro && !headless && !dedicated) {
 
-			JJ1Planet *planet;
 			char *planetFileName = NULL;
 
-			planetFileName = createFileName("PLANET", level->getWorld());
+			planetFileName = createFileName("PLANET", fileName + strlen(fileName) - 3);
 
 			try {
 
@@ -273,22 +267,26 @@ int Game::playLevel (char* fileName, bool intro, bool checkpoint) {
 
 			delete[] planetFileName;
 
-			if (planet) {
+		}
 
-				if (planet->play() == E_QUIT) {
+		// The planet approach is shown while the level loads
+		try {
 
-					delete planet;
-					delete level;
+			baseLevel = level = new JJ1Level(this, fileName, checkpoint, multiplayer, planet);
 
-					return E_QUIT;
+		} catch (int e) {
 
-				}
+			delete planet;
 
-				planetId = planet->getId();
+			return e;
 
-				delete planet;
+		}
 
-			}
+		if (planet) {
+
+			planetId = planet->getId();
+
+			delete planet;
 
 		}
 
@@ -471,3 +469,115 @@ void Game::addLevelPlayer (Player *player) {
 	}
 
 }
+
+
+/**
+ * Modify the extension section of a JJ1 level file to match the actual
+ * extension, as the file will be played under a different name.
+ *
+ * @param data Contents of the level file
+ * @param size Size of the level file
+ * @param fileName Original file name of the level
+ */
+void Game::fixExtension (unsigned char *data, int size, const char *fileName) {
+
+	int count, length;
+
+	length = strlen(fileName);
+
+	if ((size < 5) || (length < 3)) return;
+
+	count = size - 5;
+	while ((count > 0) && (data[count - 1] != 3)) count--;
+
+	if (!count) return;
+
+	data[count] = fileName[length - 3];
+	data[count + 1] = fileName[length - 2];
+	data[count + 2] = fileName[length - 1];
+
+}
+
+
+/**
+ * Encode the temporary properties of a player that have changed since they
+ * were last sent.
+ *
+ * @param buffer Buffer to receive the MT_P_DELTA message
+ * @param snapshot MT_P_TEMP message holding the player's properties
+ * @param baseline MT_P_TEMP message last sent, updated to match (send all
+ * properties if it is not an MT_P_TEMP message)
+ *
+ * @return Length of the message (0 if nothing has changed)
+ */
+int Game::encodeDelta (unsigned char *buffer, unsigned char *snapshot, unsigned char *baseline) {
+
+	bool full;
+	int count, length;
+
+	full = (baseline[1] != MT_P_TEMP);
+
+	memset(buffer + 3, 0, MTL_P_DELTA - 3);
+	length = MTL_P_DELTA;
+
+	// Each bit of the mask marks a property byte that follows
+	for (count = 3; count < MTL_P_TEMP; count++) {
+
+		if (full || (snapshot[count] != baseline[count])) {
+
+			buffer[3 + ((count - 3) >> 3)] |= 1 << ((count - 3) & 7);
+			buffer[length++] = snapshot[count];
+
+		}
+
+	}
+
+	if (length == MTL_P_DELTA) return 0;
+
+	buffer[0] = length;
+	buffer[1] = MT_P_DELTA;
+	buffer[2] = snapshot[2];
+
+	memcpy(baseline, snapshot, MTL_P_TEMP);
+
+	return length;
+
+}
+
+
+/**
+ * Apply the changes in an MT_P_DELTA message to the temporary properties
+ * last received for its player.
+ *
+ * @param buffer The MT_P_DELTA message
+ * @param baseline MT_P_TEMP message last received, updated with the changes
+ *
+ * @return Whether or not the message was valid
+ */
+bool Game::decodeDelta (unsigned char *buffer, unsigned char *baseline) {
+
+	int count, position;
+
+	if (buffer[0] < MTL_P_DELTA) return false;
+
+	position = MTL_P_DELTA;
+
+	for (count = 3; count < MTL_P_TEMP; count++) {
+
+		if (buffer[3 + ((count - 3) >> 3)] & (1 << ((count - 3) & 7))) {
+
+			if (position >= buffer[0]) return false;
+
+			baseline[count] = buffer[position++];
+
+		}
+
+	}
+
+	baseline[0] = MTL_P_TEMP;
+	baseline[1] = MT_P_TEMP;
+	baseline[2] = buffer[2];
+
+	return true;
+
+}
@@ -29,6 +29,9 @@
 #include "io/network.h"
 #include "level/level.h"
 
+#include <unordered_map>
+#include <vector>
+
 
 // Constants
 
@@ -38,6 +41,9 @@
 #define T_CSEND   10
 #define T_CCHECK  1000
 
+// Highest protocol version supported
+#define NET_PROTOCOL 2
+
 // Message categories and types
 #define MCMASK     0xF0
 #define MC_GAME    0x00
@@ -51,6 +57,9 @@
 #define MT_G_CHECK 0x04
 #define MT_G_SCORE 0x05 /* Team scored a roast/lap/etc. */
 #define MT_G_LTYPE 0x06 /* Level type */
+#define MT_G_LINFO 0x07 /* Size and checksum of the compressed level (protocol 2) */
+#define MT_G_LDATA 0x08 /* Compressed level data (protocol 2) */
+#define MT_G_LHAVE 0x09 /* Whether the client already has the level (protocol 2) */
 
 #define MT_L_PROP  0x10 /* Level property */
 #define MT_L_GRID  0x11 /* Change to gridElement */
@@ -58,6 +67,7 @@
 
 #define MT_P_ANIMS 0x20 /* Player animations */
 #define MT_P_TEMP  0x21 /* Temporary player properties, e.g. position */
+#define MT_P_DELTA 0x22 /* Changed temporary player properties (protocol 2) */
 
 // Minimum message lengths, including header
 #define MTL_G_PROPS 8
@@ -67,6 +77,9 @@
 #define MTL_G_CHECK 6
 #define MTL_G_SCORE 3
 #define MTL_G_LTYPE 3
+#define MTL_G_LINFO 15 /* + length of file name */
+#define MTL_G_LDATA 2 /* + amount of compressed level data */
+#define MTL_G_LHAVE 7
 
 #define MTL_L_PROP  5
 #define MTL_L_GRID  8
@@ -74,8 +87,10 @@
 
 #define MTL_P_ANIMS 3 /* + PANIMS, BPANIMS, or 1 (for JJ2) */
 #define MTL_P_TEMP  46
+#define MTL_P_DELTA 9 /* + changed properties */
 
 #define BUFFER_LENGTH 255 /* Should always be big enough to hold any message */
+#define MAX_OUTGOING  0x100000 /* Data queued for a peer that has stopped reading */
 
 
 // Classes
@@ -111,6 +126,10 @@ class Game {
 
 		void addLevelPlayer (Player *player);
 
+		static void fixExtension (unsigned char *data, int size, const char *fileName);
+		static int  encodeDelta (unsigned char *buffer, unsigned char *snapshot, unsigned char *baseline);
+		static bool decodeDelta (unsigned char *buffer, unsigned char *baseline);
+
 	public:
 		virtual ~Game ();
 
@@ -151,16 +170,31 @@ class ServerGame : public Game {
 
 	private:
 		int            clientStatus[MAX_CLIENTS]; /**< Array of client statuses
+ 			-3: Told about the level, but not yet replied (protocol 2)
  			-2: Connected and operational
  			-1: Not connected
 			>=0: Number of bytes of the level that have been sent */
 		int            clientPlayer[MAX_CLIENTS]; ///< Array of client player indexes
 		int            clientSock[MAX_CLIENTS]; ///< Array of client sockets
-		unsigned char  recvBuffers[MAX_CLIENTS][BUFFER_LENGTH]; ///< Array of buffers containing data received from clients
-		int            received[MAX_CLIENTS]; ///< Array containing the amount of data received from each client
+		RingBuffer     recvBuffers[MAX_CLIENTS]; ///< Array of buffers containing data received from clients
+		std::vector<unsigned char> outgoing[MAX_CLIENTS]; ///< Array of data waiting to be sent to clients (protocol 2)
 		unsigned char *levelData; ///< Contents of the current level file
 		int            levelSize; ///< Size of the current level file
+		unsigned char  levelInfo[BUFFER_LENGTH]; ///< Size and checksum of the current level (protocol 2)
+		unsigned char *levelStream; ///< Current level, compressed and split into messages (protocol 2)
+		int            levelStreamSize; ///< Size of the compressed level messages
 		int            sock; ///< Server socket
+		int            protocol; ///< Protocol version
+		unsigned char  sentSnapshots[MAX_CLIENTS][MAX_PLAYERS][MTL_P_TEMP]; ///< Player properties last sent to each client
+		unsigned char  recvSnapshots[MAX_CLIENTS][MTL_P_TEMP]; ///< Player properties last received from each client
+
+		int  compressLevel ();
+		void accept        ();
+		void disconnect    (int client);
+		void sendTo        (int client, unsigned char *buffer);
+		void receive       (int client, unsigned char *buffer);
+		void sendSnapshots ();
+		void flush         (int client);
 
 	public:
 		ServerGame         (GameModeType mode, char *firstLevel, difficultyType gameDifficulty);
@@ -180,11 +214,26 @@ class ClientGame : public Game {
 
 	private:
 		File          *file; ///< File to which the incoming level will be written
-		unsigned char  recvBuffer[BUFFER_LENGTH]; ///< Buffer containing data received from server
-		int            received; ///< Amount of data received from server
+		unsigned char *download; ///< Compressed level being received (protocol 2)
+		int            downloadSize; ///< Size of the compressed level
+		int            downloaded; ///< Amount of the compressed level received so far
+		int            levelSize; ///< Size of the level being received
+		unsigned int   levelCRC; ///< Checksum of the level being received
+		bool           levelReady; ///< Whether the level being received is complete (protocol 2)
+		std::unordered_map<unsigned int, std::vector<unsigned char>> levelCache; ///< Levels received this game, by checksum
+		RingBuffer     incoming; ///< Data received from server
+		std::vector<unsigned char> outgoing; ///< Data waiting to be sent to the server (protocol 2)
+		unsigned char  recvBuffer[BUFFER_LENGTH]; ///< Message received from server
 		int            clientID; ///< Client's index on the server
 		int            maxPlayers; ///< The maximum number of players in the game
 		int            sock; ///< Client socket
+		int            protocol; ///< Protocol version
+		unsigned char  sentSnapshot[MTL_P_TEMP]; ///< Player properties last sent to the server
+		unsigned char  recvSnapshots[MAX_PLAYERS][MTL_P_TEMP]; ///< Player properties last received from the server
+
+		bool findLevel    (const char *fileName);
+		int  loadDownload ();
+		bool flush        ();
 
 	public:
 		explicit ClientGame(char *address);
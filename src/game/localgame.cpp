@@ -25,6 +25,7 @@
 
 #include "game.h"
 #include "gamemode.h"
+#include "replay.h"
 
 #include "player/player.h"
 #include "setup.h"
@@ -51,6 +52,8 @@ LocalGame::LocalGame (const char *firstLevel, difficultyType gameDifficulty) {
 	localPlayer = players = new Player[1];
 	localPlayer->init(this, setup.characterName, NULL, 0);
 
+	replay.start(firstLevel, difficulty);
+
 }
 
 
@@ -59,6 +62,8 @@ LocalGame::LocalGame (const char *firstLevel, difficultyType gameDifficulty) {
  */
 LocalGame::~LocalGame () {
 
+	replay.stop();
+
 	delete mode;
 
 }
@@ -0,0 +1,422 @@
+/**
+ *
+ * @file replay.cpp
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ * @par Description:
+ * Records the local player's control changes, with the step at which they
+ * happen, and the duration of every level frame. Playing these back gives the
+ * same simulation, regardless of the speed at which it runs.
+ *
+ */
+
+
+#include "replay.h"
+
+#include "io/file.h"
+#include "io/log.h"
+#include "loop.h"
+#include "util.h"
+
+#include <string.h>
+
+
+/**
+ * Create an idle replay.
+ */
+Replay::Replay () {
+
+	fileName = nullptr;
+	file = nullptr;
+	data = nullptr;
+	size = position = 0;
+	playing = ended = false;
+	lastStep = 0;
+	frameTicks = -1;
+	repeats = 0;
+
+	for (int i = 0; i < PCONTROLS; i++) pcontrols[i] = false;
+
+}
+
+
+/**
+ * Finish any recording and free the replay.
+ */
+Replay::~Replay () {
+
+	stop();
+
+	delete[] fileName;
+	delete[] data;
+
+}
+
+
+/**
+ * Record the next game to be started.
+ *
+ * @param newFileName Name of the file to record to
+ */
+void Replay::record (const char* newFileName) {
+
+	delete[] fileName;
+	fileName = createString(newFileName);
+
+}
+
+
+/**
+ * Load a replay for playback.
+ *
+ * @param playFileName Name of the file containing the replay
+ * @param levelFile Set to the file name of the first level (new string)
+ * @param difficulty Set to the game difficulty
+ *
+ * @return Error code
+ */
+int Replay::play (const char* playFileName, char*& levelFile, difficultyType& difficulty) {
+
+	FilePtr replayFile;
+
+	try {
+
+		replayFile = std::make_unique<File>(playFileName, PATH_TYPE_ANY);
+
+	} catch (int e) {
+
+		return e;
+
+	}
+
+	char* magic = replayFile->loadString(4);
+	bool valid = !strcmp(magic, "OJRP");
+	delete[] magic;
+
+	if (!valid) {
+
+		LOG_ERROR("Not a replay: %s", playFileName);
+
+		return E_DATA;
+
+	}
+
+	if (replayFile->loadChar() != REPLAY_VERSION) {
+
+		LOG_ERROR("Unsupported replay version: %s", playFileName);
+
+		return E_VERSION;
+
+	}
+
+	difficulty = static_cast<difficultyType>(replayFile->loadChar() & 3);
+	levelFile = replayFile->loadString(replayFile->loadChar());
+
+	// Keep the records in memory, so playback does no file access
+	size = replayFile->getSize() - replayFile->tell();
+	delete[] data;
+	data = replayFile->loadBlock(size);
+	position = 0;
+
+	playing = true;
+	ended = false;
+	lastStep = 0;
+	frameTicks = -1;
+	repeats = 0;
+
+	for (int i = 0; i < PCONTROLS; i++) pcontrols[i] = false;
+
+	LOG_INFO("Playing replay %s of %s", playFileName, levelFile);
+
+	return E_NONE;
+
+}
+
+
+/**
+ * Start recording, if requested, when a game starts.
+ *
+ * Only the first game is recorded.
+ *
+ * @param levelFile File name of the first level
+ * @param difficulty Game difficulty
+ */
+void Replay::start (const char* levelFile, difficultyType difficulty) {
+
+	// Demos do not have a level file, and are not recorded
+	if (!fileName || file || playing || !levelFile[0]) return;
+
+	try {
+
+		file = new File(fileName, PATH_TYPE_TEMP, true);
+
+	} catch (int e) {
+
+		delete[] fileName;
+		fileName = nullptr;
+
+		return;
+
+	}
+
+	file->storeData((void *)"OJRP", 4);
+	file->storeChar(REPLAY_VERSION);
+	file->storeChar(+difficulty);
+	file->storeChar(strlen(levelFile));
+	file->storeData((void *)levelFile, strlen(levelFile));
+
+	lastStep = stepCount;
+	frameTicks = -1;
+	repeats = 0;
+
+	LOG_INFO("Recording replay %s of %s", fileName, levelFile);
+
+}
+
+
+/**
+ * Finish recording.
+ */
+void Replay::stop () {
+
+	if (!file) return;
+
+	storeRepeats();
+
+	delete file;
+	file = nullptr;
+
+	// Do not record any further games
+	delete[] fileName;
+	fileName = nullptr;
+
+}
+
+
+/**
+ * Determine whether or not a replay is being played back.
+ *
+ * @return Whether or not a replay is being played back
+ */
+bool Replay::isPlaying () {
+
+	return playing;
+
+}
+
+
+/**
+ * Determine whether or not all of the replay has been played back.
+ *
+ * @return Whether or not the replay has ended
+ */
+bool Replay::hasEnded () {
+
+	return ended;
+
+}
+
+
+/**
+ * Record any pending repetitions of the last frame.
+ */
+void Replay::storeRepeats () {
+
+	if (repeats) file->storeChar(RR_REPEAT + repeats);
+
+	repeats = 0;
+
+}
+
+
+/**
+ * Record a change to one of the local player's controls.
+ *
+ * @param control The control
+ * @param state The new state of the control
+ */
+void Replay::storeControl (int control, bool state) {
+
+	if (!file) return;
+
+	storeRepeats();
+
+	file->storeChar(RR_CONTROL | (state << 3) | control);
+
+	// Variable-length step number
+	unsigned int steps = stepCount - lastStep;
+
+	while (steps >= 0x80) {
+
+		file->storeChar((steps & 0x7F) | 0x80);
+		steps >>= 7;
+
+	}
+
+	file->storeChar(steps);
+
+	lastStep = stepCount;
+
+}
+
+
+/**
+ * Decode the step number of the control change at the current position.
+ *
+ * @param step Set to the step number
+ * @param length Set to the length of the record
+ *
+ * @return Whether or not there is a complete control change
+ */
+bool Replay::peekStep (unsigned int& step, int& length) {
+
+	unsigned int steps = 0;
+	int shift = 0;
+
+	if ((position >= size) || (data[position] & ~15) != RR_CONTROL) return false;
+
+	length = 1;
+
+	do {
+
+		if ((position + length >= size) || (shift > 28)) return false;
+
+		steps |= (data[position + length] & 0x7F) << shift;
+		shift += 7;
+
+	} while (data[position + length++] & 0x80);
+
+	step = lastStep + steps;
+
+	return true;
+
+}
+
+
+/**
+ * Get the replayed state of one of the local player's controls.
+ *
+ * Applies all control changes recorded for the current step first.
+ *
+ * @param control The control
+ *
+ * @return The state of the control
+ */
+bool Replay::getControl (int control) {
+
+	unsigned int step;
+	int length;
+
+	while (peekStep(step, length) && (step <= stepCount)) {
+
+		pcontrols[data[position] & 7] = data[position] & 8;
+		lastStep = step;
+		position += length;
+
+	}
+
+	return pcontrols[control];
+
+}
+
+
+/**
+ * Record the duration of a level frame.
+ *
+ * @param ticks Duration of the frame
+ */
+void Replay::storeFrame (int ticks) {
+
+	if (!file) return;
+
+	// Level frames never take longer than 100 ticks
+	ticks = CLAMP(ticks, 0, RR_CONTROL - 1);
+
+	if ((ticks == frameTicks) && (repeats < RR_MAXREPEATS)) {
+
+		repeats++;
+
+		return;
+
+	}
+
+	storeRepeats();
+
+	file->storeChar(ticks);
+	frameTicks = ticks;
+
+}
+
+
+/**
+ * Get the duration of the next level frame.
+ *
+ * @return Duration of the frame (-1 if the replay has ended)
+ */
+int Replay::loadFrame () {
+
+	unsigned int step;
+	int length;
+
+	if (repeats) {
+
+		repeats--;
+
+		return frameTicks;
+
+	}
+
+	// Apply any control changes made between frames, e.g. when a level starts
+	while (peekStep(step, length)) {
+
+		if (step > stepCount) LOG_WARN("Replay out of sync at step %u", stepCount);
+
+		pcontrols[data[position] & 7] = data[position] & 8;
+		lastStep = step;
+		position += length;
+
+	}
+
+	if (position >= size) {
+
+		if (!ended) LOG_INFO("Replay ended at step %u", stepCount);
+
+		ended = true;
+
+		return -1;
+
+	}
+
+	unsigned char record = data[position++];
+
+	if (record < RR_CONTROL) {
+
+		frameTicks = record;
+
+	} else if ((record > RR_REPEAT) && (frameTicks >= 0)) {
+
+		// Play the last frame back again
+		repeats = record - RR_REPEAT - 1;
+
+	} else {
+
+		// Incomplete control change at the end of the data
+		LOG_WARN("Replay data is damaged");
+
+		ended = true;
+
+		return -1;
+
+	}
+
+	return frameTicks;
+
+}
+
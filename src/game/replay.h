@@ -0,0 +1,86 @@
+/**
+ *
+ * @file replay.h
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ */
+
+#ifndef OJ_REPLAY_H
+#define OJ_REPLAY_H
+
+
+#include "player/player.h"
+#include "types.h"
+#include "OpenJazz.h"
+
+
+// Constants
+
+#define REPLAY_VERSION 1
+
+/* Replay file format:
+   "OJRP", version, difficulty, level file name length, level file name,
+   then one record per byte (plus any step number):
+   0x00 - 0x7F: A level frame, the value being the number of ticks it took
+   0x80 - 0x8F: A control change, (state << 3) | control, followed by the
+                number of steps since the last control change (LEB128)
+   0x90 - 0xFF: The previous frame, repeated (value - 0x8F) more times */
+#define RR_CONTROL 0x80
+#define RR_REPEAT  0x8F
+#define RR_MAXREPEATS (0xFF - RR_REPEAT)
+
+
+// Class
+
+class File;
+
+/// Records the local player's controls and the level timing, and plays them back
+class Replay {
+
+	private:
+		char*          fileName; ///< File to record to
+		File*          file; ///< Recording in progress
+		unsigned char* data; ///< Replay being played back
+		int            size; ///< Size of the replay data
+		int            position; ///< Position of the next record in the replay data
+		bool           playing; ///< Whether or not a replay is being played back
+		bool           ended; ///< Whether or not all of the replay has been played back
+		unsigned int   lastStep; ///< Step of the last control change
+		int            frameTicks; ///< Duration of the last frame
+		int            repeats; ///< Repetitions of the last frame not yet recorded or played back
+		bool           pcontrols[PCONTROLS]; ///< Replayed control states
+
+		void storeRepeats ();
+		bool peekStep     (unsigned int& step, int& length);
+
+	public:
+		Replay  ();
+		~Replay ();
+
+		void record       (const char* newFileName);
+		int  play         (const char* playFileName, char*& levelFile, difficultyType& difficulty);
+		void start        (const char* levelFile, difficultyType difficulty);
+		void stop         ();
+		bool isPlaying    ();
+		bool hasEnded     ();
+		void storeControl (int control, bool state);
+		bool getControl   (int control);
+		void storeFrame   (int ticks);
+		int  loadFrame    ();
+
+};
+
+
+// Variable
+
+EXTERN Replay replay; ///< Input recording and playback
+
+#endif
+
@@ -31,6 +31,7 @@
 #include "setup.h"
 #include "util.h"
 
+#include <miniz.h>
 #include <string.h>
 
 
@@ -62,19 +63,29 @@ ServerGame::ServerGame (GameModeType modeType, char* firstLevel, difficultyType
 	for (count = 0; count < MAX_CLIENTS; count++)
 		clientPlayer[count] = clientStatus[count] = -1;
 
+	protocol = netProtocol;
+	memset(sentSnapshots, 0, sizeof(sentSnapshots));
+	memset(recvSnapshots, 0, sizeof(recvSnapshots));
+
+	net->resetStats();
+	net->watch(sock);
+
 
 	// Copy the first level into memory
 
 	levelFile = NULL;
 	levelData = NULL;
+	levelStream = NULL;
 
 	count = setLevel(firstLevel);
 
 	if (count < 0) {
 
+		net->unwatch(sock);
 		net->close(sock);
 
 		if (levelData) delete[] levelData;
+		if (levelStream) delete[] levelStream;
 
 		throw count;
 
@@ -96,13 +107,22 @@ ServerGame::~ServerGame () {
 
 	for (count = 0; count < MAX_CLIENTS; count++) {
 
-		if (clientStatus[count] != -1) net->close(clientSock[count]);
+		if (clientStatus[count] != -1) {
+
+			net->unwatch(clientSock[count]);
+			net->close(clientSock[count]);
+
+		}
 
 	}
 
+	net->unwatch(sock);
 	net->close(sock);
 
+	net->logStats();
+
 	if (levelData) delete[] levelData;
+	if (levelStream) delete[] levelStream;
 
 	delete mode;
 
@@ -123,6 +143,9 @@ int ServerGame::setLevel (char* fileName) {
 
 	if (levelFile) delete[] levelFile;
 	if (levelData) delete[] levelData;
+	if (levelStream) delete[] levelStream;
+
+	levelStream = NULL;
 
 	// The new level will be sent to all clients
 	for (count = 0; count < MAX_CLIENTS; count++) {
@@ -136,7 +159,7 @@ int ServerGame::setLevel (char* fileName) {
 		levelFile = NULL;
 		levelData = NULL;
 
-		return E_NONE;
+		return (protocol >= 2)? compressLevel(): E_NONE;
 
 	}
 
@@ -163,20 +186,135 @@ int ServerGame::setLevel (char* fileName) {
 
 	levelType = getLevelType(fileName);
 
-	if (levelType != LT_JJ1) return E_NONE;
+	if (levelType == LT_JJ1) fixExtension(levelData, levelSize, fileName);
+
+	return (protocol >= 2)? compressLevel(): E_NONE;
+
+}
+
+
+/**
+ * Compress the current level and split it into messages, and describe it so
+ * that clients which already have it need not download it.
+ *
+ * @return Error code
+ */
+int ServerGame::compressLevel () {
+
+	unsigned char *compressed;
+	mz_ulong compressedSize;
+	unsigned int crc;
+	int count, length, nameLength;
+
+	memset(levelInfo, 0, MTL_G_LINFO);
+	levelInfo[0] = MTL_G_LINFO;
+	levelInfo[1] = MT_G_LINFO;
+
+	// A zero-size level means that the run of levels has ended
+	if (!levelData) return E_NONE;
+
+	compressedSize = mz_compressBound(levelSize);
+	compressed = new unsigned char[compressedSize];
+
+	if (mz_compress2(compressed, &compressedSize, levelData, levelSize, MZ_BEST_COMPRESSION) != MZ_OK) {
+
+		delete[] compressed;
+
+		return E_DATA;
+
+	}
+
+	crc = mz_crc32(MZ_CRC32_INIT, levelData, levelSize);
 
-	// Modify the extension section to match the actual extension
-	count = levelSize - 5;
-	while (levelData[count - 1] != 3) count--;
-	levelData[count] = fileName[strlen(fileName) - 3];
-	levelData[count + 1] = fileName[strlen(fileName) - 2];
-	levelData[count + 2] = fileName[strlen(fileName) - 1];
+	// Split the compressed level into the largest messages possible
+	levelStream = new unsigned char[compressedSize + (((compressedSize / (BUFFER_LENGTH - MTL_G_LDATA)) + 1) * MTL_G_LDATA)];
+	levelStreamSize = 0;
+
+	for (count = 0; count < static_cast<int>(compressedSize); count += length) {
+
+		length = compressedSize - count;
+		if (length > BUFFER_LENGTH - MTL_G_LDATA) length = BUFFER_LENGTH - MTL_G_LDATA;
+
+		levelStream[levelStreamSize] = MTL_G_LDATA + length;
+		levelStream[levelStreamSize + 1] = MT_G_LDATA;
+		memcpy(levelStream + levelStreamSize + MTL_G_LDATA, compressed + count, length);
+
+		levelStreamSize += MTL_G_LDATA + length;
+
+	}
+
+	delete[] compressed;
+
+	levelInfo[2] = levelSize >> 24;
+	levelInfo[3] = (levelSize >> 16) & 255;
+	levelInfo[4] = (levelSize >> 8) & 255;
+	levelInfo[5] = levelSize & 255;
+	levelInfo[6] = compressedSize >> 24;
+	levelInfo[7] = (compressedSize >> 16) & 255;
+	levelInfo[8] = (compressedSize >> 8) & 255;
+	levelInfo[9] = compressedSize & 255;
+	levelInfo[10] = crc >> 24;
+	levelInfo[11] = (crc >> 16) & 255;
+	levelInfo[12] = (crc >> 8) & 255;
+	levelInfo[13] = crc & 255;
+
+	// Clients look for a copy of the level under the same name
+	nameLength = strlen(levelFile);
+	if (nameLength > BUFFER_LENGTH - MTL_G_LINFO) nameLength = BUFFER_LENGTH - MTL_G_LINFO;
+
+	levelInfo[0] = MTL_G_LINFO + nameLength;
+	memcpy(levelInfo + 14, levelFile, nameLength);
+	levelInfo[14 + nameLength] = 0;
+
+	printf("Level %s: %d bytes, %d compressed.\n", levelFile, levelSize, int(compressedSize));
 
 	return E_NONE;
 
 }
 
 
+/**
+ * Send data to a client. With protocol 2, the data waits until the end of the
+ * step, so that everything for the client goes at once.
+ *
+ * @param client Index of the client
+ * @param buffer Data to send. First byte indicates length.
+ */
+void ServerGame::sendTo (int client, unsigned char* buffer) {
+
+	if (protocol >= 2) outgoing[client].insert(outgoing[client].end(), buffer, buffer + buffer[0]);
+	else net->send(clientSock[client], buffer);
+
+}
+
+
+/**
+ * Send the data waiting for a client, as much as the connection will take.
+ *
+ * @param client Index of the client
+ */
+void ServerGame::flush (int client) {
+
+	int length;
+
+	if (outgoing[client].empty()) return;
+
+	// Give up on a client that has stopped reading
+	if (outgoing[client].size() > MAX_OUTGOING) {
+
+		disconnect(client);
+
+		return;
+
+	}
+
+	length = net->send(clientSock[client], outgoing[client].data(), outgoing[client].size());
+
+	if (length > 0) outgoing[client].erase(outgoing[client].begin(), outgoing[client].begin() + length);
+
+}
+
+
 /**
  * Send data to clients
  *
@@ -193,7 +331,7 @@ void ServerGame::send (unsigned char* buffer) {
 		if ((clientStatus[count] != -1) &&
 			(((buffer[1] & MCMASK) != MC_PLAYER) ||
 			(buffer[2] != clientPlayer[count])))
-			net->send(clientSock[count], buffer);
+			sendTo(count, buffer);
 
 	}
 
@@ -201,287 +339,426 @@ void ServerGame::send (unsigned char* buffer) {
 
 
 /**
- * Game iteration
- *
- * @param ticks Current time
- *
- * @return Error code
+ * Send each client the changes to the other players' temporary properties
+ * since the last snapshot it was sent, all in one packet.
  */
-int ServerGame::step (unsigned int ticks) {
+void ServerGame::sendSnapshots () {
 
-	unsigned char sendBuffer[BUFFER_LENGTH];
+	unsigned char snapshots[MAX_PLAYERS][MTL_P_TEMP];
+	unsigned char packet[MAX_PLAYERS * (MTL_P_DELTA + MTL_P_TEMP)];
 	int count, pcount, length;
 
-	for (count = 0; count < MAX_CLIENTS; count++) {
+	for (pcount = 0; pcount < nPlayers; pcount++) {
 
-		if (clientStatus[count] >= 0) {
+		// Clear unused bytes, so that they never appear to change
+		memset(snapshots[pcount], 0, MTL_P_TEMP);
 
-			if (clientStatus[count] == 0) {
+		snapshots[pcount][0] = MTL_P_TEMP;
+		snapshots[pcount][1] = MT_P_TEMP;
+		snapshots[pcount][2] = pcount;
+		players[pcount].send(snapshots[pcount]);
 
-				// Send level type
-				sendBuffer[0] = MTL_G_LTYPE;
-				sendBuffer[1] = MT_G_LTYPE;
-				sendBuffer[2] = levelType;
-				net->send(clientSock[count], sendBuffer);
+	}
 
-			}
+	for (count = 0; count < MAX_CLIENTS; count++) {
 
-			// Client is connected, but not operational
-			// Send a chunk of the level
+		if (clientStatus[count] == -1) continue;
 
-			length = levelSize - clientStatus[count];
+		length = 0;
 
-			if (length > 251) length = 251;
+		for (pcount = 0; pcount < nPlayers; pcount++) {
 
-			sendBuffer[0] = MTL_G_LEVEL + length;
-			sendBuffer[1] = MT_G_LEVEL;
-			sendBuffer[2] = clientStatus[count] >> 8;
-			sendBuffer[3] = clientStatus[count] & 255;
-			memcpy(sendBuffer + 4, levelData + clientStatus[count], length);
-			length = net->send(clientSock[count], sendBuffer);
+			// Each client is solely responsible for its player's state
+			if (pcount == clientPlayer[count]) continue;
 
-			// Client is operational if the whole level has been sent
-			// Otherwise, keep sending data
-			if (length == MTL_G_LEVEL) clientStatus[count] = -2;
-			else if (length > 0) clientStatus[count] += length - MTL_G_LEVEL;
+			length += encodeDelta(packet + length, snapshots[pcount], sentSnapshots[count][pcount]);
 
 		}
 
+		outgoing[count].insert(outgoing[count].end(), packet, packet + length);
+
+	}
+
+}
+
+
+/**
+ * Accept waiting connections from new clients.
+ */
+void ServerGame::accept () {
+
+	unsigned char sendBuffer[BUFFER_LENGTH];
+	int count, pcount, newSock;
+
+	while ((newSock = net->accept(sock)) != -1) {
 
-		if ((clientStatus[count] == -2) && (received[count] == 0)) {
+		for (count = 0; count < MAX_CLIENTS; count++) {
 
-			// Client is operational, but not currently receiving a message
-			// See if there is a new message to receive
+			if (clientStatus[count] == -1) break;
 
-			length = net->recv(clientSock[count], recvBuffers[count], 1);
+		}
+
+		if ((count == MAX_CLIENTS) || !levelData) {
 
-			if (length > 0) received[count]++;
+			// There is no room for the client, or nothing left to play
+			net->close(newSock);
+
+			continue;
 
 		}
 
+		printf("Client %d connected.\n", count);
 
-		if ((clientStatus[count] == -2) && (received[count] > 0)) {
+		clientSock[count] = newSock;
+		clientPlayer[count] = -1;
+		recvBuffers[count].clear();
+		outgoing[count].clear();
+		memset(sentSnapshots[count], 0, sizeof(sentSnapshots[count]));
+		memset(recvSnapshots[count], 0, sizeof(recvSnapshots[count]));
 
-			// Currently receiving a message
-			// See if there is any more data
+		net->watch(newSock);
 
-			length = net->recv(clientSock[count],
-				recvBuffers[count] + received[count],
-				recvBuffers[count][0] - received[count]);
+		// Incorporate the new client
 
-			if (length > 0) received[count] += length;
+		// Send data
+		sendBuffer[0] = MTL_G_PROPS;
+		sendBuffer[1] = MT_G_PROPS;
+		sendBuffer[2] = protocol; // Server version
+		sendBuffer[3] = mode->getMode();
+		sendBuffer[4] = +difficulty;
+		sendBuffer[5] = MAX_PLAYERS;
+		sendBuffer[6] = nPlayers; // Number of players
+		sendBuffer[7] = count; // Client's clientID
+		sendTo(count, sendBuffer);
 
+		// Initiate sending of level data
+		clientStatus[count] = 0;
 
-			// See if the whole message has arrived
+		// Inform the new client of the checkpoint
+		sendBuffer[0] = MTL_G_CHECK;
+		sendBuffer[1] = MT_G_CHECK;
+		sendBuffer[2] = checkX & 0xFF;
+		sendBuffer[3] = checkY & 0xFF;
+		sendBuffer[4] = (checkX >> 8) & 0xFF;
+		sendBuffer[5] = (checkY >> 8) & 0xFF;
+		sendTo(count, sendBuffer);
 
-			if (received[count] >= recvBuffers[count][0]) {
+		// Inform the new client of the existing players
 
-				switch (recvBuffers[count][1] & MCMASK) {
+		sendBuffer[1] = MT_G_PJOIN;
 
-					case MC_GAME:
+		for (pcount = 0; pcount < nPlayers; pcount++) {
 
-						if ((recvBuffers[count][1] == MT_G_PJOIN) &&
-							(clientPlayer[count] == -1)) {
+			sendBuffer[0] = MTL_G_PJOIN + strlen(players[pcount].getName());
+			sendBuffer[2] = count;
+			sendBuffer[3] = pcount;
+			sendBuffer[4] = players[pcount].getTeam();
+			memcpy(sendBuffer + 5, players[pcount].getCols(), PCOLOURS);
+			memcpy(sendBuffer + 9, players[pcount].getName(), strlen(players[pcount].getName()) + 1);
 
-							printf("Player %d (client %d) joined the game.\n", nPlayers, count);
+			sendTo(count, sendBuffer);
 
+		}
+
+	}
+
+}
+
+
+/**
+ * Disconnect a client, and remove its player.
+ *
+ * @param client Index of the client
+ */
+void ServerGame::disconnect (int client) {
 
-							// Set up the new player
+	unsigned char sendBuffer[MTL_G_PQUIT];
+	int pcount;
 
-							recvBuffers[count][4] = mode->chooseTeam();
+	printf("Client %d disconnected (code: %d).\n", client, net->getError());
 
-							players[nPlayers].init(this,
-								reinterpret_cast<char*>(recvBuffers[count] + 9),
-								recvBuffers[count] + 5, recvBuffers[count][4]);
-							addLevelPlayer(players + nPlayers);
+	// Disconnect client
+	net->unwatch(clientSock[client]);
+	net->close(clientSock[client]);
+	clientStatus[client] = -1;
+	outgoing[client].clear();
 
-							printf("Player %d joined team %d.\n", nPlayers, recvBuffers[count][4]);
+	if (clientPlayer[client] != -1) {
 
-							recvBuffers[count][3] = clientPlayer[count] = nPlayers;
+		// Remove the client's player
 
-							nPlayers++;
+		printf("Player %d (client %d) left the game.\n", clientPlayer[client], client);
 
-						}
+		nPlayers--;
 
-						if (recvBuffers[count][1] == MT_G_CHECK) {
+		players[clientPlayer[client]].deinit();
 
-							checkX = recvBuffers[count][2];
-							checkY = recvBuffers[count][3];
+		// If necessary, move more recent players
+		for (pcount = clientPlayer[client]; pcount < nPlayers; pcount++)
+			memcpy(static_cast<void*>(players + pcount), players + pcount + 1, sizeof(Player));
 
-							if (recvBuffers[count][0] > 4) {
+		// Clear duplicate pointers
+		memset(static_cast<void*>(players + nPlayers), 0, sizeof(Player));
 
-								checkX += recvBuffers[count][4] << 8;
-								checkY += recvBuffers[count][5] << 8;
+		// Players have moved, so start every client's view of them afresh
+		memset(sentSnapshots, 0, sizeof(sentSnapshots));
 
-							}
+		// Inform remaining clients that the player has left
+		sendBuffer[0] = MTL_G_PQUIT;
+		sendBuffer[1] = MT_G_PQUIT;
+		sendBuffer[2] = clientPlayer[client];
+		send(sendBuffer);
 
-						}
+		clientPlayer[client] = -1;
 
-						if (recvBuffers[count][1] == MT_G_SCORE) {
+	}
 
-							for (pcount = 0; pcount < nPlayers; pcount++) {
+}
 
-								if (players[pcount].getTeam() == recvBuffers[count][2])
-									players[pcount].teamScore++;
 
-							}
+/**
+ * Interpret a message received from a client, and pass it on to the others.
+ *
+ * @param client Index of the client
+ * @param buffer The message. First byte indicates length.
+ */
+void ServerGame::receive (int client, unsigned char* buffer) {
 
-						}
+	int pcount;
+	bool relay;
 
-						break;
+	relay = true;
 
-					case MC_LEVEL:
+	switch (buffer[1] & MCMASK) {
 
-						baseLevel->receive(recvBuffers[count]);
+		case MC_GAME:
 
-						break;
+			if ((buffer[1] == MT_G_PJOIN) &&
+				(clientPlayer[client] == -1)) {
 
-					case MC_PLAYER:
+				printf("Player %d (client %d) joined the game.\n", nPlayers, client);
 
-						if (clientPlayer[count] != -1) {
 
-							// Assign player byte based on sender
-							recvBuffers[count][2] = clientPlayer[count];
+				// Set up the new player
 
-							players[clientPlayer[count]].receive(recvBuffers[count]);
+				buffer[4] = mode->chooseTeam();
 
-						}
+				players[nPlayers].init(this,
+					reinterpret_cast<char*>(buffer + 9),
+					buffer + 5, buffer[4]);
+				addLevelPlayer(players + nPlayers);
 
-						break;
+				printf("Player %d joined team %d.\n", nPlayers, buffer[4]);
 
-				}
+				buffer[3] = clientPlayer[client] = nPlayers;
 
-				// Update clients
-				send(recvBuffers[count]);
+				nPlayers++;
 
-				received[count] = 0;
+				// Start every client's view of the players afresh
+				memset(sentSnapshots, 0, sizeof(sentSnapshots));
 
 			}
 
-		}
+			if (buffer[1] == MT_G_LHAVE) {
 
-		if (ticks >= checkTime) {
+				// Only send the level if the client does not already have
+				// it, and the reply is not about an earlier level
+				if ((clientStatus[client] == -3) && !memcmp(buffer + 3, levelInfo + 10, 4)) {
 
-			if ((clientStatus[count] == -1) && levelData) {
+					if (!buffer[2]) {
 
-				// Client is not connected
-				// Check for new connection
+						outgoing[client].insert(outgoing[client].end(),
+							levelStream, levelStream + levelStreamSize);
 
-				clientSock[count] = net->accept(sock);
+					} else printf("Client %d already has the level.\n", client);
 
-				if (clientSock[count] != -1) {
+					clientStatus[client] = -2;
 
-					printf("Client %d connected.\n", count);
+				}
 
-					clientPlayer[count] = -1;
-					received[count] = 0;
+				relay = false;
 
-					// Incorporate the new client
+			}
 
-					// Send data
-					sendBuffer[0] = MTL_G_PROPS;
-					sendBuffer[1] = MT_G_PROPS;
-					sendBuffer[2] = 1; // Server version
-					sendBuffer[3] = mode->getMode();
-					sendBuffer[4] = +difficulty;
-					sendBuffer[5] = MAX_PLAYERS;
-					sendBuffer[6] = nPlayers; // Number of players
-					sendBuffer[7] = count; // Client's clientID
-					net->send(clientSock[count], sendBuffer);
+			if (buffer[1] == MT_G_CHECK) {
 
-					// Initiate sending of level data
-					clientStatus[count] = 0;
+				checkX = buffer[2];
+				checkY = buffer[3];
 
-					// Inform the new client of the checkpoint
-					sendBuffer[0] = MTL_G_CHECK;
-					sendBuffer[1] = MT_G_CHECK;
-					sendBuffer[2] = checkX & 0xFF;
-					sendBuffer[3] = checkY & 0xFF;
-					sendBuffer[4] = (checkX >> 8) & 0xFF;
-					sendBuffer[5] = (checkY >> 8) & 0xFF;
-					net->send(clientSock[count], sendBuffer);
+				if (buffer[0] > 4) {
 
-					// Inform the new client of the existing players
+					checkX += buffer[4] << 8;
+					checkY += buffer[5] << 8;
 
-					sendBuffer[1] = MT_G_PJOIN;
+				}
 
-					for (pcount = 0; pcount < nPlayers; pcount++) {
+			}
 
-						sendBuffer[0] = MTL_G_PJOIN + strlen(players[pcount].getName());
-						sendBuffer[2] = count;
-						sendBuffer[3] = pcount;
-						sendBuffer[4] = players[pcount].getTeam();
-						memcpy(sendBuffer + 5, players[pcount].getCols(), PCOLOURS);
-						memcpy(sendBuffer + 9, players[pcount].getName(), strlen(players[pcount].getName()) + 1);
+			if (buffer[1] == MT_G_SCORE) {
 
-						net->send(clientSock[count], sendBuffer);
+				for (pcount = 0; pcount < nPlayers; pcount++) {
 
-					}
+					if (players[pcount].getTeam() == buffer[2])
+						players[pcount].teamScore++;
 
 				}
 
-			} else {
+			}
+
+			break;
 
-				// Client is connected
-				// Check for disconnection
+		case MC_LEVEL:
 
-				if (!(net->isConnected(clientSock[count]))) {
+			baseLevel->receive(buffer);
 
-					printf("Client %d disconnected (code: %d).\n", count, net->getError());
+			break;
 
-					// Disconnect client
-					net->close(clientSock[count]);
-					clientStatus[count] = -1;
+		case MC_PLAYER:
 
-					if (clientPlayer[count] != -1) {
+			if (clientPlayer[client] != -1) {
 
-						// Remove the client's player
+				// Assign player byte based on sender
+				buffer[2] = clientPlayer[client];
 
-						printf("Player %d (client %d) left the game.\n", clientPlayer[count], count);
+				if (buffer[1] == MT_P_DELTA) {
 
-						nPlayers--;
+					// Clients will get the changes with the next snapshot
+					if (decodeDelta(buffer, recvSnapshots[client]))
+						players[clientPlayer[client]].receive(recvSnapshots[client]);
 
-						players[clientPlayer[count]].deinit();
+					relay = false;
 
-						// If necessary, move more recent players
-						for (pcount = clientPlayer[count]; pcount < nPlayers; pcount++)
-							memcpy(static_cast<void*>(players + pcount), players + pcount + 1, sizeof(Player));
+				} else players[clientPlayer[client]].receive(buffer);
 
-						// Clear duplicate pointers
-						memset(static_cast<void*>(players + nPlayers), 0, sizeof(Player));
+			}
 
-						// Inform remaining clients that the player has left
-						sendBuffer[0] = MTL_G_PQUIT;
-						sendBuffer[1] = MT_G_PQUIT;
-						sendBuffer[2] = clientPlayer[count];
-						send(sendBuffer);
+			break;
 
-						clientPlayer[count] = -1;
+	}
 
-					}
+	// Update clients
+	if (relay) send(buffer);
 
-				}
+}
+
+
+/**
+ * Game iteration
+ *
+ * @param ticks Current time
+ *
+ * @return Error code
+ */
+int ServerGame::step (unsigned int ticks) {
+
+	unsigned char sendBuffer[BUFFER_LENGTH];
+	int count, pcount, length;
+
+	// Find out which connections have data waiting, instead of trying each
+	net->wait(0);
+
+	if (net->isReady(sock)) accept();
+
+	for (count = 0; count < MAX_CLIENTS; count++) {
+
+		if (clientStatus[count] == -1) continue;
+
+		if ((protocol >= 2) && (clientStatus[count] == 0)) {
+
+			// Send level type, and describe the level instead of sending it
+			sendBuffer[0] = MTL_G_LTYPE;
+			sendBuffer[1] = MT_G_LTYPE;
+			sendBuffer[2] = levelType;
+			sendTo(count, sendBuffer);
+			sendTo(count, levelInfo);
+
+			// Wait for the client to say whether it needs the level
+			clientStatus[count] = levelData? -3: -2;
+
+		} else if (clientStatus[count] >= 0) {
+
+			if (clientStatus[count] == 0) {
+
+				// Send level type
+				sendBuffer[0] = MTL_G_LTYPE;
+				sendBuffer[1] = MT_G_LTYPE;
+				sendBuffer[2] = levelType;
+				net->send(clientSock[count], sendBuffer);
 
 			}
 
+			// Client is connected, but not operational
+			// Send a chunk of the level
+
+			length = levelSize - clientStatus[count];
+
+			if (length > 251) length = 251;
+
+			sendBuffer[0] = MTL_G_LEVEL + length;
+			sendBuffer[1] = MT_G_LEVEL;
+			sendBuffer[2] = clientStatus[count] >> 8;
+			sendBuffer[3] = clientStatus[count] & 255;
+			memcpy(sendBuffer + 4, levelData + clientStatus[count], length);
+			length = net->send(clientSock[count], sendBuffer);
+
+			// Client is operational if the whole level has been sent
+			// Otherwise, keep sending data
+			if (length == MTL_G_LEVEL) clientStatus[count] = -2;
+			else if (length > 0) clientStatus[count] += length - MTL_G_LEVEL;
+
+		}
+
+		// Receive whatever has arrived. A closed connection is ready, but
+		// has nothing to receive.
+		if (net->isReady(clientSock[count]) &&
+			(recvBuffers[count].receive(clientSock[count]) < 0)) {
+
+			disconnect(count);
+
+			continue;
+
+		}
+
+		// Once the client is operational, handle every whole message. With
+		// protocol 2, the level no longer holds up messages from the client.
+		if ((protocol >= 2) || (clientStatus[count] == -2)) {
+
+			while (recvBuffers[count].getMessage(sendBuffer)) receive(count, sendBuffer);
+
 		}
 
 	}
 
-	if (ticks >= checkTime) checkTime = ticks + T_SCHECK;
+	if (ticks >= checkTime) {
+
+		// Periodically send all properties, in case clients' simulations of
+		// unchanged players have drifted
+		memset(sentSnapshots, 0, sizeof(sentSnapshots));
+
+		checkTime = ticks + T_SCHECK;
+
+	}
 
 	if (ticks >= sendTime) {
 
 		// Update clients
 
-		sendBuffer[0] = MTL_P_TEMP;
-		sendBuffer[1] = MT_P_TEMP;
+		if (protocol >= 2) {
 
-		for (count = 0; count < nPlayers; count++) {
+			sendSnapshots();
 
-			sendBuffer[2] = count;
-			players[count].send(sendBuffer);
-			send(sendBuffer);
+		} else {
+
+			sendBuffer[0] = MTL_P_TEMP;
+			sendBuffer[1] = MT_P_TEMP;
+
+			for (pcount = 0; pcount < nPlayers; pcount++) {
+
+				sendBuffer[2] = pcount;
+				players[pcount].send(sendBuffer);
+				send(sendBuffer);
+
+			}
 
 		}
 
@@ -489,6 +766,12 @@ int ServerGame::step (unsigned int ticks) {
 
 	}
 
+	for (count = 0; count < MAX_CLIENTS; count++) {
+
+		if (clientStatus[count] != -1) flush(count);
+
+	}
+
 	return E_NONE;
 
 }
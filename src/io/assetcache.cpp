@@ -0,0 +1,267 @@
+/**
+ *
+ * @file assetcache.cpp
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ * @par Description:
+ * Keeps data that is the same for every level, such as the player's sprites,
+ * the panel and fonts, so that it is only decoded once.
+ *
+ */
+
+
+#include "assetcache.h"
+
+#include "io/gfx/font.h"
+#include "io/log.h"
+
+
+/**
+ * Delete the asset.
+ */
+Asset::~Asset () {
+
+}
+
+
+/**
+ * Load a font.
+ *
+ * @param bonus Whether to load the bonus level font instead of the level font
+ */
+FontAsset::FontAsset (bool bonus) {
+
+	font = new Font(bonus);
+
+}
+
+
+/**
+ * Delete the font.
+ */
+FontAsset::~FontAsset () {
+
+	delete font;
+
+}
+
+
+/**
+ * Get the memory used by the font.
+ *
+ * @return The size, in bytes
+ */
+int FontAsset::getSize () {
+
+	return font->getSize();
+
+}
+
+
+/**
+ * Delete the sprite images.
+ */
+SpriteImageAsset::~SpriteImageAsset () {
+
+	for (SpriteImage& image: images) delete[] image.pixels;
+
+}
+
+
+/**
+ * Get the memory used by the sprite images.
+ *
+ * @return The size, in bytes
+ */
+int SpriteImageAsset::getSize () {
+
+	int size = 0;
+
+	for (SpriteImage& image: images) {
+
+		if (image.pixels) size += image.width * image.height;
+
+	}
+
+	return size;
+
+}
+
+
+/**
+ * Create an empty asset cache.
+ */
+AssetCache::AssetCache () {
+
+	budget = ASSET_BUDGET;
+	unusedSize = 0;
+
+}
+
+
+/**
+ * Delete the asset cache, and any assets left in it.
+ */
+AssetCache::~AssetCache () {
+
+	clear();
+
+}
+
+
+/**
+ * Remove the least recently used unused assets, until the rest fit the budget.
+ */
+void AssetCache::evict () {
+
+	while ((unusedSize > budget) && !unused.empty()) {
+
+		std::unordered_map<std::string, Entry>::iterator it = entries.find(unused.front());
+
+		LOG_DEBUG("Evicting asset %s (%d bytes)", it->first.c_str(), it->second.size);
+
+		unusedSize -= it->second.size;
+		delete it->second.asset;
+
+		unused.pop_front();
+		entries.erase(it);
+
+	}
+
+}
+
+
+/**
+ * Start using a cached asset.
+ *
+ * @param key Name of the asset, including its file name and how it was decoded
+ *
+ * @return The asset (nullptr if not cached)
+ */
+Asset* AssetCache::acquire (const char* key) {
+
+	std::unordered_map<std::string, Entry>::iterator it = entries.find(key);
+
+	if (it == entries.end()) return nullptr;
+
+	Entry& entry = it->second;
+
+	if (!entry.references) {
+
+		unused.erase(entry.unused);
+		unusedSize -= entry.size;
+
+	}
+
+	entry.references++;
+
+	LOG_TRACE("Reusing asset %s", key);
+
+	return entry.asset;
+
+}
+
+
+/**
+ * Add a newly decoded asset, and start using it.
+ *
+ * @param key Name of the asset, including its file name and how it was decoded
+ * @param asset The asset, which now belongs to the cache
+ *
+ * @return The asset (or the one already cached under the same key)
+ */
+Asset* AssetCache::add (const char* key, Asset* asset) {
+
+	Asset* cached = acquire(key);
+
+	if (cached) {
+
+		delete asset;
+
+		return cached;
+
+	}
+
+	Entry& entry = entries[key];
+
+	entry.asset = asset;
+	entry.references = 1;
+	entry.size = 0;
+
+	return asset;
+
+}
+
+
+/**
+ * Stop using a cached asset. It is kept, while the budget allows, until it is
+ * used again.
+ *
+ * @param key Name of the asset
+ */
+void AssetCache::release (const char* key) {
+
+	std::unordered_map<std::string, Entry>::iterator it = entries.find(key);
+
+	if ((it == entries.end()) || !it->second.references) {
+
+		LOG_WARN("Released unused asset %s", key);
+
+		return;
+
+	}
+
+	Entry& entry = it->second;
+
+	if (--entry.references) return;
+
+	// Users may have added to the asset, so measure it now
+	entry.size = entry.asset->getSize();
+	entry.unused = unused.insert(unused.end(), it->first);
+	unusedSize += entry.size;
+
+	evict();
+
+}
+
+
+/**
+ * Set the memory budget for unused assets.
+ *
+ * @param bytes The budget, in bytes (0 to keep no unused assets)
+ */
+void AssetCache::setBudget (int bytes) {
+
+	budget = bytes;
+
+	evict();
+
+}
+
+
+/**
+ * Delete all assets. None may be in use.
+ */
+void AssetCache::clear () {
+
+	for (std::pair<const std::string, Entry>& item: entries) {
+
+		if (item.second.references) LOG_WARN("Deleting asset %s while in use", item.first.c_str());
+
+		delete item.second.asset;
+
+	}
+
+	entries.clear();
+	unused.clear();
+	unusedSize = 0;
+
+}
+
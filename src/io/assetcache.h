@@ -0,0 +1,121 @@
+/**
+ *
+ * @file assetcache.h
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ */
+
+#ifndef OJ_ASSETCACHE_H
+#define OJ_ASSETCACHE_H
+
+
+#include "OpenJazz.h"
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Constants
+
+/// Default memory budget for unused assets, in bytes
+#define ASSET_BUDGET (8 << 20)
+
+
+// Classes
+
+class Font;
+
+/// Decoded data that can be kept between levels
+class Asset {
+
+	public:
+		virtual ~Asset ();
+
+		virtual int getSize () = 0;
+
+};
+
+/// Font kept between levels
+class FontAsset : public Asset {
+
+	public:
+		Font* font; ///< The font
+
+		explicit FontAsset (bool bonus);
+		~FontAsset ();
+
+		int getSize ();
+
+};
+
+/// Decoded sprite image
+struct SpriteImage {
+
+	unsigned char* pixels; ///< Pixel data (nullptr for none)
+	int            width; ///< Width of the image
+	int            height; ///< Height of the image
+
+};
+
+/// Sprite images kept between levels
+class SpriteImageAsset : public Asset {
+
+	public:
+		std::vector<SpriteImage> images; ///< The images
+
+		~SpriteImageAsset ();
+
+		int getSize ();
+
+};
+
+/// Keeps decoded assets between levels. Assets are shared while in use, and
+/// kept afterwards until the memory budget requires room for others.
+class AssetCache {
+
+	private:
+		/// Cached asset
+		struct Entry {
+
+			Asset*                           asset; ///< The asset
+			int                              references; ///< Number of users
+			int                              size; ///< Size of the asset while unused, in bytes
+			std::list<std::string>::iterator unused; ///< Position in the list of unused assets
+
+		};
+
+		std::unordered_map<std::string, Entry> entries; ///< Assets, by key
+		std::list<std::string>                 unused; ///< Keys of unused assets, least recently used first
+		int                                    budget; ///< Memory budget for unused assets, in bytes
+		int                                    unusedSize; ///< Size of all unused assets, in bytes
+
+		void evict ();
+
+	public:
+		AssetCache  ();
+		~AssetCache ();
+
+		Asset* acquire   (const char* key);
+		Asset* add       (const char* key, Asset* asset);
+		void   release   (const char* key);
+		void   setBudget (int bytes);
+		void   clear     ();
+
+};
+
+
+// Variable
+
+EXTERN AssetCache assetCache; ///< Assets kept between levels
+
+#endif
+
@@ -19,7 +19,8 @@
  * the GNU General Public License, version 2.0
  *
  * @par Description:
- * Deals with files.
+ * Deals with files. Files opened for reading are read into memory in one go,
+ * so that parsing them does not need a library call per byte.
  *
  */
 
@@ -30,6 +31,7 @@
 #include "util.h"
 #include "io/log.h"
 
+#include <ctype.h>
 #include <string.h>
 #include <unistd.h>
 #include <miniz.h>
@@ -45,6 +47,14 @@
     #define LOWERCASE_FILENAMES
 #endif
 
+#ifndef _MSC_VER
+    #define DIRECTORY_INDEX
+    #include <dirent.h>
+#endif
+
+
+std::unordered_map<std::string, std::vector<unsigned char>> File::memoryFiles;
+
 
 /**
  * Try opening a file from the available paths.
@@ -54,21 +64,49 @@
  * @param write Whether or not the file can be written to
  */
 File::File (const char* name, int pathType, bool write) :
-	file(nullptr), filePath(nullptr), forWriting(write) {
+	file(nullptr), data(nullptr), size(0), position(0), filePath(nullptr), forWriting(write) {
 
 	Path* path = gamePaths.paths;
 
+	// Files held in memory take precedence
+	if (!write) {
+
+		std::unordered_map<std::string, std::vector<unsigned char>>::iterator it = memoryFiles.find(name);
+
+		if (it != memoryFiles.end()) {
+
+			filePath = createString(name);
+			size = it->second.size();
+			data = new unsigned char[size];
+			memcpy(data, it->second.data(), size);
+
+			LOG_DEBUG("Opened memory file: %s", name);
+
+			return;
+
+		}
+
+	}
+
 	while (path) {
 
 		// skip other paths
-		if (pathType != PATH_TYPE_ANY && (path->pathType & pathType) != pathType) {
+		if (!path->hasType(pathType)) {
 			path = path->next;
 			continue;
 		}
 
 		// only allow certain write paths
-		if (!write || (pathType & (PATH_TYPE_CONFIG|PATH_TYPE_TEMP)) > 0) {
-			if (open(path->path, name, write)) return;
+		if (!write) {
+			const char* realName = path->find(name);
+
+			if (realName && open(path->path, realName, false)) return;
+		} else if ((pathType & (PATH_TYPE_CONFIG|PATH_TYPE_TEMP)) > 0) {
+			if (open(path->path, name, true)) {
+				path->addFile(name);
+
+				return;
+			}
 		} else LOG_FATAL("Not allowed to write to %s", name);
 
 		path = path->next;
@@ -87,7 +125,9 @@ File::File (const char* name, int pathType, bool write) :
  */
 File::~File () {
 
-	fclose(file);
+	if (file) fclose(file);
+
+	delete[] data;
 
 	LOG_TRACE("Closed file: %s", filePath);
 
@@ -129,6 +169,8 @@ bool File::open (const char* path, const char* name, bool write) {
 	if (file) {
 		LOG_DEBUG("Opened file: %s", filePath);
 
+		if (!write) loadContents();
+
 		return true;
 	}
 
@@ -138,6 +180,115 @@ bool File::open (const char* path, const char* name, bool write) {
 }
 
 
+/**
+ * Read the whole file into memory, and close it.
+ */
+void File::loadContents () {
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (size < 0) size = 0;
+
+	data = new unsigned char[size];
+
+	int res = fread(data, 1, size, file);
+
+	if (res != size) {
+
+		LOG_ERROR("Could not read whole file %s (%d of %d bytes read)", filePath, res, size);
+
+		size = res;
+
+	}
+
+	fclose(file);
+	file = nullptr;
+
+}
+
+
+/**
+ * Read the next byte of the contents.
+ *
+ * @return The byte, or EOF at the end of the contents
+ */
+int File::readByte () {
+
+	if (position >= size) return EOF;
+
+	return data[position++];
+
+}
+
+
+/**
+ * Copy the next bytes of the contents.
+ *
+ * @param buffer Buffer to receive the bytes
+ * @param length Number of bytes to copy
+ *
+ * @return Number of bytes copied, which is smaller at the end of the contents
+ */
+int File::readData (void* buffer, int length) {
+
+	if (length > size - position) length = size - position;
+
+	if (length <= 0) return 0;
+
+	memcpy(buffer, data + position, length);
+	position += length;
+
+	return length;
+
+}
+
+
+/**
+ * Check that the file is open for writing.
+ *
+ * @return Whether or not the file can be written to
+ */
+bool File::canWrite () {
+
+	if (!forWriting) {
+		LOG_ERROR("File %s not opened for writing!", filePath);
+		return false;
+	}
+
+	return true;
+
+}
+
+
+/**
+ * Hold the contents of a file in memory, so that opening it for reading does
+ * not need a file on disk.
+ *
+ * @param name File name
+ * @param contents The contents
+ * @param length The length of the contents
+ */
+void File::setMemoryFile (const char* name, const unsigned char* contents, int length) {
+
+	memoryFiles[name].assign(contents, contents + length);
+
+}
+
+
+/**
+ * Forget a file held in memory.
+ *
+ * @param name File name
+ */
+void File::clearMemoryFile (const char* name) {
+
+	memoryFiles.erase(name);
+
+}
+
+
 /**
  * Get the size of the file.
  *
@@ -145,15 +296,21 @@ bool File::open (const char* path, const char* name, bool write) {
  */
 int File::getSize () {
 
-	int pos, size;
+	if (forWriting) {
 
-	pos = ftell(file);
+		int oldPos, fileSize;
 
-	fseek(file, 0, SEEK_END);
+		oldPos = ftell(file);
 
-	size = ftell(file);
+		fseek(file, 0, SEEK_END);
+
+		fileSize = ftell(file);
 
-	fseek(file, pos, SEEK_SET);
+		fseek(file, oldPos, SEEK_SET);
+
+		return fileSize;
+
+	}
 
 	return size;
 
@@ -167,7 +324,9 @@ int File::getSize () {
  */
 int File::tell () {
 
-	return ftell(file);
+	if (forWriting) return ftell(file);
+
+	return position;
 
 }
 
@@ -180,7 +339,24 @@ int File::tell () {
  */
 void File::seek (int offset, bool reset) {
 
-	fseek(file, offset, reset ? SEEK_SET: SEEK_CUR);
+	if (forWriting) {
+
+		fseek(file, offset, reset ? SEEK_SET: SEEK_CUR);
+
+		return;
+
+	}
+
+	// As with fseek, the location may go past the end, but not before the start
+	if (reset) {
+
+		if (offset >= 0) position = offset;
+
+	} else if (position + offset >= 0) {
+
+		position += offset;
+
+	}
 
 }
 
@@ -192,13 +368,15 @@ void File::seek (int offset, bool reset) {
  */
 unsigned char File::loadChar () {
 
-	return fgetc(file);
+	return readByte();
 
 }
 
 
 void File::storeChar (unsigned char val) {
 
+	if (!canWrite()) return;
+
 	fputc(val, file);
 
 }
@@ -213,8 +391,8 @@ unsigned short int File::loadShort () {
 
 	unsigned short int val;
 
-	val = fgetc(file);
-	val += fgetc(file) << 8;
+	val = readByte();
+	val += readByte() << 8;
 
 	return val;
 
@@ -247,6 +425,8 @@ unsigned short int File::loadShort (unsigned short int max) {
 
 void File::storeShort (unsigned short int val) {
 
+	if (!canWrite()) return;
+
 	fputc(val & 255, file);
 	fputc(val >> 8, file);
 
@@ -262,10 +442,10 @@ signed int File::loadInt () {
 
 	unsigned int val;
 
-	val = fgetc(file);
-	val += fgetc(file) << 8;
-	val += fgetc(file) << 16;
-	val += fgetc(file) << 24;
+	val = readByte();
+	val += readByte() << 8;
+	val += readByte() << 16;
+	val += readByte() << 24;
 
 	return *((signed int *)&val);
 
@@ -276,6 +456,8 @@ void File::storeInt (signed int val) {
 
 	unsigned int uval;
 
+	if (!canWrite()) return;
+
 	uval = *((unsigned int *)&val);
 
 	fputc(uval & 255, file);
@@ -288,10 +470,7 @@ void File::storeInt (signed int val) {
 
 void File::storeData (void* data, int length) {
 
-	if(!forWriting) {
-		LOG_ERROR("File %s not opened for writing!", filePath);
-		return;
-	}
+	if (!canWrite()) return;
 
 	fwrite (data, length, 1, file);
 
@@ -311,7 +490,7 @@ unsigned char * File::loadBlock (int length) {
 
 	buffer = new unsigned char[length];
 
-	int res = fread(buffer, 1, length, file);
+	int res = readData(buffer, length);
 
 	if (res != length)
 		LOG_ERROR("Could not read whole block (%d of %d bytes read)", res, length);
@@ -355,7 +534,7 @@ unsigned char* File::loadRLE (int length, bool checkSize) {
 		} else if (amount) { // copy
 			if (pos + amount >= length) break;
 
-			fread(buffer + pos, 1, amount, file);
+			readData(buffer + pos, amount);
 			pos += amount;
 		} else { // end marker
 			buffer[pos++] = loadChar();
@@ -384,10 +563,10 @@ void File::skipRLE () {
 
 	int next;
 
-	next = fgetc(file);
-	next += fgetc(file) << 8;
+	next = readByte();
+	next += readByte() << 8;
 
-	fseek(file, next, SEEK_CUR);
+	seek(next);
 
 }
 
@@ -404,14 +583,25 @@ unsigned char* File::loadLZ (int compressedLength, int length) {
 
 	unsigned char* compressedBuffer;
 	unsigned char* buffer;
-
-	compressedBuffer = loadBlock(compressedLength);
+	mz_ulong bufferLength = length;
 
 	buffer = new unsigned char[length];
 
-	uncompress(buffer, (unsigned long int *)&length, compressedBuffer, compressedLength);
+	if (!forWriting && (compressedLength >= 0) && (compressedLength <= size - position)) {
+
+		// Decompress straight from the contents
+		uncompress(buffer, &bufferLength, data + position, compressedLength);
+		position += compressedLength;
+
+	} else {
+
+		compressedBuffer = loadBlock(compressedLength);
+
+		uncompress(buffer, &bufferLength, compressedBuffer, compressedLength);
 
-	delete[] compressedBuffer;
+		delete[] compressedBuffer;
+
+	}
 
 	return buffer;
 
@@ -488,7 +678,7 @@ char * File::loadFileName () {
  */
 char * File::loadString (int length) {
 	char *string = new char[length + 1];
-	int res = fread(string, 1, length, file);
+	int res = readData(string, length);
 
 	if (res != length)
 		LOG_ERROR("Could not read whole string (%d of %d bytes read)", res, length);
@@ -580,7 +770,7 @@ unsigned char* File::loadPixels (int length, int key) {
 	// Four pixels are packed into the lower end of each byte
 	for (count = 0; count < length; count++) {
 
-		if (!(count & 3)) mask = fgetc(file);
+		if (!(count & 3)) mask = readByte();
 		pixels[count] = (mask >> (count & 3)) & 1;
 
 	}
@@ -604,7 +794,7 @@ unsigned char* File::loadPixels (int length, int key) {
 
 			// The unmasked portions are transparent, so no masked
 			// portion should be transparent.
-			while (pixels[count] == key) pixels[count] = fgetc(file);
+			while (pixels[count] == key) pixels[count] = readByte();
 
 		}
 
@@ -716,10 +906,56 @@ bool PathMgr::add(char* newPath, int newPathType) {
 
 	// Finally add
 	paths = new Path(paths, newPath, newPathType);
+	paths->index();
+
+	return true;
+}
+
+/**
+ * Re-read the contents of every directory, to find files added since.
+ */
+void PathMgr::refresh() {
+	for (Path* path = paths; path; path = path->next)
+		path->index();
+}
+
+/**
+ * Determine whether or not the directory indices can tell if a file is in any
+ * directory of the given kind.
+ *
+ * @param name File name
+ * @param pathType Kind of directory
+ *
+ * @return Whether or not has() can be used for the file
+ */
+bool PathMgr::isIndexed(const char* name, int pathType) {
+	// Names in subdirectories are not indexed
+	if (strchr(name, '/') || strchr(name, OJ_DIR_SEP)) return false;
+
+	for (Path* path = paths; path; path = path->next) {
+		if (path->hasType(pathType) && !path->isIndexed()) return false;
+	}
 
 	return true;
 }
 
+/**
+ * Determine whether or not a file is in any directory of the given kind,
+ * without opening it.
+ *
+ * @param name File name
+ * @param pathType Kind of directory
+ *
+ * @return Whether or not the file was found
+ */
+bool PathMgr::has(const char* name, int pathType) {
+	for (Path* path = paths; path; path = path->next) {
+		if (path->hasType(pathType) && path->isIndexed() && path->find(name)) return true;
+	}
+
+	return false;
+}
+
 
 /**
  * Create a new directory path object.
@@ -741,6 +977,7 @@ Path::Path (Path* newNext, char* newPath, int newPathType) {
 	next = newNext;
 	path = newPath;
 	pathType = newPathType;
+	indexed = false;
 
 }
 
@@ -754,3 +991,120 @@ Path::~Path () {
 	delete[] path;
 
 }
+
+
+/**
+ * Get the index key of a file name.
+ *
+ * @param name File name
+ *
+ * @return The file name in lowercase
+ */
+std::string Path::getKey (const char* name) {
+
+	std::string key(name);
+
+	for (char& c: key) c = tolower(c);
+
+	return key;
+
+}
+
+
+/**
+ * Determine whether or not the directory is of the given kind.
+ *
+ * @param type Kind of directory
+ *
+ * @return Whether or not the directory is of the kind
+ */
+bool Path::hasType (int type) {
+
+	return (type == PATH_TYPE_ANY) || ((pathType & type) == type);
+
+}
+
+
+/**
+ * Read the names of all files in the directory, so that opening a file
+ * does not need to try each spelling of its name.
+ */
+void Path::index () {
+
+	files.clear();
+	indexed = false;
+
+#ifdef DIRECTORY_INDEX
+	DIR* dir = opendir(path);
+
+	if (!dir) {
+
+		LOG_DEBUG("Could not index '%s', probing it instead", path);
+
+		return;
+
+	}
+
+	struct dirent* entry;
+
+	while ((entry = readdir(dir)) != nullptr) {
+
+		if (entry->d_name[0] != '.') addFile(entry->d_name);
+
+	}
+
+	closedir(dir);
+
+	indexed = true;
+
+	LOG_TRACE("Indexed %d files in '%s'", (int)files.size(), path);
+#endif
+
+}
+
+
+/**
+ * Add a file to the index of the directory.
+ *
+ * @param name File name
+ */
+void Path::addFile (const char* name) {
+
+	// Where names differ only by case, the first one found is used
+	files.emplace(getKey(name), name);
+
+}
+
+
+/**
+ * Determine whether or not the files in the directory are known.
+ *
+ * @return Whether or not the directory has been indexed
+ */
+bool Path::isIndexed () {
+
+	return indexed;
+
+}
+
+
+/**
+ * Find the name under which a file is stored in the directory.
+ *
+ * @param name File name, in any case
+ *
+ * @return The stored file name, the given name if the directory has not been
+ * indexed, or nullptr if the file is not in the directory
+ */
+const char* Path::find (const char* name) {
+
+	// Names in subdirectories are not indexed
+	if (!indexed || strchr(name, '/') || strchr(name, OJ_DIR_SEP)) return name;
+
+	std::unordered_map<std::string, std::string>::iterator it = files.find(getKey(name));
+
+	if (it == files.end()) return nullptr;
+
+	return it->second.c_str();
+
+}
@@ -28,6 +28,9 @@
 
 #include <stdio.h>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 // Classes
 
@@ -35,19 +38,32 @@ struct SDL_Surface;
 struct SDL_Color;
 
 /// File i/o
+/// Files opened for reading are read into memory whole, and parsed from there.
 class File {
 
 	private:
-		FILE* file;
-		char* filePath;
-		bool  forWriting;
+		static std::unordered_map<std::string, std::vector<unsigned char>> memoryFiles; ///< Contents of files that only exist in memory, by name
 
-		bool open (const char* path, const char* name, bool write);
+		FILE*          file; ///< Stream, while opening and when writing
+		unsigned char* data; ///< Contents, when reading
+		int            size; ///< Length of the contents
+		int            position; ///< Read location within the contents
+		char*          filePath;
+		bool           forWriting;
+
+		bool open         (const char* path, const char* name, bool write);
+		void loadContents ();
+		int  readByte     ();
+		int  readData     (void* buffer, int length);
+		bool canWrite     ();
 
 	public:
 		File                           (const char* name, int pathType, bool write = false);
 		~File                          ();
 
+		static void        setMemoryFile   (const char* name, const unsigned char* contents, int length);
+		static void        clearMemoryFile (const char* name);
+
 		int                getSize     ();
 		void               seek        (int offset, bool reset = false);
 		int                tell        ();
@@ -89,6 +105,12 @@ enum path_type {
 
 class Path {
 
+	private:
+		std::unordered_map<std::string, std::string> files; ///< Names of the files in the directory, by lowercase name
+		bool indexed; ///< Whether or not the files in the directory are known
+
+		static std::string getKey (const char* name);
+
 	public:
 		Path* next;      ///< Next path to check
 		char* path;      ///< Path
@@ -97,6 +119,12 @@ class Path {
 		Path  (Path* newNext, char* newPath, int newPathType);
 		~Path ();
 
+		bool        hasType   (int type);
+		void        index     ();
+		void        addFile   (const char* name);
+		bool        isIndexed ();
+		const char* find      (const char* name);
+
 };
 
 
@@ -107,6 +135,9 @@ class PathMgr {
 		~PathMgr();
 
 		bool add(char* newPath, int newPathType = PATH_TYPE_ANY);
+		void refresh();
+		bool isIndexed(const char* name, int pathType);
+		bool has(const char* name, int pathType);
 
 		Path* paths;
 
@@ -0,0 +1,575 @@
+/**
+ *
+ * @file blit.cpp
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ * @par Description:
+ * Copies 8-bit pixel data, skipping transparent pixels. Rows without a colour
+ * map are copied 16 pixels at a time with SSE2 or NEON, where available.
+ * Pixel data encoded as runs of opaque pixels is copied a run at a time.
+ *
+ */
+
+
+#include "blit.h"
+#include "video.h"
+
+#include "io/log.h"
+
+#include <algorithm>
+#include <string.h>
+
+#if OJ_BLIT_SSE2
+	#include <emmintrin.h>
+#elif OJ_BLIT_NEON
+	#include <arm_neon.h>
+#endif
+
+
+/**
+ * Copy a row of pixels, skipping those matching the key.
+ *
+ * @param src Source pixels
+ * @param dst Destination pixels
+ * @param width Number of pixels
+ * @param key Transparent pixel value
+ */
+static void blitKeyedRow (const unsigned char* src, unsigned char* dst, int width, unsigned char key) {
+
+	int x = 0;
+
+#if OJ_BLIT_SSE2
+	const __m128i keys = _mm_set1_epi8(key);
+
+	for (; x + 16 <= width; x += 16) {
+
+		__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+		__m128i old = _mm_loadu_si128(reinterpret_cast<__m128i*>(dst + x));
+		__m128i transparent = _mm_cmpeq_epi8(pixels, keys);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x),
+			_mm_or_si128(_mm_and_si128(transparent, old),
+				_mm_andnot_si128(transparent, pixels)));
+
+	}
+#elif OJ_BLIT_NEON
+	const uint8x16_t keys = vdupq_n_u8(key);
+
+	for (; x + 16 <= width; x += 16) {
+
+		uint8x16_t pixels = vld1q_u8(src + x);
+		uint8x16_t old = vld1q_u8(dst + x);
+
+		vst1q_u8(dst + x, vbslq_u8(vceqq_u8(pixels, keys), old, pixels));
+
+	}
+#endif
+
+	for (; x < width; x++) {
+
+		if (src[x] != key) dst[x] = src[x];
+
+	}
+
+}
+
+
+/**
+ * Copy a block of pixels, skipping those matching the key.
+ *
+ * @param src First source pixel
+ * @param srcPitch Bytes per source row
+ * @param dst First destination pixel
+ * @param dstPitch Bytes per destination row
+ * @param width Width of the block
+ * @param height Height of the block
+ * @param key Transparent pixel value (BLIT_NO_KEY for none)
+ * @param colours Map from source to destination pixel values (nullptr for none)
+ */
+void blitKeyed (const unsigned char* src, int srcPitch,
+	unsigned char* dst, int dstPitch, int width, int height,
+	int key, const unsigned char* colours) {
+
+	for (int y = 0; y < height; y++) {
+
+		if (colours) {
+
+			for (int x = 0; x < width; x++) {
+
+				if (src[x] != key) dst[x] = colours[src[x]];
+
+			}
+
+		} else if (key == BLIT_NO_KEY) {
+
+			memcpy(dst, src, width);
+
+		} else {
+
+			blitKeyedRow(src, dst, width, key);
+
+		}
+
+		src += srcPitch;
+		dst += dstPitch;
+
+	}
+
+}
+
+
+/**
+ * Copy a block of pixels, scaled, skipping those matching the key.
+ *
+ * Destination pixel (x, y) is taken from source pixel
+ * (DIV(firstX + x, scale), DIV(firstY + y, scale)), with the divisions
+ * replaced by stepping through the quotients and remainders.
+ *
+ * @param src Source pixels
+ * @param srcPitch Bytes per source row
+ * @param dst First destination pixel
+ * @param dstPitch Bytes per destination row
+ * @param width Width of the destination block
+ * @param height Height of the destination block
+ * @param firstX Scaled x-coordinate of the first source pixel
+ * @param firstY Scaled y-coordinate of the first source pixel
+ * @param scale The amount by which to scale the pixels
+ * @param key Transparent pixel value (BLIT_NO_KEY for none)
+ * @param colours Map from source to destination pixel values (nullptr for none)
+ */
+void blitKeyedScaled (const unsigned char* src, int srcPitch,
+	unsigned char* dst, int dstPitch, int width, int height,
+	int firstX, int firstY, fixed scale, int key, const unsigned char* colours) {
+
+	// Source pixels advanced per destination pixel
+	int step = F1 / scale;
+	int stepRemainder = F1 % scale;
+
+	int srcY = ITOF(firstY) / scale;
+	int srcYRemainder = ITOF(firstY) % scale;
+
+	for (int y = 0; y < height; y++) {
+
+		const unsigned char* srcRow = src + (srcPitch * srcY);
+		int srcX = ITOF(firstX) / scale;
+		int srcXRemainder = ITOF(firstX) % scale;
+
+		for (int x = 0; x < width; x++) {
+
+			unsigned char pixel = srcRow[srcX];
+
+			if (pixel != key) dst[x] = colours? colours[pixel]: pixel;
+
+			srcX += step;
+			srcXRemainder += stepRemainder;
+
+			if (srcXRemainder >= scale) {
+
+				srcX++;
+				srcXRemainder -= scale;
+
+			}
+
+		}
+
+		srcY += step;
+		srcYRemainder += stepRemainder;
+
+		if (srcYRemainder >= scale) {
+
+			srcY++;
+			srcYRemainder -= scale;
+
+		}
+
+		dst += dstPitch;
+
+	}
+
+}
+
+
+/**
+ * Encode pixel data as runs of opaque pixels.
+ *
+ * Each row is a series of spans, each consisting of the number of transparent
+ * pixels to skip, the number of opaque pixels that follow, and those pixels.
+ * Longer runs are split, as the counts are single bytes. Transparent pixels at
+ * the end of a row are not stored.
+ *
+ * @param src Source pixels, without padding
+ * @param width Width of the pixel data
+ * @param height Height of the pixel data
+ * @param key Transparent pixel value
+ * @param spans Filled with the spans (nullptr to only measure them)
+ * @param rows Filled with the offset of each row's spans, followed by the total size (nullptr to only measure them)
+ *
+ * @return Size of the spans, in bytes
+ */
+int encodeSpans (const unsigned char* src, int width, int height,
+	unsigned char key, unsigned char* spans, unsigned int* rows) {
+
+	int size = 0;
+
+	for (int y = 0; y < height; y++) {
+
+		const unsigned char* row = src + (width * y);
+		int x = 0;
+
+		if (rows) rows[y] = size;
+
+		while (x < width) {
+
+			int skip = 0;
+			int count = 0;
+
+			while ((x + skip < width) && (row[x + skip] == key) && (skip < 255)) skip++;
+
+			if (x + skip == width) break;
+
+			while ((x + skip + count < width) && (row[x + skip + count] != key) && (count < 255))
+				count++;
+
+			if (spans) {
+
+				spans[size] = skip;
+				spans[size + 1] = count;
+				memcpy(spans + size + 2, row + x + skip, count);
+
+			}
+
+			size += 2 + count;
+			x += skip + count;
+
+		}
+
+	}
+
+	if (rows) rows[height] = size;
+
+	return size;
+
+}
+
+
+/**
+ * Copy a block of pixels encoded as runs of opaque pixels.
+ *
+ * @param spans The spans, as produced by encodeSpans()
+ * @param rows Offsets of each row's spans, as produced by encodeSpans()
+ * @param firstX X-coordinate of the block within the pixel data
+ * @param firstY Y-coordinate of the block within the pixel data
+ * @param width Width of the block
+ * @param height Height of the block
+ * @param dst Destination of the block's first pixel
+ * @param dstPitch Bytes per destination row
+ * @param colours Map from source to destination pixel values (nullptr for none)
+ */
+void blitSpans (const unsigned char* spans, const unsigned int* rows,
+	int firstX, int firstY, int width, int height,
+	unsigned char* dst, int dstPitch, const unsigned char* colours) {
+
+	int lastX = firstX + width;
+
+	for (int y = firstY; y < firstY + height; y++) {
+
+		const unsigned char* span = spans + rows[y];
+		const unsigned char* end = spans + rows[y + 1];
+		int x = 0;
+
+		while (span < end) {
+
+			const unsigned char* pixels = span + 2;
+			int count = span[1];
+			int start, stop;
+
+			x += span[0];
+			span = pixels + count;
+
+			if (x >= lastX) break;
+
+			// Clip the run to the block
+			start = (x < firstX)? firstX: x;
+			stop = (x + count > lastX)? lastX: x + count;
+
+			if (start < stop) {
+
+				if (colours) {
+
+					for (int i = start; i < stop; i++)
+						dst[i - firstX] = colours[pixels[i - x]];
+
+				} else {
+
+					memcpy(dst + start - firstX, pixels + start - x, stop - start);
+
+				}
+
+			}
+
+			x += count;
+
+		}
+
+		dst += dstPitch;
+
+	}
+
+}
+
+
+/**
+ * Get the name of the vector kernel in use.
+ *
+ * @return The name
+ */
+const char* getBlitKernel () {
+
+#if OJ_BLIT_SSE2
+	return "SSE2";
+#elif OJ_BLIT_NEON
+	return "NEON";
+#else
+	return "scalar";
+#endif
+
+}
+
+
+/**
+ * Get the current timer value, in microseconds.
+ *
+ * @return Timer value
+ */
+static Uint64 getMicroseconds () {
+
+#if OJ_SDL3 || OJ_SDL2
+	Uint64 counts = SDL_GetPerformanceCounter();
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+
+	return ((counts / frequency) * 1000000) + (((counts % frequency) * 1000000) / frequency);
+#else
+	return SDL_GetTicks() * 1000;
+#endif
+
+}
+
+
+/**
+ * Calculate a checksum of the canvas, for comparing the results of blits.
+ *
+ * @return The checksum
+ */
+static unsigned int checksumCanvas () {
+
+	unsigned int sum = 0;
+
+	if (SDL_MUSTLOCK(canvas)) SDL_LockSurface(canvas);
+
+	for (int y = 0; y < canvasH; y++) {
+
+		unsigned char* row = static_cast<unsigned char*>(canvas->pixels) + (canvas->pitch * y);
+
+		for (int x = 0; x < canvasW; x++) sum = (sum * 31) + row[x];
+
+	}
+
+	if (SDL_MUSTLOCK(canvas)) SDL_UnlockSurface(canvas);
+
+	return sum;
+
+}
+
+
+/**
+ * Compare the engine's blits with SDL's, and with per-pixel division for
+ * scaled blits, on the canvas.
+ *
+ * @return Error code
+ */
+int benchmarkBlit () {
+
+	const int size = 64;
+	const int runs = 20000;
+	unsigned char pixels[size * size];
+	Uint64 start;
+	unsigned char* spans;
+	unsigned int rows[size + 1];
+	unsigned int sdlTime, engineTime, spanTime, divTime, steppedTime;
+	unsigned int sdlSum, engineSum, spanSum, divSum, steppedSum;
+	int i;
+
+	// Sprite-like data: an opaque disc on a transparent background
+	for (int y = 0; y < size; y++) {
+
+		for (int x = 0; x < size; x++) {
+
+			int dx = x - (size >> 1), dy = y - (size >> 1);
+
+			if ((dx * dx) + (dy * dy) < (size * size) >> 2) pixels[(y * size) + x] = (x + y) & 63;
+			else pixels[(y * size) + x] = 127;
+
+		}
+
+	}
+
+	SDL_Surface* sprite = video.createSurface(pixels, size, size);
+	video.enableColorKey(sprite, 127);
+	video.setClipRect(canvas, nullptr);
+
+
+	// Unscaled, through SDL
+
+	video.clearScreen(0);
+	start = getMicroseconds();
+
+	for (i = 0; i < runs; i++) {
+
+		SDL_Rect dst;
+		dst.x = ((i * 37) % (canvasW + size)) - size;
+		dst.y = ((i * 23) % (canvasH + size)) - size;
+
+		SDL_BlitSurface(sprite, nullptr, canvas, &dst);
+
+	}
+
+	sdlTime = getMicroseconds() - start;
+	sdlSum = checksumCanvas();
+
+
+	// Unscaled, through the engine
+
+	video.clearScreen(0);
+	start = getMicroseconds();
+
+	for (i = 0; i < runs; i++)
+		video.blitSurface(sprite, nullptr, canvas,
+			((i * 37) % (canvasW + size)) - size,
+			((i * 23) % (canvasH + size)) - size);
+
+	engineTime = getMicroseconds() - start;
+	engineSum = checksumCanvas();
+
+
+	// Unscaled, a run of opaque pixels at a time
+
+	spans = new unsigned char[encodeSpans(pixels, size, size, 127, nullptr, nullptr)];
+	encodeSpans(pixels, size, size, 127, spans, rows);
+
+	if (SDL_MUSTLOCK(canvas)) SDL_LockSurface(canvas);
+
+	memset(canvas->pixels, 0, canvas->pitch * canvasH);
+	start = getMicroseconds();
+
+	for (i = 0; i < runs; i++) {
+
+		int x = ((i * 37) % (canvasW + size)) - size;
+		int y = ((i * 23) % (canvasH + size)) - size;
+		int firstX = (x < 0)? -x: 0;
+		int firstY = (y < 0)? -y: 0;
+		int width = std::min(size, canvasW - x) - firstX;
+		int height = std::min(size, canvasH - y) - firstY;
+
+		if ((width <= 0) || (height <= 0)) continue;
+
+		blitSpans(spans, rows, firstX, firstY, width, height,
+			static_cast<unsigned char*>(canvas->pixels) + (canvas->pitch * (y + firstY)) + x + firstX,
+			canvas->pitch, nullptr);
+
+	}
+
+	spanTime = getMicroseconds() - start;
+
+	if (SDL_MUSTLOCK(canvas)) SDL_UnlockSurface(canvas);
+
+	spanSum = checksumCanvas();
+
+	delete[] spans;
+
+
+	// Scaled, with a division per pixel
+
+	if (SDL_MUSTLOCK(canvas)) SDL_LockSurface(canvas);
+
+	memset(canvas->pixels, 0, canvas->pitch * canvasH);
+	start = getMicroseconds();
+
+	for (i = 0; i < runs; i++) {
+
+		fixed scale = F1 + ((i & 7) << 7);
+		int width = std::min(FTOI(size * scale), canvasW);
+		int height = std::min(FTOI(size * scale), canvasH);
+
+		for (int y = 0; y < height; y++) {
+
+			unsigned char* srcRow = pixels + (size * DIV(y, scale));
+			unsigned char* dstRow = static_cast<unsigned char*>(canvas->pixels) + (canvas->pitch * y);
+
+			for (int x = 0; x < width; x++) {
+
+				unsigned char pixel = srcRow[DIV(x, scale)];
+				if (pixel != 127) dstRow[x] = pixel;
+
+			}
+
+		}
+
+	}
+
+	divTime = getMicroseconds() - start;
+
+	if (SDL_MUSTLOCK(canvas)) SDL_UnlockSurface(canvas);
+
+	divSum = checksumCanvas();
+
+
+	// Scaled, stepping through the source
+
+	if (SDL_MUSTLOCK(canvas)) SDL_LockSurface(canvas);
+
+	memset(canvas->pixels, 0, canvas->pitch * canvasH);
+	start = getMicroseconds();
+
+	for (i = 0; i < runs; i++) {
+
+		fixed scale = F1 + ((i & 7) << 7);
+
+		blitKeyedScaled(pixels, size,
+			static_cast<unsigned char*>(canvas->pixels), canvas->pitch,
+			std::min(FTOI(size * scale), canvasW), std::min(FTOI(size * scale), canvasH),
+			0, 0, scale, 127, nullptr);
+
+	}
+
+	steppedTime = getMicroseconds() - start;
+
+	if (SDL_MUSTLOCK(canvas)) SDL_UnlockSurface(canvas);
+
+	steppedSum = checksumCanvas();
+
+
+	video.destroySurface(sprite);
+
+	LOG_INFO("Blit benchmark, %d blits of %dx%d pixels, %s kernel:", runs, size, size, getBlitKernel());
+	LOG_INFO("  unscaled: SDL %u us, engine %u us, spans %u us", sdlTime, engineTime, spanTime);
+	LOG_INFO("  scaled: per-pixel division %u us, stepped %u us", divTime, steppedTime);
+
+	if ((sdlSum != engineSum) || (sdlSum != spanSum) || (divSum != steppedSum)) {
+
+		LOG_ERROR("Blit results differ");
+
+		return E_DATA;
+
+	}
+
+	return E_NONE;
+
+}
+
@@ -0,0 +1,52 @@
+/**
+ *
+ * @file blit.h
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ */
+
+#ifndef OJ_BLIT_H
+#define OJ_BLIT_H
+
+
+#include "OpenJazz.h"
+
+
+// Constants
+
+// Vector kernels, when the target supports them
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define OJ_BLIT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define OJ_BLIT_NEON 1
+#endif
+
+/// Key value for pixel data without transparency
+#define BLIT_NO_KEY -1
+
+
+// Functions
+
+void blitKeyed       (const unsigned char* src, int srcPitch,
+	unsigned char* dst, int dstPitch, int width, int height,
+	int key, const unsigned char* colours);
+void blitKeyedScaled (const unsigned char* src, int srcPitch,
+	unsigned char* dst, int dstPitch, int width, int height,
+	int firstX, int firstY, fixed scale, int key, const unsigned char* colours);
+int  encodeSpans     (const unsigned char* src, int width, int height,
+	unsigned char key, unsigned char* spans, unsigned int* rows);
+void blitSpans       (const unsigned char* spans, const unsigned int* rows,
+	int firstX, int firstY, int width, int height,
+	unsigned char* dst, int dstPitch, const unsigned char* colours);
+const char* getBlitKernel ();
+int  benchmarkBlit   ();
+
+#endif
+
@@ -42,6 +42,7 @@ void Font::commonSetup() {
 	nCharacters = MAX_FONT_CHARS;
 	memset(atlasRects, 0, sizeof(atlasRects));
 	memset(map, INVALID_FONT_CHAR, sizeof(map));
+	mapped = false;
 }
 
 void Font::cleanMapping() {
@@ -52,6 +53,18 @@ void Font::cleanMapping() {
 	}
 }
 
+/**
+ * Draw a symbol to the canvas.
+ *
+ * @param c Index of the symbol
+ * @param x The x-coordinate at which to draw the symbol
+ * @param y The y-coordinate at which to draw the symbol
+ */
+void Font::drawCharacter(unsigned int c, int x, int y) {
+	video.blitSurface(characterAtlas, &atlasRects[c], canvas, x, y,
+		mapped ? colours : nullptr);
+}
+
 /**
  * Load a font from the given .0FN file.
  *
@@ -480,7 +493,7 @@ Point Font::showString (const char* string, int x, int y,
 			SDL_Rect dst = { xOffset, yOffset, 0, 0 };
 
 			// Draw the character to the screen
-			SDL_BlitSurface(characterAtlas, &atlasRects[c], canvas, &dst);
+			drawCharacter(c, dst.x, dst.y);
 
 			xOffset += atlasRects[c].w + normalPadding;
 		}
@@ -525,7 +538,7 @@ int Font::showSceneString (const unsigned char* string, int x, int y) {
 		int c = string[i];
 
 		// Draw the character to the screen
-		SDL_BlitSurface(characterAtlas, &atlasRects[c], canvas, &dst);
+		drawCharacter(c, dst.x, dst.y);
 
 		offset += atlasRects[c].w + sceneStringPadding;
 	}
@@ -558,7 +571,7 @@ void Font::showNumber (int n, int x, int y) {
 		dst.x = x - atlasRects[c].w;
 
 		// Draw 0 to the screen
-		SDL_BlitSurface(characterAtlas, &atlasRects[c], canvas, &dst);
+		drawCharacter(c, dst.x, dst.y);
 
 		return;
 	}
@@ -581,7 +594,7 @@ void Font::showNumber (int n, int x, int y) {
 		dst.x = offset;
 
 		// Draw the digit to the screen
-		SDL_BlitSurface(characterAtlas, &atlasRects[c], canvas, &dst);
+		drawCharacter(c, dst.x, dst.y);
 
 		count /= 10;
 	}
@@ -595,7 +608,7 @@ void Font::showNumber (int n, int x, int y) {
 		dst.x = offset - atlasRects[c].w;
 
 		// Draw the negative sign to the screen
-		SDL_BlitSurface(characterAtlas, &atlasRects[c], canvas, &dst);
+		drawCharacter(c, dst.x, dst.y);
 	}
 }
 
@@ -621,6 +634,9 @@ void Font::mapPalette (int start, int length, int newStart, int newLength) {
 	}
 
 	video.setSurfacePalette(characterAtlas, palette, start, length);
+
+	video.getPaletteMap(characterAtlas, colours);
+	mapped = true;
 }
 
 
@@ -631,6 +647,7 @@ void Font::restorePalette () {
 	if (!isOk) return;
 
 	video.restoreSurfacePalette(characterAtlas);
+	mapped = false;
 }
 
 
@@ -673,6 +690,18 @@ int Font::getStringWidth (const char *string) {
 }
 
 
+/**
+ * Get the memory used by the font's symbol images.
+ *
+ * @return The size, in bytes
+ */
+int Font::getSize () const {
+	if (!isOk) return 0;
+
+	return characterAtlas->pitch * characterAtlas->h;
+}
+
+
 /**
  * Get the height of a given string.
  *
@@ -38,6 +38,7 @@ class Font {
 	private:
 		void           commonSetup();
 		void           cleanMapping();
+		void           drawCharacter(unsigned int c, int x, int y);
 		SDL_Surface   *characterAtlas; ///< Symbol images
 		SDL_Rect       atlasRects[MAX_FONT_CHARS]; ///< Symbol positions
 		bool           isOk; ///< Font is loaded and usable
@@ -45,6 +46,8 @@ class Font {
 		unsigned char  spaceWidth; ///< Horizontal spacing of displayed characters
 		unsigned char  lineHeight; ///< Vertical spacing of displayed characters
 		unsigned int   map[MAX_FONT_CHARS]; ///< Maps ASCII values to symbol indices
+		unsigned char  colours[MAX_PALETTE_COLORS]; ///< Palette mapping of the symbol images
+		bool           mapped; ///< Whether or not the palette mapping is in use
 
 	public:
 		explicit Font(const char *fileName);
@@ -63,6 +66,7 @@ class Font {
 		int   getStringWidth      (const char *string);
 		int   getStringHeight     (const char *string);
 		int   getSceneStringWidth (const unsigned char *string);
+		int   getSize             () const;
 #ifdef DEBUG_FONTS
 		void  saveAtlasAsBMP      (const char *fileName);
 #endif
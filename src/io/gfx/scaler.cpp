@@ -0,0 +1,1012 @@
+
+/**
+ *
+ * @file scaler.cpp
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ * @par Description:
+ * Scales 8-bit pixel data with the Scale2x/Scale3x/Scale4x rules, and expands
+ * the result through a palette in the same pass. The rules only compare
+ * pixels, so they are applied to palette indices, a row at a time, and only
+ * the finished rows are expanded into the destination.
+ *
+ * The hqx scalers pick an interpolation rule for each corner of a pixel from
+ * the pattern of its neighbours that differ from it. Whether two colours are
+ * similar is decided in YUV space, as in hqx, but as there are only 256
+ * colours, the decisions are kept in a table that is only updated for colours
+ * that change.
+ *
+ */
+
+
+#include "scaler.h"
+#include "blit.h"
+#include "video.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#if OJ_BLIT_SSE2
+	#include <emmintrin.h>
+#elif OJ_BLIT_NEON
+	#include <arm_neon.h>
+#endif
+
+
+static std::vector<unsigned char> scaledRows; ///< Scaled pixel values of one source row
+static std::vector<unsigned char> doubled; ///< Pixel values at double size, for Scale4x
+
+static SDL_Color     similarityPalette[MAX_PALETTE_COLORS]; ///< Colours the similarity table was made for
+static bool          similarityValid = false; ///< Whether the similarity table has been made
+static unsigned char similarity[MAX_PALETTE_COLORS][MAX_PALETTE_COLORS >> 3]; ///< Bit set for each pair of similar colours
+
+/// Interpolation rules for the corner of a pixel, for hqx. The neighbours are
+/// named as seen from the top-left corner: the diagonal, vertical and
+/// horizontal neighbours are above left, above and left of the pixel.
+enum {
+
+	HQ_E, ///< The pixel's own colour
+	HQ_A, ///< Blended with the diagonal neighbour
+	HQ_D, ///< Blended with the horizontal neighbour
+	HQ_B, ///< Blended with the vertical neighbour
+	HQ_DB, ///< Blended with the horizontal and vertical neighbours, which are similar to the pixel
+	HQ_AB, ///< Blended with the diagonal and vertical neighbours
+	HQ_AD, ///< Blended with the diagonal and horizontal neighbours
+	HQ_LINE_B, ///< On an edge that carries on past the vertical neighbour
+	HQ_LINE_D, ///< On an edge that carries on past the horizontal neighbour
+	HQ_MILD, ///< Blended a little across an edge
+	HQ_STRONG, ///< Blended strongly across a diagonal edge
+	HQ_SOFT, ///< Blended very little across an edge
+	HQ_EDGE_OR_E, ///< HQ_EDGE if the horizontal and vertical neighbours are similar, otherwise HQ_E
+	HQ_SOFT_OR_E, ///< HQ_SOFT if the horizontal and vertical neighbours are similar, otherwise HQ_E
+	HQ_STRONG_OR_E, ///< HQ_STRONG if the horizontal and vertical neighbours are similar, otherwise HQ_E
+	HQ_EDGE_OR_A, ///< HQ_EDGE if the horizontal and vertical neighbours are similar, otherwise HQ_A
+	HQ_MILD_OR_A, ///< HQ_MILD if the horizontal and vertical neighbours are similar, otherwise HQ_A
+	HQ_STRONG_OR_A, ///< HQ_STRONG if the horizontal and vertical neighbours are similar, otherwise HQ_A
+	HQ_LINE_B_OR_D, ///< HQ_LINE_B if the vertical neighbour is similar to the one right of the pixel, otherwise HQ_D
+	HQ_LINE_D_OR_B, ///< HQ_LINE_D if the horizontal neighbour is similar to the one below the pixel, otherwise HQ_B
+	HQ_EDGE ///< Blended across an edge
+
+};
+
+/// hq2x's interpolation rule for the top-left corner of a pixel, for each
+/// pattern of neighbours that differ from it. Bits 0 to 7 of the pattern are
+/// set for the neighbours above left, above, above right, left, right, below
+/// left, below and below right. The other corners use the same table, with
+/// the neighbours turned around the pixel.
+static const unsigned char hqRules[256] = {
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3, 15, 12, 5,  3, 17, 13,
+	4, 4, 6, 18, 4, 4, 6, 18, 5,  3, 12, 12, 5,  3,  1, 12,
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3, 17, 13, 5,  3, 16, 14,
+	4, 4, 6, 18, 4, 4, 6, 18, 5,  3, 16, 12, 5,  3,  1, 14,
+	4, 4, 6,  2, 4, 4, 6,  2, 5, 19, 12, 12, 5, 19, 16, 12,
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3, 16, 12, 5,  3, 16, 12,
+	4, 4, 6,  2, 4, 4, 6,  2, 5, 19,  1, 12, 5, 19,  1, 14,
+	4, 4, 6,  2, 4, 4, 6, 18, 5,  3, 16, 12, 5, 19,  1, 14,
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3, 15, 12, 5,  3, 17, 13,
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3, 16, 12, 5,  3, 16, 12,
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3, 17, 13, 5,  3, 16, 14,
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3, 16, 13, 5,  3,  1, 14,
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3, 16, 12, 5,  3, 16, 13,
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3, 16, 12, 5,  3,  1, 12,
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3, 16, 12, 5,  3,  1, 14,
+	4, 4, 6,  2, 4, 4, 6,  2, 5,  3,  1, 12, 5,  3,  1, 14
+};
+
+/// Positions of the neighbours in the order of the pattern bits, as seen from
+/// each corner (top left, top right, bottom right, bottom left). Positions
+/// count across the 3x3 area, from the top left.
+static const int hqFrames[4][8] = {
+	{0, 1, 2, 3, 5, 6, 7, 8},
+	{2, 5, 8, 1, 7, 0, 3, 6},
+	{8, 7, 6, 5, 3, 2, 1, 0},
+	{6, 3, 0, 7, 1, 8, 5, 2}
+};
+
+
+/**
+ * Apply the Scale2x rules to one pixel.
+ *
+ * @param b Pixel above
+ * @param d Pixel to the left
+ * @param e The pixel
+ * @param f Pixel to the right
+ * @param h Pixel below
+ * @param out0 Receives the upper two scaled pixels
+ * @param out1 Receives the lower two scaled pixels
+ */
+static inline void scale2xPixel (unsigned char b, unsigned char d, unsigned char e,
+	unsigned char f, unsigned char h, unsigned char* out0, unsigned char* out1) {
+
+	if ((b != h) && (d != f)) {
+
+		out0[0] = (d == b)? d: e;
+		out0[1] = (b == f)? f: e;
+		out1[0] = (d == h)? d: e;
+		out1[1] = (h == f)? f: e;
+
+	} else {
+
+		out0[0] = out0[1] = out1[0] = out1[1] = e;
+
+	}
+
+}
+
+
+/**
+ * Apply the Scale2x rules to a row of pixels. Pixels beyond the edges are taken
+ * to be the same as those at the edges.
+ *
+ * @param above Row above
+ * @param row The row
+ * @param below Row below
+ * @param out0 Receives the upper scaled row
+ * @param out1 Receives the lower scaled row
+ * @param width Number of pixels in the row
+ */
+static void scale2xRow (const unsigned char* above, const unsigned char* row,
+	const unsigned char* below, unsigned char* out0, unsigned char* out1, int width) {
+
+	int x;
+
+	scale2xPixel(above[0], row[0], row[0], row[(width > 1)? 1: 0], below[0], out0, out1);
+
+	if (width == 1) return;
+
+	x = 1;
+
+#if OJ_BLIT_SSE2
+	const __m128i ones = _mm_set1_epi8(-1);
+
+	for (; x + 17 <= width; x += 16) {
+
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x));
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1));
+		__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+		__m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1));
+		__m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x));
+
+		__m128i edge = _mm_andnot_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(b, h), _mm_cmpeq_epi8(d, f)), ones);
+
+		__m128i m0 = _mm_and_si128(edge, _mm_cmpeq_epi8(d, b));
+		__m128i m1 = _mm_and_si128(edge, _mm_cmpeq_epi8(b, f));
+		__m128i m2 = _mm_and_si128(edge, _mm_cmpeq_epi8(d, h));
+		__m128i m3 = _mm_and_si128(edge, _mm_cmpeq_epi8(h, f));
+
+		__m128i e0 = _mm_or_si128(_mm_and_si128(m0, d), _mm_andnot_si128(m0, e));
+		__m128i e1 = _mm_or_si128(_mm_and_si128(m1, f), _mm_andnot_si128(m1, e));
+		__m128i e2 = _mm_or_si128(_mm_and_si128(m2, d), _mm_andnot_si128(m2, e));
+		__m128i e3 = _mm_or_si128(_mm_and_si128(m3, f), _mm_andnot_si128(m3, e));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out0 + (x << 1)), _mm_unpacklo_epi8(e0, e1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out0 + (x << 1) + 16), _mm_unpackhi_epi8(e0, e1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out1 + (x << 1)), _mm_unpacklo_epi8(e2, e3));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out1 + (x << 1) + 16), _mm_unpackhi_epi8(e2, e3));
+
+	}
+#elif OJ_BLIT_NEON
+	for (; x + 17 <= width; x += 16) {
+
+		uint8x16_t b = vld1q_u8(above + x);
+		uint8x16_t d = vld1q_u8(row + x - 1);
+		uint8x16_t e = vld1q_u8(row + x);
+		uint8x16_t f = vld1q_u8(row + x + 1);
+		uint8x16_t h = vld1q_u8(below + x);
+		uint8x16x2_t upper, lower;
+
+		uint8x16_t edge = vmvnq_u8(vorrq_u8(vceqq_u8(b, h), vceqq_u8(d, f)));
+
+		upper.val[0] = vbslq_u8(vandq_u8(edge, vceqq_u8(d, b)), d, e);
+		upper.val[1] = vbslq_u8(vandq_u8(edge, vceqq_u8(b, f)), f, e);
+		lower.val[0] = vbslq_u8(vandq_u8(edge, vceqq_u8(d, h)), d, e);
+		lower.val[1] = vbslq_u8(vandq_u8(edge, vceqq_u8(h, f)), f, e);
+
+		vst2q_u8(out0 + (x << 1), upper);
+		vst2q_u8(out1 + (x << 1), lower);
+
+	}
+#endif
+
+	for (; x < width - 1; x++)
+		scale2xPixel(above[x], row[x - 1], row[x], row[x + 1], below[x], out0 + (x << 1), out1 + (x << 1));
+
+	scale2xPixel(above[x], row[x - 1], row[x], row[x], below[x], out0 + (x << 1), out1 + (x << 1));
+
+}
+
+
+/**
+ * Apply the Scale3x rules to a row of pixels. Pixels beyond the edges are taken
+ * to be the same as those at the edges.
+ *
+ * @param above Row above
+ * @param row The row
+ * @param below Row below
+ * @param out0 Receives the upper scaled row
+ * @param out1 Receives the middle scaled row
+ * @param out2 Receives the lower scaled row
+ * @param width Number of pixels in the row
+ */
+static void scale3xRow (const unsigned char* above, const unsigned char* row,
+	const unsigned char* below, unsigned char* out0, unsigned char* out1,
+	unsigned char* out2, int width) {
+
+	for (int x = 0; x < width; x++) {
+
+		int left = (x > 0)? x - 1: x;
+		int right = (x < width - 1)? x + 1: x;
+
+		unsigned char a = above[left], b = above[x], c = above[right];
+		unsigned char d = row[left], e = row[x], f = row[right];
+		unsigned char g = below[left], h = below[x], i = below[right];
+
+		if ((b != h) && (d != f)) {
+
+			out0[0] = (d == b)? d: e;
+			out0[1] = (((d == b) && (e != c)) || ((b == f) && (e != a)))? b: e;
+			out0[2] = (b == f)? f: e;
+			out1[0] = (((d == b) && (e != g)) || ((d == h) && (e != a)))? d: e;
+			out1[1] = e;
+			out1[2] = (((b == f) && (e != i)) || ((h == f) && (e != c)))? f: e;
+			out2[0] = (d == h)? d: e;
+			out2[1] = (((d == h) && (e != i)) || ((h == f) && (e != g)))? h: e;
+			out2[2] = (h == f)? f: e;
+
+		} else {
+
+			out0[0] = out0[1] = out0[2] = e;
+			out1[0] = out1[1] = out1[2] = e;
+			out2[0] = out2[1] = out2[2] = e;
+
+		}
+
+		out0 += 3;
+		out1 += 3;
+		out2 += 3;
+
+	}
+
+}
+
+
+/**
+ * Look up a row of pixel values in the palette.
+ *
+ * @param src Pixel values
+ * @param dst Destination pixels
+ * @param width Number of pixels
+ * @param colours Destination pixel for each pixel value (nullptr to copy the
+ * values, with 1 byte per pixel)
+ */
+template <typename T>
+static inline void expandRow (const unsigned char* src, T* dst, int width, const unsigned int* colours) {
+
+	if (!colours) {
+
+		memcpy(dst, src, width);
+
+		return;
+
+	}
+
+	for (int x = 0; x < width; x++) dst[x] = colours[src[x]];
+
+}
+
+
+/**
+ * Scale a block of pixel values by two or three, or copy it, and expand it
+ * through the palette.
+ *
+ * @param factor Scaling factor (1 to 3)
+ * @param src Source pixel values
+ * @param srcPitch Bytes per source row
+ * @param width Width of the source block
+ * @param height Height of the source block
+ * @param dst Destination pixels
+ * @param dstPitch Bytes per destination row
+ * @param colours Destination pixel for each pixel value
+ */
+template <typename T>
+static void scaleRows (int factor, const unsigned char* src, int srcPitch,
+	int width, int height, unsigned char* dst, int dstPitch, const unsigned int* colours) {
+
+	int rowLength = width * factor;
+
+	if (static_cast<int>(scaledRows.size()) < rowLength * factor) scaledRows.resize(rowLength * factor);
+
+	unsigned char* out = scaledRows.data();
+
+	for (int y = 0; y < height; y++) {
+
+		const unsigned char* row = src + (srcPitch * y);
+		const unsigned char* above = (y > 0)? row - srcPitch: row;
+		const unsigned char* below = (y < height - 1)? row + srcPitch: row;
+
+		if (factor == 1) {
+
+			expandRow(row, reinterpret_cast<T*>(dst), width, colours);
+			dst += dstPitch;
+
+			continue;
+
+		}
+
+		if (factor == 2) scale2xRow(above, row, below, out, out + rowLength, width);
+		else scale3xRow(above, row, below, out, out + rowLength, out + (rowLength << 1), width);
+
+		for (int count = 0; count < factor; count++) {
+
+			expandRow(out + (rowLength * count), reinterpret_cast<T*>(dst), rowLength, colours);
+			dst += dstPitch;
+
+		}
+
+	}
+
+}
+
+
+/**
+ * Scale a block of pixel values and expand it through the palette.
+ *
+ * @param factor Scaling factor (1 to 4)
+ * @param src Source pixel values
+ * @param srcPitch Bytes per source row
+ * @param width Width of the source block
+ * @param height Height of the source block
+ * @param dst Destination pixels
+ * @param dstPitch Bytes per destination row
+ * @param colours Destination pixel for each pixel value
+ */
+template <typename T>
+static void scaleBlock (int factor, const unsigned char* src, int srcPitch,
+	int width, int height, unsigned char* dst, int dstPitch, const unsigned int* colours) {
+
+	if (factor < 4) {
+
+		scaleRows<T>(factor, src, srcPitch, width, height, dst, dstPitch, colours);
+
+		return;
+
+	}
+
+	// Scale4x is Scale2x applied twice. The first pass only needs pixel values.
+	int doubledPitch = width << 1;
+
+	if (static_cast<int>(doubled.size()) < doubledPitch * (height << 1)) doubled.resize(doubledPitch * (height << 1));
+
+	for (int y = 0; y < height; y++) {
+
+		const unsigned char* row = src + (srcPitch * y);
+
+		scale2xRow((y > 0)? row - srcPitch: row, row, (y < height - 1)? row + srcPitch: row,
+			doubled.data() + (doubledPitch * (y << 1)),
+			doubled.data() + (doubledPitch * ((y << 1) + 1)), width);
+
+	}
+
+	scaleRows<T>(2, doubled.data(), doubledPitch, doubledPitch, height << 1, dst, dstPitch, colours);
+
+}
+
+
+/**
+ * Update the table of similar colours, for the colours that have changed.
+ *
+ * @param palette The new colours
+ * @param first Index of the first colour
+ * @param amount Number of colours
+ */
+void updateSimilarity (const SDL_Color* palette, int first, int amount) {
+
+	int y[MAX_PALETTE_COLORS], u[MAX_PALETTE_COLORS], v[MAX_PALETTE_COLORS];
+	bool changed[MAX_PALETTE_COLORS];
+	bool anyChanged = false;
+
+	for (int count = 0; count < MAX_PALETTE_COLORS; count++) changed[count] = !similarityValid;
+
+	for (int count = 0; count < amount; count++) {
+
+		SDL_Color* colour = similarityPalette + first + count;
+
+		if (similarityValid && (colour->r == palette[count].r) &&
+			(colour->g == palette[count].g) && (colour->b == palette[count].b))
+			continue;
+
+		*colour = palette[count];
+		changed[first + count] = true;
+		anyChanged = true;
+
+	}
+
+	if (similarityValid && !anyChanged) return;
+
+	similarityValid = true;
+
+	for (int count = 0; count < MAX_PALETTE_COLORS; count++) {
+
+		const SDL_Color* colour = similarityPalette + count;
+
+		y[count] = ((299 * colour->r) + (587 * colour->g) + (114 * colour->b)) / 1000;
+		u[count] = ((-169 * colour->r) - (331 * colour->g) + (500 * colour->b)) / 1000;
+		v[count] = ((500 * colour->r) - (419 * colour->g) - (81 * colour->b)) / 1000;
+
+	}
+
+	for (int i = 0; i < MAX_PALETTE_COLORS; i++) {
+
+		if (!changed[i]) continue;
+
+		for (int j = 0; j < MAX_PALETTE_COLORS; j++) {
+
+			// The thresholds used by hqx
+			bool similar = (abs(y[i] - y[j]) <= 48) && (abs(u[i] - u[j]) <= 7) &&
+				(abs(v[i] - v[j]) <= 6);
+
+			if (similar) {
+
+				similarity[i][j >> 3] |= 1 << (j & 7);
+				similarity[j][i >> 3] |= 1 << (i & 7);
+
+			} else {
+
+				similarity[i][j >> 3] &= ~(1 << (j & 7));
+				similarity[j][i >> 3] &= ~(1 << (i & 7));
+
+			}
+
+		}
+
+	}
+
+}
+
+
+/**
+ * Determine whether two colours differ noticeably.
+ *
+ * @param a Pixel value of the first colour
+ * @param b Pixel value of the second colour
+ *
+ * @return Whether or not the colours differ
+ */
+static inline bool differ (unsigned char a, unsigned char b) {
+
+	return !((similarity[a][b >> 3] >> (b & 7)) & 1);
+
+}
+
+
+/**
+ * Blend colours with 8 bits per channel, in any order.
+ *
+ * @param c1 First colour
+ * @param w1 Weight of the first colour
+ * @param c2 Second colour
+ * @param w2 Weight of the second colour
+ * @param c3 Third colour
+ * @param w3 Weight of the third colour (the weights add up to 16)
+ *
+ * @return The blended colour
+ */
+static inline unsigned int mix (unsigned int c1, int w1, unsigned int c2, int w2,
+	unsigned int c3 = 0, int w3 = 0) {
+
+	unsigned int even = (((c1 & 0xFF00FF) * w1) + ((c2 & 0xFF00FF) * w2) + ((c3 & 0xFF00FF) * w3)) >> 4;
+	unsigned int odd = ((((c1 >> 8) & 0xFF00FF) * w1) + (((c2 >> 8) & 0xFF00FF) * w2) + (((c3 >> 8) & 0xFF00FF) * w3)) >> 4;
+
+	return (even & 0xFF00FF) | ((odd & 0xFF00FF) << 8);
+
+}
+
+
+/**
+ * Determine whether a channel mask covers exactly one byte of a pixel, as mix()
+ * needs.
+ *
+ * @param mask Channel mask
+ *
+ * @return Whether or not the channel is a whole byte
+ */
+static inline bool isByteChannel (unsigned int mask) {
+
+	return (mask == 0xFF) || (mask == 0xFF00) || (mask == 0xFF0000) || (mask == 0xFF000000);
+
+}
+
+
+/**
+ * Pick the interpolation rule for one corner of a pixel, where it depends on
+ * how the neighbours compare with each other.
+ *
+ * @param rule Rule from the table
+ * @param b Vertical neighbour at the corner
+ * @param d Horizontal neighbour at the corner
+ * @param f Neighbour opposite the horizontal one
+ * @param h Neighbour opposite the vertical one
+ *
+ * @return Rule, without conditions
+ */
+static inline int hqResolve (int rule, unsigned char b, unsigned char d,
+	unsigned char f, unsigned char h) {
+
+	switch (rule) {
+
+		case HQ_EDGE_OR_E: return differ(b, d)? HQ_E: HQ_EDGE;
+		case HQ_SOFT_OR_E: return differ(b, d)? HQ_E: HQ_SOFT;
+		case HQ_STRONG_OR_E: return differ(b, d)? HQ_E: HQ_STRONG;
+		case HQ_EDGE_OR_A: return differ(b, d)? HQ_A: HQ_EDGE;
+		case HQ_MILD_OR_A: return differ(b, d)? HQ_A: HQ_MILD;
+		case HQ_STRONG_OR_A: return differ(b, d)? HQ_A: HQ_STRONG;
+		case HQ_LINE_B_OR_D: return differ(b, f)? HQ_D: HQ_LINE_B;
+		case HQ_LINE_D_OR_B: return differ(d, h)? HQ_B: HQ_LINE_D;
+
+	}
+
+	return rule;
+
+}
+
+
+/**
+ * Find the colour of the corner of a pixel at double size.
+ *
+ * @param rule Interpolation rule
+ * @param e Colour of the pixel
+ * @param a Colour of the diagonal neighbour at the corner
+ * @param b Colour of the vertical neighbour at the corner
+ * @param d Colour of the horizontal neighbour at the corner
+ *
+ * @return The colour
+ */
+static inline unsigned int hq2xCorner (int rule, unsigned int e, unsigned int a,
+	unsigned int b, unsigned int d) {
+
+	switch (rule) {
+
+		case HQ_A: return mix(e, 12, a, 4);
+		case HQ_D: return mix(e, 12, d, 4);
+		case HQ_B: return mix(e, 12, b, 4);
+		case HQ_DB: return mix(e, 8, d, 4, b, 4);
+		case HQ_AB: return mix(e, 8, a, 4, b, 4);
+		case HQ_AD: return mix(e, 8, a, 4, d, 4);
+		case HQ_LINE_B: return mix(e, 10, b, 4, d, 2);
+		case HQ_LINE_D: return mix(e, 10, d, 4, b, 2);
+		case HQ_MILD: return mix(e, 12, d, 2, b, 2);
+		case HQ_STRONG: return mix(e, 4, d, 6, b, 6);
+		case HQ_SOFT: return mix(e, 14, d, 1, b, 1);
+		case HQ_EDGE: return mix(e, 8, d, 4, b, 4);
+
+	}
+
+	return e;
+
+}
+
+
+/**
+ * Find the colour of the corner of a pixel at triple size.
+ *
+ * @param rule Interpolation rule
+ * @param e Colour of the pixel
+ * @param a Colour of the diagonal neighbour at the corner
+ * @param b Colour of the vertical neighbour at the corner
+ * @param d Colour of the horizontal neighbour at the corner
+ *
+ * @return The colour
+ */
+static inline unsigned int hq3xCorner (int rule, unsigned int e, unsigned int a,
+	unsigned int b, unsigned int d) {
+
+	switch (rule) {
+
+		case HQ_A:
+		case HQ_AB:
+		case HQ_AD: return mix(e, 12, a, 4);
+		case HQ_D: return mix(e, 12, d, 4);
+		case HQ_B: return mix(e, 12, b, 4);
+		case HQ_DB:
+		case HQ_LINE_B:
+		case HQ_LINE_D:
+		case HQ_MILD:
+		case HQ_SOFT:
+		case HQ_EDGE: return mix(e, 8, d, 4, b, 4);
+		case HQ_STRONG: return mix(e, 2, d, 7, b, 7);
+
+	}
+
+	return e;
+
+}
+
+
+/**
+ * Find the colour of the middle of the side of a pixel at triple size, as one
+ * of the corners on that side sees it.
+ *
+ * @param rule Interpolation rule of the corner
+ * @param line Rule for an edge continuing along the side (HQ_LINE_B or HQ_LINE_D)
+ * @param e Colour of the pixel
+ * @param n Colour of the neighbour across the side
+ * @param similar Whether or not the neighbour across the side is similar
+ * @param priority Receives how strongly the corner determines the colour
+ *
+ * @return The colour
+ */
+static inline unsigned int hq3xSide (int rule, int line, unsigned int e, unsigned int n,
+	bool similar, int& priority) {
+
+	if (rule == line) {
+
+		priority = 2;
+
+		return mix(n, 12, e, 4);
+
+	}
+
+	if ((rule == HQ_EDGE) || (rule == HQ_STRONG)) {
+
+		priority = 1;
+
+		return mix(e, 14, n, 2);
+
+	}
+
+	priority = 0;
+
+	return similar? mix(e, 12, n, 4): e;
+
+}
+
+
+/**
+ * Find the colours of the quarter of a pixel at quadruple size nearest a
+ * corner.
+ *
+ * @param rule Interpolation rule
+ * @param e Colour of the pixel
+ * @param a Colour of the diagonal neighbour at the corner
+ * @param b Colour of the vertical neighbour at the corner
+ * @param d Colour of the horizontal neighbour at the corner
+ * @param out Receives the colours at the corner, beside it along the vertical
+ * neighbour, beside it along the horizontal neighbour, and diagonally inwards
+ */
+static inline void hq4xQuarter (int rule, unsigned int e, unsigned int a,
+	unsigned int b, unsigned int d, unsigned int* out) {
+
+	switch (rule) {
+
+		case HQ_A:
+			out[0] = mix(e, 10, a, 6);
+			out[1] = out[2] = mix(e, 12, a, 4);
+			out[3] = mix(e, 14, a, 2);
+
+			return;
+
+		case HQ_D:
+			out[0] = out[2] = mix(e, 10, d, 6);
+			out[1] = out[3] = mix(e, 14, d, 2);
+
+			return;
+
+		case HQ_B:
+			out[0] = out[1] = mix(e, 10, b, 6);
+			out[2] = out[3] = mix(e, 14, b, 2);
+
+			return;
+
+		case HQ_DB:
+			out[0] = mix(e, 8, d, 4, b, 4);
+			out[1] = mix(e, 10, b, 4, d, 2);
+			out[2] = mix(e, 10, d, 4, b, 2);
+			out[3] = mix(e, 12, d, 2, b, 2);
+
+			return;
+
+		case HQ_AB:
+			out[0] = mix(e, 10, a, 6);
+			out[1] = mix(e, 10, b, 4, a, 2);
+			out[2] = mix(e, 12, a, 4);
+			out[3] = mix(e, 14, a, 2);
+
+			return;
+
+		case HQ_AD:
+			out[0] = mix(e, 10, a, 6);
+			out[1] = mix(e, 12, a, 4);
+			out[2] = mix(e, 10, d, 4, a, 2);
+			out[3] = mix(e, 14, a, 2);
+
+			return;
+
+		case HQ_LINE_B:
+			out[0] = mix(e, 12, b, 4);
+			out[1] = mix(b, 12, e, 4);
+			out[2] = mix(e, 10, d, 6);
+			out[3] = mix(e, 14, d, 2);
+
+			return;
+
+		case HQ_LINE_D:
+			out[0] = mix(e, 12, d, 4);
+			out[1] = mix(e, 10, b, 6);
+			out[2] = mix(d, 12, e, 4);
+			out[3] = mix(e, 14, b, 2);
+
+			return;
+
+		case HQ_MILD:
+		case HQ_EDGE:
+			out[0] = mix(e, 8, d, 4, b, 4);
+			out[1] = mix(e, 12, b, 4);
+			out[2] = mix(e, 12, d, 4);
+			out[3] = e;
+
+			return;
+
+		case HQ_STRONG:
+			out[0] = out[1] = out[2] = mix(d, 8, b, 8);
+			out[3] = e;
+
+			return;
+
+		case HQ_SOFT:
+			out[0] = mix(e, 8, d, 4, b, 4);
+			out[1] = out[2] = out[3] = e;
+
+			return;
+
+	}
+
+	out[0] = out[1] = out[2] = out[3] = e;
+
+}
+
+
+/**
+ * Scale a block of pixel values with the hq2x/hq3x/hq4x rules, and expand it
+ * through the palette.
+ *
+ * @param factor Scaling factor (2 to 4)
+ * @param src Source pixel values
+ * @param srcPitch Bytes per source row
+ * @param width Width of the source block
+ * @param height Height of the source block
+ * @param dst Destination pixels
+ * @param dstPitch Bytes per destination row
+ * @param colours Destination pixel for each pixel value
+ */
+static void scaleHqxBlock (int factor, const unsigned char* src, int srcPitch,
+	int width, int height, unsigned char* dst, int dstPitch, const unsigned int* colours) {
+
+	// Corner of the scaled pixel, and the steps away from the horizontal and
+	// vertical neighbours, for each corner
+	const int last = factor - 1;
+	const int corners[4][6] = {
+		{0, 0, 1, 0, 0, 1},
+		{last, 0, 0, 1, -1, 0},
+		{last, last, -1, 0, 0, -1},
+		{0, last, 0, -1, 1, 0}
+	};
+
+	for (int y = 0; y < height; y++) {
+
+		const unsigned char* row = src + (srcPitch * y);
+		const unsigned char* above = (y > 0)? row - srcPitch: row;
+		const unsigned char* below = (y < height - 1)? row + srcPitch: row;
+
+		for (int x = 0; x < width; x++) {
+
+			int left = (x > 0)? x - 1: x;
+			int right = (x < width - 1)? x + 1: x;
+
+			const unsigned char n[9] = {
+				above[left], above[x], above[right],
+				row[left], row[x], row[right],
+				below[left], below[x], below[right]
+			};
+			unsigned char e = n[4];
+			unsigned int ce = colours[e];
+			unsigned int block[4][4];
+			int sidePriority[3][3];
+			bool different[9];
+
+			// Areas of one colour need no blending
+			if ((n[0] == e) && (n[1] == e) && (n[2] == e) && (n[3] == e) &&
+				(n[5] == e) && (n[6] == e) && (n[7] == e) && (n[8] == e)) {
+
+				for (int sy = 0; sy < factor; sy++) {
+
+					unsigned int* out = reinterpret_cast<unsigned int*>(dst + (dstPitch * sy)) + (x * factor);
+
+					for (int sx = 0; sx < factor; sx++) out[sx] = ce;
+
+				}
+
+				continue;
+
+			}
+
+			for (int count = 0; count < 9; count++) different[count] = differ(e, n[count]);
+
+			// The middle of a pixel at triple size keeps its colour
+			block[1][1] = ce;
+			for (int sy = 0; sy < 3; sy++) {
+				for (int sx = 0; sx < 3; sx++) sidePriority[sy][sx] = -1;
+			}
+
+			for (int corner = 0; corner < 4; corner++) {
+
+				const int* frame = hqFrames[corner];
+				const int* pos = corners[corner];
+				int pattern = 0;
+
+				for (int bit = 0; bit < 8; bit++) pattern |= different[frame[bit]] << bit;
+
+				int rule = hqResolve(hqRules[pattern], n[frame[1]], n[frame[3]], n[frame[4]], n[frame[6]]);
+
+				unsigned int ca = colours[n[frame[0]]];
+				unsigned int cb = colours[n[frame[1]]];
+				unsigned int cd = colours[n[frame[3]]];
+
+				if (factor == 2) {
+
+					block[pos[1]][pos[0]] = hq2xCorner(rule, ce, ca, cb, cd);
+
+				} else if (factor == 3) {
+
+					unsigned int side;
+					int priority;
+
+					block[pos[1]][pos[0]] = hq3xCorner(rule, ce, ca, cb, cd);
+
+					// The side shared with the vertical neighbour
+					side = hq3xSide(rule, HQ_LINE_B, ce, cb, !different[frame[1]], priority);
+
+					if (priority > sidePriority[pos[1] + pos[3]][pos[0] + pos[2]]) {
+
+						block[pos[1] + pos[3]][pos[0] + pos[2]] = side;
+						sidePriority[pos[1] + pos[3]][pos[0] + pos[2]] = priority;
+
+					}
+
+					// The side shared with the horizontal neighbour
+					side = hq3xSide(rule, HQ_LINE_D, ce, cd, !different[frame[3]], priority);
+
+					if (priority > sidePriority[pos[1] + pos[5]][pos[0] + pos[4]]) {
+
+						block[pos[1] + pos[5]][pos[0] + pos[4]] = side;
+						sidePriority[pos[1] + pos[5]][pos[0] + pos[4]] = priority;
+
+					}
+
+				} else {
+
+					unsigned int quarter[4];
+
+					hq4xQuarter(rule, ce, ca, cb, cd, quarter);
+
+					block[pos[1]][pos[0]] = quarter[0];
+					block[pos[1] + pos[3]][pos[0] + pos[2]] = quarter[1];
+					block[pos[1] + pos[5]][pos[0] + pos[4]] = quarter[2];
+					block[pos[1] + pos[3] + pos[5]][pos[0] + pos[2] + pos[4]] = quarter[3];
+
+				}
+
+			}
+
+			for (int sy = 0; sy < factor; sy++) {
+
+				unsigned int* out = reinterpret_cast<unsigned int*>(dst + (dstPitch * sy)) + (x * factor);
+
+				for (int sx = 0; sx < factor; sx++) out[sx] = block[sy][sx];
+
+			}
+
+		}
+
+		dst += dstPitch * factor;
+
+	}
+
+}
+
+
+/**
+ * Scale 8-bit pixel data with hq2x, hq3x or hq4x, and expand it through a
+ * palette. Only destinations with 8 bits per channel can be blended.
+ *
+ * @param factor Scaling factor (2 to 4)
+ * @param src Source pixel values
+ * @param srcPitch Bytes per source row
+ * @param width Width of the source block
+ * @param height Height of the source block
+ * @param dst Destination pixels, with room for the scaled block
+ * @param dstPitch Bytes per destination row
+ * @param bytesPerPixel Size of a destination pixel (must be 4)
+ * @param masks Red, green, blue and alpha masks of a destination pixel (each
+ * must cover one byte, alpha may be 0)
+ * @param colours Destination pixel for each pixel value
+ *
+ * @return Whether the factor and pixel format could be handled
+ */
+bool scaleHqx (int factor, const unsigned char* src, int srcPitch,
+	int width, int height, unsigned char* dst, int dstPitch,
+	int bytesPerPixel, const unsigned int* masks, const unsigned int* colours) {
+
+	if ((factor < 2) || (factor > 4) || (bytesPerPixel != 4) ||
+		!similarityValid || (width < 1) || (height < 1)) return false;
+
+	// Only 8 bits per channel can be blended, not e.g. 10:10:10:2
+	if (!isByteChannel(masks[0]) || !isByteChannel(masks[1]) ||
+		!isByteChannel(masks[2]) || (masks[3] && !isByteChannel(masks[3])))
+		return false;
+
+	scaleHqxBlock(factor, src, srcPitch, width, height, dst, dstPitch, colours);
+
+	return true;
+
+}
+
+
+/**
+ * Scale 8-bit pixel data with the Scale2x/Scale3x/Scale4x rules (or copy it)
+ * and expand it through a palette, in one pass.
+ *
+ * @param factor Scaling factor (1 to 4)
+ * @param src Source pixel values
+ * @param srcPitch Bytes per source row
+ * @param width Width of the source block
+ * @param height Height of the source block
+ * @param dst Destination pixels, with room for the scaled block
+ * @param dstPitch Bytes per destination row
+ * @param bytesPerPixel Size of a destination pixel (1, 2 or 4)
+ * @param colours Destination pixel for each pixel value (nullptr to copy the
+ * values, with 1 byte per pixel)
+ *
+ * @return Whether the factor and pixel size could be handled
+ */
+bool scalePaletted (int factor, const unsigned char* src, int srcPitch,
+	int width, int height, unsigned char* dst, int dstPitch,
+	int bytesPerPixel, const unsigned int* colours) {
+
+	if ((factor < 1) || (factor > 4) || (width < 1) || (height < 1)) return false;
+
+	if (!colours && (bytesPerPixel != 1)) return false;
+
+	switch (bytesPerPixel) {
+
+		case 1:
+
+			scaleBlock<unsigned char>(factor, src, srcPitch, width, height, dst, dstPitch, colours);
+
+			return true;
+
+		case 2:
+
+			scaleBlock<unsigned short int>(factor, src, srcPitch, width, height, dst, dstPitch, colours);
+
+			return true;
+
+		case 4:
+
+			scaleBlock<unsigned int>(factor, src, srcPitch, width, height, dst, dstPitch, colours);
+
+			return true;
+
+	}
+
+	return false;
+
+}
@@ -0,0 +1,37 @@
+/**
+ *
+ * @file scaler.h
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ */
+
+#ifndef OJ_SCALER_H
+#define OJ_SCALER_H
+
+
+#include "OpenJazz.h"
+
+
+// Classes
+
+struct SDL_Color;
+
+
+// Functions
+
+void updateSimilarity (const SDL_Color* palette, int first, int amount);
+bool scaleHqx      (int factor, const unsigned char* src, int srcPitch,
+	int width, int height, unsigned char* dst, int dstPitch,
+	int bytesPerPixel, const unsigned int* masks, const unsigned int* colours);
+bool scalePaletted (int factor, const unsigned char* src, int srcPitch,
+	int width, int height, unsigned char* dst, int dstPitch,
+	int bytesPerPixel, const unsigned int* colours);
+
+#endif
@@ -23,6 +23,7 @@
  */
 
 
+#include "blit.h"
 #include "video.h"
 #include "sprite.h"
 
@@ -32,6 +33,8 @@
 	#include <SDL.h>
 #endif
 
+#include <string.h>
+
 
 /**
  * Create a sprite.
@@ -39,8 +42,15 @@
 Sprite::Sprite () {
 
 	pixels = NULL;
+	area.x = area.y = area.w = area.h = 0;
+	shared = false;
+	spans = NULL;
+	spanRows = NULL;
+	colours = NULL;
+	key = 0;
 	xOffset = 0;
 	yOffset = 0;
+	mapped = false;
 
 }
 
@@ -50,7 +60,56 @@ Sprite::Sprite () {
  */
 Sprite::~Sprite () {
 
-	video.destroySurface(pixels);
+	clearSurface();
+	clearSpans();
+
+	delete[] colours;
+
+}
+
+
+/**
+ * Release the sprite image, unless it belongs to an atlas.
+ */
+void Sprite::clearSurface () {
+
+	if (!shared) video.destroySurface(pixels);
+
+	pixels = NULL;
+	shared = false;
+
+}
+
+
+/**
+ * Delete the runs of opaque pixels.
+ */
+void Sprite::clearSpans () {
+
+	delete[] spans;
+	delete[] spanRows;
+
+	spans = NULL;
+	spanRows = NULL;
+
+}
+
+
+/**
+ * Encode the opaque pixels once, so that drawing can copy them a run at a time
+ * instead of testing every pixel.
+ *
+ * @param data The pixel data
+ * @param width The width of the sprite image
+ * @param height The height of the sprite image
+ */
+void Sprite::setSpans (unsigned char* data, int width, int height) {
+
+	clearSpans();
+
+	spans = new unsigned char[encodeSpans(data, width, height, key, NULL, NULL)];
+	spanRows = new unsigned int[height + 1];
+	encodeSpans(data, width, height, key, spans, spanRows);
 
 }
 
@@ -62,11 +121,16 @@ void Sprite::clearPixels () {
 
 	unsigned char data;
 
-	video.destroySurface(pixels);
+	clearSurface();
+	clearSpans();
 
 	data = 0;
+	key = 0;
 	pixels = video.createSurface(&data, 1, 1);
-	video.enableColorKey(pixels, 0);
+	video.enableColorKey(pixels, key);
+	area.x = area.y = 0;
+	area.w = area.h = 1;
+	mapped = false;
 
 }
 
@@ -80,19 +144,55 @@ void Sprite::setOffset (short int x, short int y) {
 
 
 /**
- * Set new pixel data for the sprite.
+ * Set new pixel data for the sprite, in a surface of its own.
  *
  * @param data The new pixel data
  * @param width The width of the sprite image
  * @param height The height of the sprite image
- * @param key The transparent pixel value
+ * @param newKey The transparent pixel value
  */
-void Sprite::setPixels (unsigned char *data, int width, int height, unsigned char key) {
+void Sprite::setPixels (unsigned char *data, int width, int height, unsigned char newKey) {
 
-	video.destroySurface(pixels);
+	clearSurface();
 
+	key = newKey;
 	pixels = video.createSurface(data, width, height);
 	video.enableColorKey(pixels, key);
+	area.x = area.y = 0;
+	area.w = width;
+	area.h = height;
+	mapped = false;
+
+	setSpans(data, width, height);
+
+}
+
+
+/**
+ * Set new pixel data for the sprite, already copied to an atlas page.
+ *
+ * @param page The atlas page holding the sprite image
+ * @param x The x-coordinate of the sprite image within the page
+ * @param y The y-coordinate of the sprite image within the page
+ * @param data The new pixel data
+ * @param width The width of the sprite image
+ * @param height The height of the sprite image
+ * @param newKey The transparent pixel value
+ */
+void Sprite::setAtlasPixels (SDL_Surface* page, int x, int y, unsigned char* data, int width, int height, unsigned char newKey) {
+
+	clearSurface();
+
+	key = newKey;
+	pixels = page;
+	shared = true;
+	area.x = x;
+	area.y = y;
+	area.w = width;
+	area.h = height;
+	mapped = false;
+
+	setSpans(data, width, height);
 
 }
 
@@ -104,7 +204,7 @@ void Sprite::setPixels (unsigned char *data, int width, int height, unsigned cha
  */
 int Sprite::getWidth () {
 
-	return pixels->w;
+	return area.w;
 
 }
 
@@ -116,7 +216,7 @@ int Sprite::getWidth () {
  */
 int Sprite::getHeight() {
 
-	return pixels->h;
+	return area.h;
 
 }
 
@@ -148,13 +248,29 @@ int Sprite::getYOffset () {
 /**
  * Set the sprite's palette, or a portion thereof.
  *
+ * The image may share its surface with other sprites, so instead of changing
+ * the surface's palette, the changed colours are mapped to the logical palette.
+ *
  * @param palette New palette
  * @param start First colour to change
  * @param amount Number of colours to change
  */
 void Sprite::setPalette (SDL_Color *palette, int start, int amount) {
 
-	video.setSurfacePalette(pixels, palette + start, start, amount);
+	if (!colours) colours = new unsigned char[MAX_PALETTE_COLORS];
+
+	if (!mapped) {
+
+		for (int i = 0; i < MAX_PALETTE_COLORS; i++) colours[i] = i;
+
+	}
+
+	// The logical palette is a grey ramp, so the nearest logical colour has
+	// the mean value of each colour
+	for (int i = start; i < start + amount; i++)
+		colours[i] = (palette[i].r + palette[i].g + palette[i].b + 1) / 3;
+
+	mapped = true;
 
 }
 
@@ -166,15 +282,10 @@ void Sprite::setPalette (SDL_Color *palette, int start, int amount) {
  */
 void Sprite::flashPalette (int index) {
 
-	SDL_Color palette[MAX_PALETTE_COLORS];
-	for (int i = 0; i < MAX_PALETTE_COLORS; i++) {
-		palette[i].r = palette[i].g = palette[i].b = index;
-#if OJ_SDL3 || OJ_SDL2
-		palette[i].a = 0xFF;
-#endif
-	}
+	if (!colours) colours = new unsigned char[MAX_PALETTE_COLORS];
 
-	video.setSurfacePalette(pixels, palette, 0, MAX_PALETTE_COLORS);
+	memset(colours, index, MAX_PALETTE_COLORS);
+	mapped = true;
 
 }
 
@@ -184,7 +295,7 @@ void Sprite::flashPalette (int index) {
  */
 void Sprite::restorePalette () {
 
-	video.restoreSurfacePalette(pixels);
+	mapped = false;
 
 }
 
@@ -198,19 +309,41 @@ void Sprite::restorePalette () {
  */
 void Sprite::draw (int x, int y, bool includeOffsets) {
 
-	SDL_Rect dst;
-
-	dst.x = x;
-	dst.y = y;
+	SDL_Rect clip;
+	int firstX, firstY, lastX, lastY;
 
 	if (includeOffsets) {
 
-		dst.x += xOffset;
-		dst.y += yOffset;
+		x += xOffset;
+		y += yOffset;
+
+	}
+
+	if (!spans) {
+
+		video.blitSurface(pixels, &area, canvas, x, y, mapped? colours: NULL);
+
+		return;
 
 	}
 
-	SDL_BlitSurface(pixels, NULL, canvas, &dst);
+	// Keep to the canvas' clipping rectangle
+	video.getClipRect(canvas, &clip);
+
+	firstX = (x < clip.x)? clip.x - x: 0;
+	firstY = (y < clip.y)? clip.y - y: 0;
+	lastX = (x + area.w > clip.x + clip.w)? clip.x + clip.w - x: area.w;
+	lastY = (y + area.h > clip.y + clip.h)? clip.y + clip.h - y: area.h;
+
+	if ((firstX >= lastX) || (firstY >= lastY)) return;
+
+	if (SDL_MUSTLOCK(canvas)) SDL_LockSurface(canvas);
+
+	blitSpans(spans, spanRows, firstX, firstY, lastX - firstX, lastY - firstY,
+		static_cast<unsigned char*>(canvas->pixels) + (canvas->pitch * (y + firstY)) + x + firstX,
+		canvas->pitch, mapped? colours: NULL);
+
+	if (SDL_MUSTLOCK(canvas)) SDL_UnlockSurface(canvas);
 
 }
 
@@ -228,20 +361,16 @@ void Sprite::drawScaled (int x, int y, fixed scale) {
 	int dstX, dstY;
 	int srcX, srcY;
 
-	unsigned char key = video.getColorKey(pixels);
-
-	fullWidth = FTOI(pixels->w * scale);
+	fullWidth = FTOI(area.w * scale);
 	if (x < -(fullWidth >> 1)) return; // Off-screen
 	if (x + (fullWidth >> 1) > canvasW) width = canvasW + (fullWidth >> 1) - x;
 	else width = fullWidth;
 
-	fullHeight = FTOI(pixels->h * scale);
+	fullHeight = FTOI(area.h * scale);
 	if (y < -(fullHeight >> 1)) return; // Off-screen
 	if (y + (fullHeight >> 1) > canvasH) height = canvasH + (fullHeight >> 1) - y;
 	else height = fullHeight;
 
-	if (SDL_MUSTLOCK(canvas)) SDL_LockSurface(canvas);
-
 	if (y < (fullHeight >> 1)) {
 
 		srcY = (fullHeight >> 1) - y;
@@ -254,38 +383,28 @@ void Sprite::drawScaled (int x, int y, fixed scale) {
 
 	}
 
-	while (srcY < height) {
+	if (x < (fullWidth >> 1)) {
 
-		unsigned char* srcRow = static_cast<unsigned char*>(pixels->pixels) + (pixels->pitch * DIV(srcY, scale));
-		unsigned char* dstRow = static_cast<unsigned char*>(canvas->pixels) + (canvas->pitch * dstY);
+		srcX = (fullWidth >> 1) - x;
+		dstX = 0;
 
-		if (x < (fullWidth >> 1)) {
-
-			srcX = (fullWidth >> 1) - x;
-			dstX = 0;
-
-		} else {
-
-			srcX = 0;
-			dstX = x - (fullWidth >> 1);
-
-		}
-
-		while (srcX < width) {
+	} else {
 
-			unsigned char pixel = srcRow[DIV(srcX, scale)];
-			if (pixel != key) dstRow[dstX] = pixel;
+		srcX = 0;
+		dstX = x - (fullWidth >> 1);
 
-			srcX++;
-			dstX++;
+	}
 
-		}
+	if ((srcX >= width) || (srcY >= height)) return;
 
-		srcY++;
-		dstY++;
+	if (SDL_MUSTLOCK(canvas)) SDL_LockSurface(canvas);
+	if (SDL_MUSTLOCK(pixels)) SDL_LockSurface(pixels);
 
-	}
+	blitKeyedScaled(static_cast<unsigned char*>(pixels->pixels) + (pixels->pitch * area.y) + area.x, pixels->pitch,
+		static_cast<unsigned char*>(canvas->pixels) + (canvas->pitch * dstY) + dstX, canvas->pitch,
+		width - srcX, height - srcY, srcX, srcY, scale, key, NULL);
 
+	if (SDL_MUSTLOCK(pixels)) SDL_UnlockSurface(pixels);
 	if (SDL_MUSTLOCK(canvas)) SDL_UnlockSurface(canvas);
 
 }
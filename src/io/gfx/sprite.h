@@ -25,18 +25,32 @@
 
 #include "OpenJazz.h"
 
-// Class
+#ifdef OJ_SDL3
+	#include <SDL3/SDL.h>
+#else
+	#include <SDL.h>
+#endif
 
-struct SDL_Surface;
-struct SDL_Color;
+// Class
 
 /// Sprite
 class Sprite {
 
 	private:
-		SDL_Surface* pixels; ///< Sprite image
+		SDL_Surface* pixels; ///< Sprite image, or the atlas page holding it
+		SDL_Rect     area; ///< Area of the sprite image within pixels
+		bool         shared; ///< Whether or not pixels belongs to an atlas
+		unsigned char* spans; ///< Runs of opaque pixels in the sprite image
+		unsigned int* spanRows; ///< Offset of each row's runs, followed by their total size
+		unsigned char* colours; ///< Palette mapping of the sprite image
+		unsigned char key; ///< Transparent pixel value
 		short int    xOffset; ///< Horizontal offset
 		short int    yOffset; ///< Vertical offset
+		bool         mapped; ///< Whether or not the palette has been changed
+
+		void clearSurface   ();
+		void clearSpans     ();
+		void setSpans       (unsigned char* data, int width, int height);
 
 	public:
 		Sprite              ();
@@ -44,7 +58,8 @@ class Sprite {
 
 		void clearPixels    ();
 		void setOffset      (short int x, short int y);
-		void setPixels      (unsigned char* data, int width, int height, unsigned char key);
+		void setPixels      (unsigned char* data, int width, int height, unsigned char newKey);
+		void setAtlasPixels (SDL_Surface* page, int x, int y, unsigned char* data, int width, int height, unsigned char newKey);
 		int  getWidth       ();
 		int  getHeight      ();
 		int  getXOffset     ();
@@ -0,0 +1,202 @@
+/**
+ *
+ * @file spriteatlas.cpp
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ * @par Description:
+ * Packs the images of a level's sprites into a few large surfaces, instead of
+ * one surface per sprite.
+ *
+ */
+
+
+#include "spriteatlas.h"
+#include "sprite.h"
+#include "video.h"
+
+#include "io/log.h"
+
+#include <algorithm>
+#include <stb_rect_pack.h>
+#include <string.h>
+#include <unordered_set>
+
+
+/**
+ * Delete the atlas, and with it the images of all sprites packed into it.
+ */
+SpriteAtlas::~SpriteAtlas () {
+
+	for (SDL_Surface* page: pages) video.destroySurface(page);
+
+	for (AtlasImage& image: images) delete[] image.pixels;
+
+}
+
+
+/**
+ * Add a sprite image, to be packed into the atlas by pack(). Adding another
+ * image for the same sprite replaces the first.
+ *
+ * @param sprite Sprite that will use the image
+ * @param data The pixel data
+ * @param width The width of the image
+ * @param height The height of the image
+ * @param key The transparent pixel value
+ */
+void SpriteAtlas::add (Sprite* sprite, unsigned char* data, int width, int height, unsigned char key) {
+
+	AtlasImage image;
+
+	if ((width <= 0) || (height <= 0)) {
+
+		// Forget any earlier image, so that it does not replace the empty one
+		for (int i = images.size() - 1; i >= 0; i--) {
+
+			if (images[i].sprite != sprite) continue;
+
+			delete[] images[i].pixels;
+			images.erase(images.begin() + i);
+
+		}
+
+		sprite->clearPixels();
+
+		return;
+
+	}
+
+	image.sprite = sprite;
+	image.pixels = new unsigned char[width * height];
+	image.width = width;
+	image.height = height;
+	image.key = key;
+
+	memcpy(image.pixels, data, width * height);
+
+	images.push_back(image);
+
+}
+
+
+/**
+ * Pack all added images into pages, and point their sprites at them.
+ */
+void SpriteAtlas::pack () {
+
+	std::unordered_set<Sprite*> packed;
+	std::vector<stbrp_rect> rects;
+	stbrp_node nodes[ATLAS_PAGE_SIZE];
+	int count = 0;
+
+	// Only the last image added for each sprite is used
+	for (int i = images.size() - 1; i >= 0; i--) {
+
+		AtlasImage& image = images[i];
+
+		if (!packed.insert(image.sprite).second) continue;
+
+		if ((image.width > ATLAS_PAGE_SIZE) || (image.height > ATLAS_PAGE_SIZE)) {
+
+			// Too big for a page
+			image.sprite->setPixels(image.pixels, image.width, image.height, image.key);
+
+			continue;
+
+		}
+
+		rects.push_back({i, image.width, image.height, 0, 0, 0});
+
+	}
+
+	while (!rects.empty()) {
+
+		stbrp_context ctx;
+		int height = 0;
+
+		stbrp_init_target(&ctx, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, nodes, ATLAS_PAGE_SIZE);
+		stbrp_pack_rects(&ctx, rects.data(), rects.size());
+
+		// Images are packed from the top, so the page can stop below the
+		// lowest one
+		for (stbrp_rect& rect: rects) {
+
+			if (rect.was_packed && (rect.y + rect.h > height)) height = rect.y + rect.h;
+
+		}
+
+		SDL_Surface* page = height? video.createSurface(nullptr, ATLAS_PAGE_SIZE, height): nullptr;
+
+		if (!page) {
+
+			LOG_WARN("Could not pack sprite atlas!");
+
+			break;
+
+		}
+
+		if (SDL_MUSTLOCK(page)) SDL_LockSurface(page);
+
+		for (stbrp_rect& rect: rects) {
+
+			if (!rect.was_packed) continue;
+
+			AtlasImage& image = images[rect.id];
+
+			for (int y = 0; y < image.height; y++)
+				memcpy(static_cast<unsigned char*>(page->pixels) + (page->pitch * (rect.y + y)) + rect.x,
+					image.pixels + (image.width * y), image.width);
+
+			image.sprite->setAtlasPixels(page, rect.x, rect.y,
+				image.pixels, image.width, image.height, image.key);
+
+			count++;
+
+		}
+
+		if (SDL_MUSTLOCK(page)) SDL_UnlockSurface(page);
+
+		pages.push_back(page);
+
+		// Pack the rest into further pages
+		rects.erase(std::remove_if(rects.begin(), rects.end(),
+			[](const stbrp_rect& rect) { return rect.was_packed; }), rects.end());
+
+	}
+
+	// Give anything left over a surface of its own
+	for (stbrp_rect& rect: rects) {
+
+		AtlasImage& image = images[rect.id];
+
+		image.sprite->setPixels(image.pixels, image.width, image.height, image.key);
+
+	}
+
+	LOG_DEBUG("Packed %d sprite images into %d atlas pages.", count, getPages());
+
+	for (AtlasImage& image: images) delete[] image.pixels;
+
+	images.clear();
+
+}
+
+
+/**
+ * Get the number of pages holding packed images.
+ *
+ * @return The number of pages
+ */
+int SpriteAtlas::getPages () {
+
+	return pages.size();
+
+}
+
@@ -0,0 +1,68 @@
+/**
+ *
+ * @file spriteatlas.h
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ */
+
+#ifndef OJ_SPRITEATLAS_H
+#define OJ_SPRITEATLAS_H
+
+
+#include "OpenJazz.h"
+
+#ifdef OJ_SDL3
+	#include <SDL3/SDL.h>
+#else
+	#include <SDL.h>
+#endif
+
+#include <vector>
+
+
+// Constants
+
+/// Width and maximum height of an atlas page
+#define ATLAS_PAGE_SIZE 1024
+
+
+// Classes
+
+class Sprite;
+
+/// Sprite image waiting to be packed
+struct AtlasImage {
+
+	Sprite*        sprite; ///< Sprite that will use the image
+	unsigned char* pixels; ///< Pixel data
+	int            width; ///< Width of the image
+	int            height; ///< Height of the image
+	unsigned char  key; ///< Transparent pixel value
+
+};
+
+/// Packs the images of many sprites into a few large surfaces
+class SpriteAtlas {
+
+	private:
+		std::vector<SDL_Surface*> pages; ///< Surfaces holding the packed images
+		std::vector<AtlasImage>   images; ///< Images waiting to be packed
+
+	public:
+		~SpriteAtlas ();
+
+		void add      (Sprite* sprite, unsigned char* data, int width, int height, unsigned char key);
+		void pack     ();
+		int  getPages ();
+
+};
+
+#endif
+
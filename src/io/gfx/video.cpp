@@ -25,7 +25,9 @@
  */
 
 
+#include "blit.h"
 #include "paletteeffects.h"
+#include "scaler.h"
 #include "video.h"
 
 #ifdef SCALE
@@ -35,6 +37,7 @@
 #include "setup.h"
 #include "util.h"
 #include "io/log.h"
+#include "io/profiler.h"
 
 #include <string.h>
 
@@ -113,6 +116,143 @@ void Video::setClipRect (SDL_Surface *surface, const SDL_Rect *rect) {
 #endif
 }
 
+/**
+ * Get the clipping rectangle of a surface.
+ *
+ * @param surface The surface
+ * @param rect Filled with the clipping rectangle
+ */
+void Video::getClipRect (SDL_Surface *surface, SDL_Rect *rect) {
+#if OJ_SDL3
+	SDL_GetSurfaceClipRect(surface, rect);
+#else
+	SDL_GetClipRect(surface, rect);
+#endif
+}
+
+/**
+ * Copy an area of one surface to another, skipping the colour key.
+ *
+ * Unlike SDL_BlitSurface, pixel values are copied as they are, or through the
+ * given colour map, instead of being matched between palettes. All surfaces
+ * use the same logical palette, so the result is the same.
+ *
+ * @param src Source surface
+ * @param srcRect Area of the source surface (nullptr for all of it)
+ * @param dst Destination surface
+ * @param x X-coordinate of the area in the destination surface
+ * @param y Y-coordinate of the area in the destination surface
+ * @param colours Map from source to destination pixel values (nullptr for none)
+ */
+void Video::blitSurface (SDL_Surface *src, const SDL_Rect *srcRect, SDL_Surface *dst, int x, int y, const unsigned char *colours) {
+
+	SDL_Rect area, clip;
+	int key = BLIT_NO_KEY;
+
+	if (srcRect) {
+
+		area = *srcRect;
+
+	} else {
+
+		area.x = area.y = 0;
+		area.w = src->w;
+		area.h = src->h;
+
+	}
+
+	// Keep to the source surface
+	if (area.x < 0) {
+
+		x -= area.x;
+		area.w += area.x;
+		area.x = 0;
+
+	}
+
+	if (area.y < 0) {
+
+		y -= area.y;
+		area.h += area.y;
+		area.y = 0;
+
+	}
+
+	if (area.x + area.w > src->w) area.w = src->w - area.x;
+	if (area.y + area.h > src->h) area.h = src->h - area.y;
+
+	// Keep to the destination's clipping rectangle
+	getClipRect(dst, &clip);
+
+	if (x < clip.x) {
+
+		area.x += clip.x - x;
+		area.w -= clip.x - x;
+		x = clip.x;
+
+	}
+
+	if (y < clip.y) {
+
+		area.y += clip.y - y;
+		area.h -= clip.y - y;
+		y = clip.y;
+
+	}
+
+	if (x + area.w > clip.x + clip.w) area.w = clip.x + clip.w - x;
+	if (y + area.h > clip.y + clip.h) area.h = clip.y + clip.h - y;
+
+	if ((area.w <= 0) || (area.h <= 0)) return;
+
+#if OJ_SDL3
+	Uint32 colorKey;
+	if (SDL_GetSurfaceColorKey(src, &colorKey)) key = colorKey;
+#elif OJ_SDL2
+	Uint32 colorKey;
+	if (SDL_GetColorKey(src, &colorKey) == 0) key = colorKey;
+#else
+	if (src->flags & SDL_SRCCOLORKEY) key = src->format->colorkey;
+#endif
+
+	if (SDL_MUSTLOCK(src)) SDL_LockSurface(src);
+	if (SDL_MUSTLOCK(dst)) SDL_LockSurface(dst);
+
+	blitKeyed(static_cast<unsigned char*>(src->pixels) + (src->pitch * area.y) + area.x, src->pitch,
+		static_cast<unsigned char*>(dst->pixels) + (dst->pitch * y) + x, dst->pitch,
+		area.w, area.h, key, colours);
+
+	if (SDL_MUSTLOCK(dst)) SDL_UnlockSurface(dst);
+	if (SDL_MUSTLOCK(src)) SDL_UnlockSurface(src);
+
+}
+
+/**
+ * Get the pixel values that SDL would match a surface's palette to, when
+ * blitting it to a surface with the logical palette.
+ *
+ * @param surface Surface with a changed palette
+ * @param colours Filled with the map from surface to logical pixel values
+ *
+ * @return The map
+ */
+unsigned char* Video::getPaletteMap (SDL_Surface *surface, unsigned char *colours) {
+
+#if OJ_SDL3
+	SDL_Color *palette = SDL_GetSurfacePalette(surface)->colors;
+#else
+	SDL_Color *palette = surface->format->palette->colors;
+#endif
+
+	// The logical palette is a grey ramp, so the nearest logical colour has
+	// the mean value of each colour
+	for (int i = 0; i < MAX_PALETTE_COLORS; i++)
+		colours[i] = (palette[i].r + palette[i].g + palette[i].b + 1) / 3;
+
+	return colours;
+
+}
+
 static void showCursor(bool enable) {
 #if OJ_SDL3
 	if(enable) {
@@ -132,9 +272,13 @@ static void showCursor(bool enable) {
 Video::Video () :
 #if OJ_SDL3 || OJ_SDL2
 	window(nullptr), renderer(nullptr), texture(nullptr),
+	vsyncWanted(false), vsync(false),
 #endif
 #if OJ_SDL2
-	textureSurface(nullptr),
+	textureFormat(nullptr), direct(false),
+	presentThread(nullptr), presentLock(nullptr), presentCond(nullptr),
+	readyFrame(-1), shownFrame(-1), presentWanted(false), presenting(false),
+	glRenderer(false), presentTime(0), droppedFrames(0),
 #endif
 	screen(nullptr), scaleFactor(MIN_SCALE), scaleMethod(scalerType::None),
 	fullscreen(false), isPlayingMovie(false) {
@@ -163,6 +307,13 @@ Video::Video () :
 
 	currentPalette = logicalPalette;
 #endif
+
+#if OJ_SDL2
+	for (int i = 0; i < 2; i++) {
+		framePixels[i] = nullptr;
+		frameSize[i] = 0;
+	}
+#endif
 }
 
 
@@ -304,13 +455,27 @@ bool Video::init (SetupOptions cfg) {
  *
  */
 void Video::commonDeinit () {
+#if OJ_SDL2
+	// The renderer is about to go
+	stopPresenting();
+#endif
+
 	// canvas is used when scaling or built with SDL2
 	if (canvas && canvas != screen)
 		destroySurface(canvas);
 
 #if OJ_SDL2
-	if(textureSurface)
-		destroySurface(textureSurface);
+	if(textureFormat) {
+		SDL_FreeFormat(textureFormat);
+		textureFormat = nullptr;
+	}
+
+	#if SDL_VERSION_ATLEAST(2, 28, 0)
+	// The window surface cannot be used together with a renderer
+	if(direct)
+		SDL_DestroyWindowSurface(window);
+	#endif
+	direct = false;
 #endif
 
 #if OJ_SDL3 || OJ_SDL2
@@ -326,6 +491,8 @@ void Video::commonDeinit () {
 		SDL_DestroyRenderer(renderer);
 		renderer = nullptr;
 	}
+
+	vsync = false;
 #endif
 }
 
@@ -337,6 +504,24 @@ void Video::deinit () {
 
 	commonDeinit();
 
+#if OJ_SDL2
+	for (int i = 0; i < 2; i++) {
+		delete[] framePixels[i];
+		framePixels[i] = nullptr;
+		frameSize[i] = 0;
+	}
+
+	if(presentCond) {
+		SDL_DestroyCond(presentCond);
+		presentCond = nullptr;
+	}
+
+	if(presentLock) {
+		SDL_DestroyMutex(presentLock);
+		presentLock = nullptr;
+	}
+#endif
+
 #if OJ_SDL3 || OJ_SDL2
 	if(window) {
 		SDL_DestroyWindow(window);
@@ -382,6 +567,8 @@ bool Video::reset (int width, int height) {
 		return false;
 	}
 
+	vsync = vsyncWanted && SDL_SetRenderVSync(renderer, 1);
+
 	SDL_SetWindowSize(window, screenW, screenH);
 	SDL_SetWindowFullscreen(window, fullscreen? SDL_WINDOW_FULLSCREEN: 0);
 	screen = createSurface(nullptr, screenW, screenH);
@@ -390,22 +577,6 @@ bool Video::reset (int width, int height) {
 		return false;
 	}
 #elif OJ_SDL2
-	// Let the renderer scale the texture
-	switch(scaleMethod) {
-		case scalerType::Bilinear:
-			SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
-			break;
-		default:
-			SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
-			break;
-	}
-
-	renderer = SDL_CreateRenderer(window, -1, 0);
-	if (!renderer) {
-		LOG_FATAL("Could not create renderer: %s", SDL_GetError());
-		return false;
-	}
-
 	SDL_SetWindowSize(window, screenW, screenH);
 	SDL_SetWindowFullscreen(window, fullscreen? SDL_WINDOW_FULLSCREEN_DESKTOP: 0);
 #else
@@ -482,37 +653,74 @@ bool Video::reset (int width, int height) {
 			break;
 	}
 	#elif OJ_SDL2
-	SDL_RenderSetLogicalSize(renderer, renderW, renderH);
-
 	Uint32 format = SDL_MasksToPixelFormatEnum(canvas->format->BitsPerPixel,
 		canvas->format->Rmask, canvas->format->Gmask, canvas->format->Bmask, canvas->format->Amask);
 	LOG_TRACE("Screen surface is using '%s' pixel format", SDL_GetPixelFormatName(format));
 	screen = SDL_CreateRGBSurfaceWithFormatFrom(canvas->pixels, canvasW, canvasH,
 		canvas->format->BitsPerPixel, canvas->pitch, format);
 
-	// Find a suitable renderer/texture format
-	format = SDL_PIXELFORMAT_RGB888;
-	SDL_RendererInfo info;
-	if (SDL_GetRendererInfo(renderer, &info) >= 0) {
-		for (Uint32 i = 0; i < info.num_texture_formats; i++) {
-			if (SDL_ISPIXELFORMAT_PACKED(info.texture_formats[i])) {
-				format = info.texture_formats[i];
+	// Without scaling, the canvas can be written straight to the window
+	direct = canWriteDirect();
+	if (direct) {
+		SDL_Surface *windowSurface = SDL_GetWindowSurface(window);
+		if (windowSurface && (windowSurface->format->BytesPerPixel != 3)) {
+			format = windowSurface->format->format;
+			LOG_TRACE("Using '%s' pixel format with the window surface", SDL_GetPixelFormatName(format));
+		} else {
+			LOG_DEBUG("Could not use the window surface: %s", SDL_GetError());
+		#if SDL_VERSION_ATLEAST(2, 28, 0)
+			// The renderer cannot be created while the window has a surface
+			if (windowSurface)
+				SDL_DestroyWindowSurface(window);
+		#endif
+			direct = false;
+		}
+	}
+
+	if (!direct) {
+		// Let the renderer scale the texture
+		switch(scaleMethod) {
+			case scalerType::Bilinear:
+				SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
+				break;
+			default:
+				SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
 				break;
+		}
+
+		renderer = SDL_CreateRenderer(window, -1, vsyncWanted? SDL_RENDERER_PRESENTVSYNC: 0);
+		if (!renderer) {
+			LOG_FATAL("Could not create renderer: %s", SDL_GetError());
+			return false;
+		}
+
+		SDL_RenderSetLogicalSize(renderer, renderW, renderH);
+
+		// Find a suitable renderer/texture format
+		format = SDL_PIXELFORMAT_RGB888;
+		SDL_RendererInfo info;
+		if (SDL_GetRendererInfo(renderer, &info) >= 0) {
+			vsync = vsyncWanted && (info.flags & SDL_RENDERER_PRESENTVSYNC);
+			for (Uint32 i = 0; i < info.num_texture_formats; i++) {
+				if (SDL_ISPIXELFORMAT_PACKED(info.texture_formats[i])) {
+					format = info.texture_formats[i];
+					break;
+				}
 			}
 		}
-	}
-	LOG_TRACE("Using '%s' pixel format with '%s' renderer", SDL_GetPixelFormatName(format), info.name);
+		LOG_TRACE("Using '%s' pixel format with '%s' renderer", SDL_GetPixelFormatName(format), info.name);
 
-	// Create texture with compatible surface for pixel data upload (likely 32 bit)
-	texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STREAMING, renderW, renderH);
-	if (!texture) {
-		LOG_ERROR("Could not create texture: %s", SDL_GetError());
-		return false;
+		// Create texture for pixel data upload (likely 32 bit)
+		texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STREAMING, renderW, renderH);
+		if (!texture) {
+			LOG_ERROR("Could not create texture: %s", SDL_GetError());
+			return false;
+		}
 	}
 
-	textureSurface = SDL_CreateRGBSurfaceWithFormat(0, renderW, renderH, SDL_BITSPERPIXEL(format), format);
-	if (!textureSurface) {
-		LOG_ERROR("Could not create surface: %s", SDL_GetError());
+	textureFormat = SDL_AllocFormat(format);
+	if (!textureFormat) {
+		LOG_ERROR("Could not create pixel format: %s", SDL_GetError());
 		return false;
 	}
 	#endif
@@ -522,11 +730,291 @@ bool Video::reset (int width, int height) {
 	expose();
 #endif
 
+#if OJ_SDL2
+	startPresenting();
+#endif
+
 	return true;
 
 }
 
 
+#if OJ_SDL2
+/**
+ * Determine whether the canvas can be written straight to the window surface,
+ * without a renderer. This needs the canvas to fill the window unscaled.
+ *
+ * @return Whether or not the window surface can be used
+ */
+bool Video::canWriteDirect () const {
+
+	#if !SDL_VERSION_ATLEAST(2, 28, 0)
+	// Older SDL cannot drop the window surface to make way for a renderer
+	// again, e.g. for movie playback
+	return false;
+	#else
+	// The present thread and vsync need a renderer
+	if (presentWanted || vsyncWanted || isPlayingMovie || (scaleFactor != MIN_SCALE)) return false;
+
+	// Full-screen windows take the size of the desktop
+	return !fullscreen || ((screenW == maxW) && (screenH == maxH));
+	#endif
+
+}
+#endif
+
+
+/**
+ * Choose whether or not frames are shown by a separate thread, so that the
+ * next frame can be drawn while waiting for the display. Takes effect when
+ * the video mode is next set.
+ *
+ * @param enable Whether or not to use a present thread
+ */
+void Video::setPresentThread (bool enable) {
+
+#if OJ_SDL2
+	presentWanted = enable;
+#else
+	// Other renderers can only be used from the main thread
+	if (enable) LOG_WARN("A present thread can only be used with SDL2.");
+#endif
+
+}
+
+
+/**
+ * Choose whether or not showing a frame waits for the display to refresh.
+ * Takes effect when the video mode is next set.
+ *
+ * @param enable Whether or not to use vsync
+ */
+void Video::setVSync (bool enable) {
+
+#if OJ_SDL3 || OJ_SDL2
+	vsyncWanted = enable;
+#else
+	(void)enable;
+#endif
+
+}
+
+
+/**
+ * Get the refresh rate of the display showing the window.
+ *
+ * @return Refresh rate, in Hz
+ */
+int Video::getRefreshRate () {
+
+#if OJ_SDL3
+	const SDL_DisplayMode *mode = SDL_GetDesktopDisplayMode(SDL_GetDisplayForWindow(window));
+	if (mode && (mode->refresh_rate > 0)) return (int)(mode->refresh_rate + 0.5f);
+#elif OJ_SDL2
+	SDL_DisplayMode mode;
+	if ((SDL_GetDesktopDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) == 0) &&
+		(mode.refresh_rate > 0)) return mode.refresh_rate;
+#endif
+
+	return DEFAULT_REFRESH_RATE;
+
+}
+
+
+/**
+ * Get the time the present thread takes to show a frame.
+ *
+ * @return Smoothed time, in microseconds
+ */
+unsigned int Video::getPresentTime () {
+
+#if OJ_SDL2
+	if (!presentLock) return 0;
+
+	SDL_LockMutex(presentLock);
+	unsigned int ret = presentTime;
+	SDL_UnlockMutex(presentLock);
+
+	return ret;
+#else
+	return 0;
+#endif
+
+}
+
+
+/**
+ * Get the number of frames that were replaced by newer ones before the present
+ * thread could show them.
+ *
+ * @return Number of frames
+ */
+unsigned int Video::getDroppedFrames () {
+
+#if OJ_SDL2
+	if (!presentLock) return 0;
+
+	SDL_LockMutex(presentLock);
+	unsigned int ret = droppedFrames;
+	SDL_UnlockMutex(presentLock);
+
+	return ret;
+#else
+	return 0;
+#endif
+
+}
+
+
+#if OJ_SDL2
+/**
+ * Show frames as they are handed off, until told to stop.
+ *
+ * @param data The video output
+ *
+ * @return Always 0
+ */
+int SDLCALL Video::runPresent (void* data) {
+
+	Video* self = static_cast<Video*>(data);
+
+	SDL_LockMutex(self->presentLock);
+
+	while (true) {
+
+		while (self->presenting && (self->readyFrame < 0))
+			SDL_CondWait(self->presentCond, self->presentLock);
+
+		if (!self->presenting) break;
+
+		int shown = self->shownFrame = self->readyFrame;
+		self->readyFrame = -1;
+
+		SDL_UnlockMutex(self->presentLock);
+
+		Uint64 start = SDL_GetPerformanceCounter();
+
+	#ifdef SCALE
+		// The main thread may already have changed the palette again
+		if (self->frames[shown].hqx)
+			updateSimilarity(self->framePalettes[shown], 0, MAX_PALETTE_COLORS);
+	#endif
+
+		self->render(self->frames[shown]);
+
+		unsigned int duration = ((SDL_GetPerformanceCounter() - start) * 1000000) /
+			SDL_GetPerformanceFrequency();
+
+		SDL_LockMutex(self->presentLock);
+
+		// Respond to changes gradually, like the fps counter
+		self->presentTime = ((self->presentTime * 15) + duration) >> 4;
+		self->shownFrame = -1;
+
+	}
+
+	// Let the main thread use the renderer's context again
+	if (self->glRenderer) SDL_GL_MakeCurrent(self->window, nullptr);
+
+	SDL_UnlockMutex(self->presentLock);
+
+	return 0;
+
+}
+
+
+/**
+ * Start the present thread, if one is wanted and the renderer is in use.
+ */
+void Video::startPresenting () {
+
+	if (!presentWanted || presentThread || !renderer) return;
+
+	if (!presentLock) presentLock = SDL_CreateMutex();
+	if (!presentCond) presentCond = SDL_CreateCond();
+
+	if (!presentLock || !presentCond) {
+		LOG_WARN("Could not create present thread: %s", SDL_GetError());
+		return;
+	}
+
+	readyFrame = shownFrame = -1;
+	presenting = true;
+
+	// An OpenGL context can only be current on one thread at a time
+	SDL_RendererInfo info;
+	glRenderer = (SDL_GetRendererInfo(renderer, &info) == 0) && !strncmp(info.name, "opengl", 6);
+	if (glRenderer) SDL_GL_MakeCurrent(window, nullptr);
+
+	presentThread = SDL_CreateThread(runPresent, "OpenJazz present", this);
+	if (!presentThread) {
+		LOG_WARN("Could not create present thread: %s", SDL_GetError());
+		presenting = false;
+	}
+
+}
+
+
+/**
+ * Stop the present thread, so that the main thread can use the renderer.
+ */
+void Video::stopPresenting () {
+
+	if (!presentThread) return;
+
+	SDL_LockMutex(presentLock);
+	presenting = false;
+	SDL_CondSignal(presentCond);
+	SDL_UnlockMutex(presentLock);
+
+	SDL_WaitThread(presentThread, nullptr);
+	presentThread = nullptr;
+
+}
+
+
+/**
+ * Give a finished canvas to the present thread. If the previous one has not
+ * been shown yet, it is dropped.
+ *
+ * @param frame The canvas and how to show it
+ */
+void Video::handOff (const Frame& frame) {
+
+	int size = frame.width * frame.height;
+
+	SDL_LockMutex(presentLock);
+
+	if (readyFrame >= 0) droppedFrames++;
+
+	// Never write to the frame being shown
+	int next = (shownFrame == 0)? 1: 0;
+
+	if (frameSize[next] < size) {
+		delete[] framePixels[next];
+		framePixels[next] = new unsigned char[size];
+		frameSize[next] = size;
+	}
+
+	for (int y = 0; y < frame.height; y++)
+		memcpy(framePixels[next] + (frame.width * y), frame.pixels + (frame.pitch * y), frame.width);
+
+	memcpy(frameColours[next], frame.colours, sizeof(frameColours[next]));
+	memcpy(framePalettes[next], screen->format->palette->colors, sizeof(framePalettes[next]));
+
+	frames[next] = frame;
+	frames[next].pixels = framePixels[next];
+	frames[next].pitch = frame.width;
+	frames[next].colours = frameColours[next];
+	readyFrame = next;
+
+	SDL_CondSignal(presentCond);
+	SDL_UnlockMutex(presentLock);
+
+}
+#endif
+
+
 /**
  * Sets the display palette.
  *
@@ -562,6 +1050,17 @@ void Video::changePalette (SDL_Color *palette, unsigned char first, unsigned int
 	if(!SDL_SetPaletteColors(texturePalette, palette, first, amount)) {
 		LOG_WARN("Could not set texture palette colors: %s", SDL_GetError());
 	}
+	#else
+	// Keep the colours for expanding the canvas straight into the texture
+	if (textureFormat) {
+		for (unsigned int i = 0; i < amount; i++)
+			textureColours[first + i] = SDL_MapRGB(textureFormat, palette[i].r, palette[i].g, palette[i].b);
+	}
+		#ifdef SCALE
+	// The present thread keeps its own table up to date
+	if ((scaleMethod == scalerType::hqx) && !presentThread)
+		updateSimilarity(palette, first, amount);
+		#endif
 	#endif
 #else
 	SDL_SetPalette(screen, SDL_PHYSPAL, palette, first, amount);
@@ -723,6 +1222,7 @@ void Video::update (SDL_Event *event) {
  */
 void Video::flip (int mspf, PaletteEffect* paletteEffects, bool effectsStopped) {
 
+	ProfileTimer flipTimer(PP_FLIP);
 	SDL_Color shownPalette[MAX_PALETTE_COLORS];
 
 #if defined(SCALE) && !OJ_SDL2 && !OJ_SDL3
@@ -744,56 +1244,128 @@ void Video::flip (int mspf, PaletteEffect* paletteEffects, bool effectsStopped)
 	// Apply palette effects
 	if (paletteEffects) {
 		// The palette is emulated, compile all palette changes and apply at once.
+		ProfileTimer paletteTimer(PP_PALETTE);
 		memcpy(shownPalette, currentPalette, sizeof(SDL_Color) * MAX_PALETTE_COLORS);
 		paletteEffects->apply(shownPalette, false, mspf, effectsStopped);
 		changePalette(shownPalette, 0, MAX_PALETTE_COLORS);
 	}
 
-#if OJ_SDL3
-	// Show what has been drawn
-	SDL_UpdateTexture(texture, nullptr, canvas->pixels, canvas->pitch);
-	SDL_RenderClear(renderer);
-	if (isPlayingMovie) {
-		SDL_FRect src = {0, 0, static_cast<float>(canvasW), static_cast<float>(canvasH)};
-		SDL_RenderTexture(renderer, texture, &src, nullptr);
-	} else {
-		SDL_RenderTexture(renderer, texture, nullptr, nullptr);
+#if OJ_SDL3 || OJ_SDL2
+	Frame frame;
+	frame.pixels = static_cast<unsigned char*>(canvas->pixels);
+	frame.pitch = canvas->pitch;
+	frame.width = canvas->w;
+	frame.height = canvas->h;
+	frame.shownW = canvasW;
+	frame.shownH = canvasH;
+	frame.factor = MIN_SCALE;
+	frame.hqx = false;
+	frame.movie = isPlayingMovie;
+	#if OJ_SDL2
+	frame.colours = textureColours;
+
+	if (direct) {
+		// Expand the canvas straight into the window
+		SDL_Surface *windowSurface = SDL_GetWindowSurface(window);
+		if (windowSurface) {
+			if (SDL_MUSTLOCK(windowSurface)) SDL_LockSurface(windowSurface);
+			scalePaletted(MIN_SCALE, frame.pixels, frame.pitch,
+				(frame.width < windowSurface->w)? frame.width: windowSurface->w,
+				(frame.height < windowSurface->h)? frame.height: windowSurface->h,
+				static_cast<unsigned char*>(windowSurface->pixels), windowSurface->pitch,
+				textureFormat->BytesPerPixel, textureColours);
+			if (SDL_MUSTLOCK(windowSurface)) SDL_UnlockSurface(windowSurface);
+			SDL_UpdateWindowSurface(window);
+		}
+		return;
 	}
-	SDL_RenderPresent(renderer);
-#elif OJ_SDL2
-#if defined(SCALE)
-	if(scaleFactor > MIN_SCALE && scaleMethod == scalerType::Scale2x) {
-		// scale 32 bit screen surface
-		scale(scaleFactor,
-			textureSurface->pixels, textureSurface->pitch,
-			screen->pixels, screen->pitch,
-			screen->format->BytesPerPixel, screen->w, screen->h);
-	} else if (scaleFactor > MIN_SCALE && scaleMethod == scalerType::hqx) {
-			// TODO
-	} else {
-#endif
-		// copy unscaled
-		SDL_BlitSurface(screen, nullptr, textureSurface, nullptr);
-#if defined(SCALE)
+	#else
+	frame.colours = nullptr;
+	#endif
+
+	#if defined(SCALE)
+	// Prescale with scalex or hqx
+	if (scaleFactor > MIN_SCALE &&
+		(scaleMethod == scalerType::Scale2x || scaleMethod == scalerType::hqx)) {
+		frame.factor = scaleFactor;
+		frame.hqx = (scaleMethod == scalerType::hqx);
+	}
+	#endif
+
+	#if OJ_SDL2
+	if (presentThread) {
+		// Carry on with the next frame while this one is shown
+		handOff(frame);
+		return;
 	}
+	#endif
+
+	render(frame);
+#else
+	SDL_Flip(screen);
 #endif
 
+}
+
+
+#if OJ_SDL3 || OJ_SDL2
+/**
+ * Expand (and prescale) a finished canvas into the texture and show it.
+ *
+ * @param frame The canvas and how to show it
+ */
+void Video::render (const Frame& frame) {
+
+	void *pixels;
+	int pitch;
+
+	// Expand (and scale) the canvas straight into the texture
+	#if OJ_SDL3
+	if (SDL_LockTexture(texture, nullptr, &pixels, &pitch)) {
+		// The texture has a palette, so pixel values are copied as they are
+		scalePaletted(frame.factor, frame.pixels, frame.pitch, frame.width, frame.height,
+			static_cast<unsigned char*>(pixels), pitch, 1, nullptr);
+	#else
+	if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) == 0) {
+		bool done = false;
+		#if defined(SCALE)
+		// hqx needs 8 bits per colour channel, otherwise use scalex
+		if (frame.hqx) {
+			const unsigned int masks[4] = {textureFormat->Rmask, textureFormat->Gmask,
+				textureFormat->Bmask, textureFormat->Amask};
+			done = scaleHqx(frame.factor, frame.pixels, frame.pitch, frame.width, frame.height,
+				static_cast<unsigned char*>(pixels), pitch, textureFormat->BytesPerPixel, masks, frame.colours);
+		}
+		#endif
+		if (!done)
+			scalePaletted(frame.factor, frame.pixels, frame.pitch, frame.width, frame.height,
+				static_cast<unsigned char*>(pixels), pitch, textureFormat->BytesPerPixel, frame.colours);
+	#endif
+		SDL_UnlockTexture(texture);
+	}
+
 	// Show what has been drawn
-	SDL_UpdateTexture(texture, nullptr, textureSurface->pixels, textureSurface->pitch);
 	SDL_RenderClear(renderer);
-
-	if (isPlayingMovie) {
-		SDL_Rect src = {0, 0, canvasW, canvasH};
+	#if OJ_SDL3
+	if (frame.movie) {
+		SDL_FRect src = {0, 0, static_cast<float>(frame.shownW * frame.factor),
+			static_cast<float>(frame.shownH * frame.factor)};
+		SDL_RenderTexture(renderer, texture, &src, nullptr);
+	} else {
+		SDL_RenderTexture(renderer, texture, nullptr, nullptr);
+	}
+	#else
+	if (frame.movie) {
+		SDL_Rect src = {0, 0, frame.shownW * frame.factor, frame.shownH * frame.factor};
 		SDL_RenderCopy(renderer, texture, &src, nullptr);
 	} else {
 		SDL_RenderCopy(renderer, texture, nullptr, nullptr);
 	}
+	#endif
 	SDL_RenderPresent(renderer);
-#else
-	SDL_Flip(screen);
-#endif
 
 }
+#endif
 
 
 /**
@@ -832,6 +1404,15 @@ void Video::moviePlayback (bool status) {
 
 	isPlayingMovie = status;
 
+	#if OJ_SDL2
+	// Movies are scaled by the renderer
+	if (isPlayingMovie && direct && !reset(screenW, screenH)) {
+		LOG_ERROR("Could not set up the renderer for movie playback");
+		isPlayingMovie = false;
+		return;
+	}
+	#endif
+
 	if (isPlayingMovie) {
 		// save size
 		movieW = canvasW;
@@ -844,10 +1425,20 @@ void Video::moviePlayback (bool status) {
 		canvasW = movieW;
 		canvasH = movieH;
 	}
+	#if OJ_SDL2
+	// Go back to writing straight to the window
+	if (!isPlayingMovie && canWriteDirect()) {
+		if (!reset(screenW, screenH))
+			LOG_ERROR("Could not go back to writing to the window after movie playback");
+		return;
+	}
+	#endif
 	#if OJ_SDL3
 	SDL_SetRenderLogicalPresentation(renderer, canvasW, canvasH, SDL_LOGICAL_PRESENTATION_LETTERBOX);
 	#else
+	stopPresenting();
 	SDL_RenderSetLogicalSize(renderer, canvasW, canvasH);
+	startPresenting();
 	#endif
 #else
 	(void)status;
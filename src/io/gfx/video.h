@@ -77,6 +77,9 @@
 // Time interval
 #define T_MENU_FRAME 20
 
+/// Refresh rate assumed when the display's cannot be found
+#define DEFAULT_REFRESH_RATE 60
+
 // Class
 
 /// Video output
@@ -100,6 +103,9 @@ class Video {
 		void         enableColorKey      (SDL_Surface *surface, unsigned int index);
 		unsigned int getColorKey         (SDL_Surface *surface);
 		void         setClipRect         (SDL_Surface *surface, const SDL_Rect *rect);
+		void         getClipRect         (SDL_Surface *surface, SDL_Rect *rect);
+		void         blitSurface         (SDL_Surface *src, const SDL_Rect *srcRect, SDL_Surface *dst, int x, int y, const unsigned char *colours = nullptr);
+		unsigned char* getPaletteMap     (SDL_Surface *surface, unsigned char *colours);
 
 		void       drawRect              (int x, int y, int width, int height, int index, bool fill = true);
 
@@ -117,23 +123,79 @@ class Video {
 
 		void       moviePlayback         (bool status);
 
+		void       setPresentThread      (bool enable);
+		bool       hasPresentThread      () const;
+		void       setVSync              (bool enable);
+		bool       hasVSync              () const;
+		int        getRefreshRate        ();
+		unsigned int getPresentTime      ();
+		unsigned int getDroppedFrames    ();
+
 		void       update                (SDL_Event *event);
 		void       flip                  (int mspf, PaletteEffect* paletteEffects = NULL, bool effectsStopped = false);
 
 		void       clearScreen           (int index);
 
 	private:
+#if OJ_SDL3 || OJ_SDL2
+		/// A finished canvas, ready to be shown
+		struct Frame {
+			const unsigned char* pixels; ///< Canvas pixels
+			int                  pitch; ///< Length of a canvas row
+			int                  width; ///< Canvas width
+			int                  height; ///< Canvas height
+			int                  shownW; ///< Width of the area shown during movie playback
+			int                  shownH; ///< Height of the area shown during movie playback
+			int                  factor; ///< Prescaling factor
+			bool                 hqx; ///< Whether or not to prescale with hqx
+			bool                 movie; ///< Whether or not a movie is playing
+			const unsigned int*  colours; ///< Palette, in the texture's pixel format
+		};
+#endif
+
 		void       findResolutions ();
 		void       expose          ();
 		void       commonDeinit    ();
+#if OJ_SDL3 || OJ_SDL2
+		void       render          (const Frame& frame);
+#endif
+#if OJ_SDL2
+		bool       canWriteDirect  () const;
+		void       startPresenting ();
+		void       stopPresenting  ();
+		void       handOff         (const Frame& frame);
+
+		static int SDLCALL runPresent (void* data);
+#endif
 
 #if OJ_SDL3 || OJ_SDL2
 		SDL_Window*   window; ///< Output window
 		SDL_Renderer* renderer; ///< Output renderer
 		SDL_Texture*  texture; ///< Output texture
+		bool          vsyncWanted; ///< Whether or not showing a frame should wait for the display
+		bool          vsync; ///< Whether or not the renderer waits for the display
 #endif
 #if OJ_SDL2
-		SDL_Surface*  textureSurface;
+		unsigned int  textureColours[MAX_PALETTE_COLORS]; ///< Current palette, in the texture's pixel format
+		SDL_PixelFormat* textureFormat; ///< Pixel format of the texture or window surface
+		bool          direct; ///< Whether the canvas is written straight to the window surface
+
+		// Present thread
+		SDL_Thread*   presentThread; ///< Shows finished frames (nullptr when not running)
+		SDL_mutex*    presentLock; ///< Guards the frames and statistics
+		SDL_cond*     presentCond; ///< Signalled when a frame is ready or the thread should stop
+		Frame         frames[2]; ///< Frames handed to the present thread
+		unsigned char* framePixels[2]; ///< Copies of the canvas
+		int           frameSize[2]; ///< Sizes of the copies of the canvas
+		unsigned int  frameColours[2][MAX_PALETTE_COLORS]; ///< Palettes of the frames, in the texture's pixel format
+		SDL_Color     framePalettes[2][MAX_PALETTE_COLORS]; ///< Palettes of the frames
+		int           readyFrame; ///< Frame waiting to be shown (-1 for none)
+		int           shownFrame; ///< Frame being shown (-1 for none)
+		bool          presentWanted; ///< Whether or not frames should be shown by a separate thread
+		bool          presenting; ///< Whether or not the present thread should keep running
+		bool          glRenderer; ///< Whether or not the renderer uses an OpenGL context
+		unsigned int  presentTime; ///< Smoothed time taken to show a frame, in microseconds
+		unsigned int  droppedFrames; ///< Number of frames replaced before they were shown
 #endif
 		SDL_Surface*  screen; ///< Output surface
 
@@ -170,6 +232,16 @@ inline int Video::getHeight () const { return screenH; } ///< Returns the curren
 inline int Video::getScaleFactor () const { return scaleFactor;} ///< Returns the current scaling factor.
 inline scalerType Video::getScaleMethod () const { return scaleMethod; } ///< Returns the current scaling method.
 inline bool Video::isFullscreen () const { return fullscreen; } ///< Determines whether or not full-screen mode is being used.
+#if OJ_SDL2
+inline bool Video::hasPresentThread () const { return presentThread != nullptr; } ///< Determines whether or not frames are shown by a separate thread.
+#else
+inline bool Video::hasPresentThread () const { return false; } ///< Determines whether or not frames are shown by a separate thread.
+#endif
+#if OJ_SDL3 || OJ_SDL2
+inline bool Video::hasVSync () const { return vsync; } ///< Determines whether or not showing a frame waits for the display.
+#else
+inline bool Video::hasVSync () const { return false; } ///< Determines whether or not showing a frame waits for the display.
+#endif
 
 // Variables
 
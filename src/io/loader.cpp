@@ -0,0 +1,219 @@
+/**
+ *
+ * @file loader.cpp
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ * @par Description:
+ * Decodes level data on a separate thread, so that the loading screen can
+ * show progress and the game stays responsive.
+ *
+ */
+
+
+#include "loader.h"
+
+#include "io/gfx/video.h"
+#include "io/log.h"
+#include "loop.h"
+
+
+/**
+ * Create an idle loader.
+ */
+Loader::Loader () {
+
+	thread = nullptr;
+	lock = SDL_CreateMutex();
+	job = nullptr;
+	data = nullptr;
+	progress = 0;
+	result = E_NONE;
+	done = true;
+
+}
+
+
+/**
+ * Delete the loader, waiting for any work to finish.
+ */
+Loader::~Loader () {
+
+	wait();
+
+	if (lock) SDL_DestroyMutex(lock);
+
+}
+
+
+/**
+ * Run the work on the loader thread.
+ *
+ * @param loader The loader
+ *
+ * @return Error code
+ */
+int SDLCALL Loader::run (void* loader) {
+
+	Loader* self = static_cast<Loader*>(loader);
+
+	int ret = self->job(self->data);
+
+	if (self->lock) SDL_LockMutex(self->lock);
+
+	self->result = ret;
+	self->progress = 100;
+	self->done = true;
+
+	if (self->lock) SDL_UnlockMutex(self->lock);
+
+	return ret;
+
+}
+
+
+/**
+ * Start work. When simulating, or if no thread can be created, the work is
+ * done straight away instead.
+ *
+ * @param newJob The work
+ * @param newData Data for the work
+ */
+void Loader::start (LoadJob newJob, void* newData) {
+
+	wait();
+
+	job = newJob;
+	data = newData;
+	progress = 0;
+	result = E_NONE;
+	done = false;
+
+	// Simulations must not depend on how long loading takes
+	if (!headless && lock) {
+
+#if OJ_SDL3 || OJ_SDL2
+		thread = SDL_CreateThread(run, "OpenJazz loader", this);
+#else
+		thread = SDL_CreateThread(run, this);
+#endif
+
+		if (thread) return;
+
+		LOG_WARN("Could not create loader thread: %s", SDL_GetError());
+
+	}
+
+	run(this);
+
+}
+
+
+/**
+ * Report progress. Called by the work.
+ *
+ * @param percent Percentage of the work done
+ */
+void Loader::setProgress (int percent) {
+
+	if (lock) SDL_LockMutex(lock);
+
+	progress = percent;
+
+	if (lock) SDL_UnlockMutex(lock);
+
+}
+
+
+/**
+ * Get the progress of the work.
+ *
+ * @return Percentage of the work done
+ */
+int Loader::getProgress () {
+
+	if (lock) SDL_LockMutex(lock);
+
+	int ret = progress;
+
+	if (lock) SDL_UnlockMutex(lock);
+
+	return ret;
+
+}
+
+
+/**
+ * Determine whether or not the work has finished.
+ *
+ * @return Whether or not the work has finished
+ */
+bool Loader::isDone () {
+
+	if (lock) SDL_LockMutex(lock);
+
+	bool ret = done;
+
+	if (lock) SDL_UnlockMutex(lock);
+
+	return ret;
+
+}
+
+
+/**
+ * Wait for the work to finish.
+ *
+ * @return Error code returned by the work
+ */
+int Loader::wait () {
+
+	if (thread) {
+
+		SDL_WaitThread(thread, nullptr);
+		thread = nullptr;
+
+	}
+
+	return result;
+
+}
+
+
+/**
+ * Show a progress bar below the loading screen's text until the work has
+ * finished.
+ *
+ * @return Error code returned by the work, or E_QUIT
+ */
+int Loader::finish () {
+
+	int width = canvasW >> 1;
+	int x = (canvasW - width) >> 1;
+	int y = (canvasH >> 1) + 16;
+
+	while (!isDone()) {
+
+		video.drawRect(x - 2, y - 2, width + 4, 8, 79, false);
+		video.drawRect(x, y, (width * getProgress()) / 100, 4, 175);
+
+		if (::loop(NORMAL_LOOP) == E_QUIT) {
+
+			wait();
+
+			return E_QUIT;
+
+		}
+
+	}
+
+	return wait();
+
+}
+
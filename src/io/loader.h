@@ -0,0 +1,72 @@
+/**
+ *
+ * @file loader.h
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ */
+
+#ifndef OJ_LOADER_H
+#define OJ_LOADER_H
+
+
+#include "OpenJazz.h"
+
+#ifdef OJ_SDL3
+	#include <SDL3/SDL.h>
+#else
+	#include <SDL.h>
+#endif
+
+
+// Datatype
+
+/// Loading work, run by the loader thread
+typedef int (*LoadJob) (void* data);
+
+
+// Class
+
+/// Runs loading work on a separate thread, while the main thread shows a
+/// progress bar and keeps handling input
+class Loader {
+
+	private:
+		SDL_Thread* thread; ///< The loader thread (nullptr when not running)
+#if OJ_SDL3
+		SDL_Mutex*  lock; ///< Guards the progress and state
+#else
+		SDL_mutex*  lock; ///< Guards the progress and state
+#endif
+		LoadJob     job; ///< The work
+		void*       data; ///< Data for the work
+		int         progress; ///< Percentage of the work done
+		int         result; ///< Error code returned by the work
+		bool        done; ///< Whether or not the work has finished
+
+		static int SDLCALL run (void* loader);
+
+		Loader(const Loader&); // non construction-copyable
+		Loader& operator=(const Loader&); // non copyable
+
+	public:
+		Loader  ();
+		~Loader ();
+
+		void start       (LoadJob newJob, void* newData);
+		void setProgress (int percent);
+		int  getProgress ();
+		bool isDone      ();
+		int  wait        ();
+		int  finish      ();
+
+};
+
+#endif
+
@@ -36,6 +36,8 @@
 #include "util.h"
 #include "io/log.h"
 
+#include <algorithm>
+
 #ifdef USE_SOCKETS
 	#ifdef _WIN32
 		#include <winsock.h>
@@ -54,6 +56,11 @@
 		#include <unistd.h>
 		#include <errno.h>
 		#include <string.h>
+		#include <poll.h>
+		#ifdef __linux__
+			#include <sys/epoll.h>
+			#define USE_EPOLL
+		#endif
 	#endif
 	#ifndef MSG_NOSIGNAL
 		#define MSG_NOSIGNAL 0
@@ -70,6 +77,14 @@
  */
 Network::Network () {
 
+	resetStats();
+
+	epollFd = -1;
+
+#ifdef USE_EPOLL
+	epollFd = epoll_create(MAX_CLIENTS + 1);
+#endif
+
 #ifdef USE_SOCKETS
 	#ifdef _WIN32
 	WSADATA WSAData;
@@ -97,6 +112,10 @@ Network::Network () {
  */
 Network::~Network () {
 
+#ifdef USE_EPOLL
+	if (epollFd != -1) ::close(epollFd);
+#endif
+
 #ifdef USE_SOCKETS
 	#ifdef _WIN32
 	// Shut down Windows Sockets
@@ -353,14 +372,37 @@ void Network::close (int sock) {
  */
 int Network::send (int sock, unsigned char *buffer) {
 
+	return send(sock, buffer, buffer[0]);
+
+}
+
+
+/**
+ * Send several messages over the specified connection at once.
+ *
+ * @param sock Connection socket
+ * @param buffer Data to be sent
+ * @param length Number of bytes to send
+ *
+ * @return Number of bytes sent, or -1 for failure
+ */
+int Network::send (int sock, unsigned char *buffer, int length) {
+
+	int ret;
+
 #ifdef USE_SOCKETS
-	return ::send(sock, reinterpret_cast<char*>(buffer), buffer[0], MSG_NOSIGNAL);
+	ret = ::send(sock, reinterpret_cast<char*>(buffer), length, MSG_NOSIGNAL);
 #elif defined USE_SDL_NET
-	return SDLNet_TCP_Send((TCPsocket)sock, reinterpret_cast<char*>(buffer), buffer[0]);
+	ret = SDLNet_TCP_Send((TCPsocket)sock, reinterpret_cast<char*>(buffer), length);
 #else
-	return 0;
+	ret = 0;
 #endif
 
+	sendCalls++;
+	if (ret > 0) sentBytes += ret;
+
+	return ret;
+
 }
 
 
@@ -375,14 +417,21 @@ int Network::send (int sock, unsigned char *buffer) {
  */
 int Network::recv (int sock, unsigned char *buffer, int length) {
 
+	int ret;
+
 #ifdef USE_SOCKETS
-	return ::recv(sock, reinterpret_cast<char*>(buffer), length, MSG_NOSIGNAL);
+	ret = ::recv(sock, reinterpret_cast<char*>(buffer), length, MSG_NOSIGNAL);
 #elif defined USE_SDL_NET
-	return SDLNet_TCP_Recv((TCPsocket)sock, buffer, length);
+	ret = SDLNet_TCP_Recv((TCPsocket)sock, buffer, length);
 #else
-	return 0;
+	ret = 0;
 #endif
 
+	recvCalls++;
+	if (ret > 0) receivedBytes += ret;
+
+	return ret;
+
 }
 
 
@@ -433,3 +482,297 @@ int Network::getError () {
 #endif
 
 }
+
+
+/**
+ * Determine whether or not the last failure was only due to there being no
+ * data to receive yet.
+ *
+ * @return True if the connection is still usable
+ */
+bool Network::wouldBlock () {
+
+#ifdef USE_SOCKETS
+	return getError() == EWOULDBLOCK;
+#else
+	return false;
+#endif
+
+}
+
+
+/**
+ * Start waiting for data on a connection.
+ *
+ * @param sock The connection socket
+ */
+void Network::watch (int sock) {
+
+	watched.push_back(sock);
+
+#ifdef USE_EPOLL
+	if (epollFd != -1) {
+
+		epoll_event event;
+
+		event.events = EPOLLIN;
+		event.data.fd = sock;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, sock, &event);
+
+	}
+#endif
+
+}
+
+
+/**
+ * Stop waiting for data on a connection. Must be called before the
+ * connection is closed.
+ *
+ * @param sock The connection socket
+ */
+void Network::unwatch (int sock) {
+
+	watched.erase(std::remove(watched.begin(), watched.end(), sock), watched.end());
+	ready.erase(std::remove(ready.begin(), ready.end(), sock), ready.end());
+
+#ifdef USE_EPOLL
+	if (epollFd != -1) {
+
+		epoll_event event;
+
+		event.events = 0;
+		event.data.fd = sock;
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, sock, &event);
+
+	}
+#endif
+
+}
+
+
+/**
+ * Wait until data arrives on any watched connection, or until the timeout
+ * passes.
+ *
+ * @param timeout Longest time to wait, in milliseconds (0 to only check)
+ *
+ * @return The number of connections with data waiting
+ */
+int Network::wait (int timeout) {
+
+	ready.clear();
+	waitCalls++;
+
+	if (watched.empty()) {
+
+		if (timeout > 0) SDL_Delay(timeout);
+
+		return 0;
+
+	}
+
+#ifdef USE_EPOLL
+	if (epollFd != -1) {
+
+		epoll_event events[MAX_CLIENTS + 1];
+		int count = epoll_wait(epollFd, events, MAX_CLIENTS + 1, timeout);
+
+		for (int i = 0; i < count; i++) ready.push_back(events[i].data.fd);
+
+		return ready.size();
+
+	}
+#endif
+
+#if defined(USE_SOCKETS) && defined(_WIN32)
+	fd_set readfds;
+	timeval timeouttv;
+
+	FD_ZERO(&readfds);
+
+	for (int sock: watched) FD_SET(sock, &readfds);
+
+	timeouttv.tv_sec = timeout / 1000;
+	timeouttv.tv_usec = (timeout % 1000) * 1000;
+
+	if (select(0, &readfds, NULL, NULL, &timeouttv) > 0) {
+
+		for (int sock: watched) {
+
+			if (FD_ISSET(sock, &readfds)) ready.push_back(sock);
+
+		}
+
+	}
+#elif defined(USE_SOCKETS)
+	std::vector<pollfd> fds(watched.size());
+
+	for (unsigned int i = 0; i < watched.size(); i++) {
+
+		fds[i].fd = watched[i];
+		fds[i].events = POLLIN;
+		fds[i].revents = 0;
+
+	}
+
+	// Closed connections and errors also count as ready, so that they are
+	// noticed when read
+	if (poll(fds.data(), fds.size(), timeout) > 0) {
+
+		for (pollfd& fd: fds) {
+
+			if (fd.revents) ready.push_back(fd.fd);
+
+		}
+
+	}
+#else
+	// There is no way to tell, so try every connection
+	if (timeout > 0) SDL_Delay(timeout);
+
+	ready = watched;
+#endif
+
+	return ready.size();
+
+}
+
+
+/**
+ * Determine whether or not the last wait found data on a connection.
+ *
+ * @param sock The connection socket
+ *
+ * @return True if there is data, or the connection has closed
+ */
+bool Network::isReady (int sock) {
+
+	return std::find(ready.begin(), ready.end(), sock) != ready.end();
+
+}
+
+
+/**
+ * Reset the traffic counters.
+ */
+void Network::resetStats () {
+
+	statsTime = globalTicks;
+	sentBytes = sendCalls = 0;
+	receivedBytes = recvCalls = 0;
+	waitCalls = 0;
+
+}
+
+
+/**
+ * Log the traffic since the counters were reset.
+ */
+void Network::logStats () {
+
+	unsigned int seconds = (globalTicks - statsTime) / 1000;
+
+	if (!seconds) seconds = 1;
+
+	LOG_INFO("Network: sent %u bytes in %u calls, received %u bytes in %u calls over %u s.",
+		sentBytes, sendCalls, receivedBytes, recvCalls, seconds);
+	LOG_INFO("Network: %u bytes/s and %u calls/s out, %u bytes/s and %u calls/s in, %u waits/s.",
+		sentBytes / seconds, sendCalls / seconds, receivedBytes / seconds, recvCalls / seconds,
+		waitCalls / seconds);
+
+}
+
+
+/**
+ * Create an empty buffer.
+ */
+RingBuffer::RingBuffer () {
+
+	clear();
+
+}
+
+
+/**
+ * Discard all data.
+ */
+void RingBuffer::clear () {
+
+	start = 0;
+	length = 0;
+
+}
+
+
+/**
+ * Receive as much data as will fit in one go.
+ *
+ * @param sock Connection socket
+ *
+ * @return Number of bytes received, or -1 if the connection has closed
+ */
+int RingBuffer::receive (int sock) {
+
+	int end, space, ret;
+
+	end = (start + length) & (RING_LENGTH - 1);
+	space = RING_LENGTH - length;
+
+	// Only fill up to the end of the buffer
+	if (end + space > RING_LENGTH) space = RING_LENGTH - end;
+
+	if (!space) return 0;
+
+	ret = net->recv(sock, data + end, space);
+
+	if (ret > 0) {
+
+		length += ret;
+
+		return ret;
+
+	}
+
+	// Nothing more has arrived on an open connection
+	if ((ret < 0) && net->wouldBlock()) return 0;
+
+	return -1;
+
+}
+
+
+/**
+ * Take the next whole message out of the buffer.
+ *
+ * @param buffer Buffer to receive the message. First byte indicates length.
+ *
+ * @return Whether or not a whole message was available
+ */
+bool RingBuffer::getMessage (unsigned char *buffer) {
+
+	int count, messageLength;
+
+	// Skip anything too short to be a message
+	while (length && (data[start] < 2)) {
+
+		start = (start + 1) & (RING_LENGTH - 1);
+		length--;
+
+	}
+
+	if (!length) return false;
+
+	messageLength = data[start];
+
+	if (length < messageLength) return false;
+
+	for (count = 0; count < messageLength; count++)
+		buffer[count] = data[(start + count) & (RING_LENGTH - 1)];
+
+	start = (start + messageLength) & (RING_LENGTH - 1);
+	length -= messageLength;
+
+	return true;
+
+}
@@ -23,6 +23,8 @@
 
 #include "OpenJazz.h"
 
+#include <vector>
+
 #ifdef USE_SDL_NET
 #include <SDL_net.h>
 #endif
@@ -46,12 +48,43 @@
 // Level file
 #define LEVEL_FILE  "openjazz.tmp"
 
+// Size of the buffer for data received over a connection, a power of two
+#define RING_LENGTH 4096
+
+
+// Classes
+
+/// Data received over a connection, from which whole messages can be taken
+class RingBuffer {
+
+	private:
+		unsigned char data[RING_LENGTH]; ///< Received data
+		int           start; ///< Position of the first unread byte
+		int           length; ///< Number of unread bytes
 
-// Class
+	public:
+		RingBuffer ();
+
+		void clear      ();
+		int  receive    (int sock);
+		bool getMessage (unsigned char *buffer);
+
+};
 
 /// Networking
 class Network {
 
+	private:
+		std::vector<int> watched; ///< Connections to wait for
+		std::vector<int> ready; ///< Connections with data waiting, found by the last wait
+		int              epollFd; ///< epoll instance (Linux only)
+		unsigned int     statsTime; ///< Time at which the counters were reset
+		unsigned int     sentBytes; ///< Number of bytes sent
+		unsigned int     sendCalls; ///< Number of calls made to send data
+		unsigned int     receivedBytes; ///< Number of bytes received
+		unsigned int     recvCalls; ///< Number of calls made to receive data
+		unsigned int     waitCalls; ///< Number of calls made to wait for data
+
 	public:
 #ifdef USE_SDL_NET
 		TCPsocket socket;
@@ -68,9 +101,17 @@ class Network {
 		int  accept      (int sock);
 		void close       (int sock);
 		int  send        (int sock, unsigned char *buffer);
+		int  send        (int sock, unsigned char *buffer, int length);
 		int  recv        (int sock, unsigned char *buffer, int length);
 		bool isConnected (int sock);
 		int  getError    ();
+		bool wouldBlock  ();
+		void watch       (int sock);
+		void unwatch     (int sock);
+		int  wait        (int timeout);
+		bool isReady     (int sock);
+		void resetStats  ();
+		void logStats    ();
 
 };
 
@@ -78,6 +119,7 @@ class Network {
 // Variables
 
 EXTERN char    *netAddress; /// Server address
+EXTERN int      netProtocol; /// Protocol version offered when hosting
 EXTERN Network *net;
 
 #endif
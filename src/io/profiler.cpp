@@ -0,0 +1,335 @@
+/**
+ *
+ * @file profiler.cpp
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ * @par Description:
+ * Measures how long each phase of a frame takes, for display on-screen and for
+ * export as a Chrome trace (viewable with chrome://tracing or Perfetto).
+ *
+ */
+
+
+#include "profiler.h"
+
+#include "io/file.h"
+#include "io/log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+/// Names of the phases, as shown on-screen and in traces
+static const char* phaseNames[PP_PHASES] = {
+	"step", "spawn", "bullets", "control", "events", "move",
+	"draw", "sky", "bg", "events", "players", "fg",
+	"palette", "flip"
+};
+
+/// Trace categories of the phases
+static const char* phaseCategories[PP_PHASES] = {
+	"step", "step", "step", "step", "step", "step",
+	"draw", "draw", "draw", "draw", "draw", "draw",
+	"video", "video"
+};
+
+
+/**
+ * Create the profiler.
+ */
+Profiler::Profiler () {
+
+	traceFile = nullptr;
+	traceEmpty = true;
+
+#if OJ_SDL3 || OJ_SDL2
+	// SDL has not been started yet, so the frequency is found when needed
+	frequency = 0;
+#else
+	frequency = 1000;
+#endif
+
+	origin = 0;
+	frames = 0;
+
+	for (int i = 0; i < PP_PHASES; i++)
+		frameTime[i] = averageTime[i] = peakTime[i] = shownPeakTime[i] = 0;
+
+}
+
+
+/**
+ * Finish any trace and delete the profiler.
+ */
+Profiler::~Profiler () {
+
+	stopTrace();
+
+}
+
+
+/**
+ * Get the current timer value.
+ *
+ * @return Timer value, in timer counts
+ */
+Uint64 Profiler::getTime () {
+
+#if OJ_SDL3 || OJ_SDL2
+	return SDL_GetPerformanceCounter();
+#else
+	return SDL_GetTicks();
+#endif
+
+}
+
+
+/**
+ * Convert timer counts to microseconds, without overflowing.
+ *
+ * @param counts Number of timer counts
+ *
+ * @return Number of microseconds
+ */
+Uint64 Profiler::toMicroseconds (Uint64 counts) {
+
+#if OJ_SDL3 || OJ_SDL2
+	if (!frequency) frequency = SDL_GetPerformanceFrequency();
+#endif
+
+	return ((counts / frequency) * 1000000) +
+		(((counts % frequency) * 1000000) / frequency);
+
+}
+
+
+/**
+ * Write an event to the trace.
+ *
+ * @param event JSON object describing the event
+ */
+void Profiler::storeEvent (const char* event) {
+
+	if (!traceEmpty) traceFile->storeData((void *)",\n", 2);
+
+	traceFile->storeData((void *)event, strlen(event));
+	traceEmpty = false;
+
+}
+
+
+/**
+ * Add the time spent in a phase.
+ *
+ * @param phase The phase
+ * @param start Timer value at the start of the phase
+ * @param end Timer value at the end of the phase
+ */
+void Profiler::add (ProfilePhase phase, Uint64 start, Uint64 end) {
+
+	unsigned int duration = (unsigned int)toMicroseconds(end - start);
+
+	frameTime[phase] += duration;
+
+	if (traceFile) {
+
+		char event[128];
+
+		snprintf(event, sizeof(event),
+			"{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%u,\"pid\":1,\"tid\":1}",
+			phaseNames[phase], phaseCategories[phase],
+			(unsigned long long)toMicroseconds(start - origin), duration);
+
+		storeEvent(event);
+
+	}
+
+}
+
+
+/**
+ * Finish collecting the times of the current frame.
+ */
+void Profiler::endFrame () {
+
+	for (int i = 0; i < PP_PHASES; i++) {
+
+		// Respond to changes gradually, like the fps counter
+		averageTime[i] = ((averageTime[i] * 15) + frameTime[i]) >> 4;
+
+		if (frameTime[i] > peakTime[i]) peakTime[i] = frameTime[i];
+
+		frameTime[i] = 0;
+
+	}
+
+	if (++frames == PROFILE_WINDOW) {
+
+		memcpy(shownPeakTime, peakTime, sizeof(peakTime));
+		memset(peakTime, 0, sizeof(peakTime));
+
+		frames = 0;
+
+	}
+
+	if (traceFile) {
+
+		char event[96];
+
+		snprintf(event, sizeof(event),
+			"{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%llu,\"pid\":1,\"tid\":1}",
+			(unsigned long long)toMicroseconds(getTime() - origin));
+
+		storeEvent(event);
+
+	}
+
+}
+
+
+/**
+ * Start writing every timed phase to a Chrome trace.
+ *
+ * @param fileName Name of the file to write the trace to
+ */
+void Profiler::startTrace (const char* fileName) {
+
+	stopTrace();
+
+	try {
+
+		traceFile = new File(fileName, PATH_TYPE_TEMP, true);
+
+	} catch (int e) {
+
+		return;
+
+	}
+
+	traceFile->storeData((void *)"{\"traceEvents\":[\n", 17);
+	traceEmpty = true;
+	origin = getTime();
+
+	LOG_INFO("Writing trace to %s", fileName);
+
+}
+
+
+/**
+ * Finish writing the trace.
+ */
+void Profiler::stopTrace () {
+
+	if (!traceFile) return;
+
+	traceFile->storeData((void *)"\n],\"displayTimeUnit\":\"ms\"}\n", 27);
+
+	delete traceFile;
+	traceFile = nullptr;
+
+}
+
+
+/**
+ * Get the name of a phase.
+ *
+ * @param phase The phase
+ *
+ * @return The name
+ */
+const char* Profiler::getName (ProfilePhase phase) {
+
+	return phaseNames[phase];
+
+}
+
+
+/**
+ * Get the smoothed time spent in a phase per frame.
+ *
+ * @param phase The phase
+ *
+ * @return The time, in microseconds
+ */
+unsigned int Profiler::getAverage (ProfilePhase phase) {
+
+	return averageTime[phase];
+
+}
+
+
+/**
+ * Get the longest time spent in a phase in a single frame, over the last
+ * complete window of frames.
+ *
+ * @param phase The phase
+ *
+ * @return The time, in microseconds
+ */
+unsigned int Profiler::getPeak (ProfilePhase phase) {
+
+	return shownPeakTime[phase];
+
+}
+
+
+/**
+ * Start timing a phase.
+ *
+ * @param firstPhase The phase
+ */
+ProfileTimer::ProfileTimer (ProfilePhase firstPhase) {
+
+	phase = firstPhase;
+	start = profiler.getTime();
+	running = true;
+
+}
+
+
+/**
+ * Finish timing the current phase, if any.
+ */
+ProfileTimer::~ProfileTimer () {
+
+	stop();
+
+}
+
+
+/**
+ * Finish timing the current phase and start timing another.
+ *
+ * @param nextPhase The next phase
+ */
+void ProfileTimer::next (ProfilePhase nextPhase) {
+
+	Uint64 now = profiler.getTime();
+
+	if (running) profiler.add(phase, start, now);
+
+	phase = nextPhase;
+	start = now;
+	running = true;
+
+}
+
+
+/**
+ * Finish timing the current phase.
+ */
+void ProfileTimer::stop () {
+
+	if (running) profiler.add(phase, start, profiler.getTime());
+
+	running = false;
+
+}
+
@@ -0,0 +1,117 @@
+/**
+ *
+ * @file profiler.h
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ */
+
+#ifndef OJ_PROFILER_H
+#define OJ_PROFILER_H
+
+
+#include "OpenJazz.h"
+
+#ifdef OJ_SDL3
+	#include <SDL3/SDL.h>
+#else
+	#include <SDL.h>
+#endif
+
+
+// Constants
+
+/// Number of frames over which the longest duration of each phase is found
+#define PROFILE_WINDOW 64
+
+
+// Enums
+
+/// Timed phases of a frame
+enum ProfilePhase {
+
+	PP_STEP = 0, ///< Level step, as a whole
+	PP_SPAWN, ///< Creating events that have come into view
+	PP_BULLETS, ///< Bullet behaviour
+	PP_CONTROL, ///< Player control
+	PP_EVENTS, ///< Event behaviour
+	PP_MOVE, ///< Player movement
+	PP_DRAW, ///< Level drawing, as a whole
+	PP_SKY, ///< Sky or blank background
+	PP_BACKGROUND, ///< Background tiles
+	PP_DRAWEVENTS, ///< Events
+	PP_PLAYERS, ///< Players and bullets
+	PP_FOREGROUND, ///< Foreground tiles
+	PP_PALETTE, ///< Palette effects
+	PP_FLIP, ///< Showing the frame, including palette effects
+	PP_PHASES ///< Number of phases
+
+};
+
+
+// Classes
+
+class File;
+
+/// Collects the time spent in each phase of a frame
+class Profiler {
+
+	private:
+		File*        traceFile; ///< Chrome trace being written
+		bool         traceEmpty; ///< Whether or not the trace has no events yet
+		Uint64       frequency; ///< Timer counts per second
+		Uint64       origin; ///< Timer value when the trace started
+		unsigned int frameTime[PP_PHASES]; ///< Time spent in each phase during the current frame, in microseconds
+		unsigned int averageTime[PP_PHASES]; ///< Smoothed time spent in each phase per frame
+		unsigned int peakTime[PP_PHASES]; ///< Longest time spent in each phase in the current window
+		unsigned int shownPeakTime[PP_PHASES]; ///< Longest time spent in each phase in the last complete window
+		int          frames; ///< Number of frames in the current window
+
+		void         storeEvent (const char* event);
+
+	public:
+		Profiler  ();
+		~Profiler ();
+
+		Uint64       getTime    ();
+		Uint64       toMicroseconds (Uint64 counts);
+		void         add        (ProfilePhase phase, Uint64 start, Uint64 end);
+		void         endFrame   ();
+		void         startTrace (const char* fileName);
+		void         stopTrace  ();
+		const char*  getName    (ProfilePhase phase);
+		unsigned int getAverage (ProfilePhase phase);
+		unsigned int getPeak    (ProfilePhase phase);
+
+};
+
+/// Times a phase, or a sequence of phases, until it goes out of scope
+class ProfileTimer {
+
+	private:
+		ProfilePhase phase; ///< Phase being timed
+		Uint64       start; ///< Timer value when the phase started
+		bool         running; ///< Whether or not a phase is being timed
+
+	public:
+		explicit ProfileTimer (ProfilePhase firstPhase);
+		~ProfileTimer         ();
+
+		void next (ProfilePhase nextPhase);
+		void stop ();
+
+};
+
+
+// Variable
+
+EXTERN Profiler profiler; ///< Frame phase timing
+
+#endif
+
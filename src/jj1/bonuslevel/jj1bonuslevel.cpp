@@ -27,14 +27,18 @@
 
 #include "game/game.h"
 #include "game/gamemode.h"
+#include "game/replay.h"
+#include "io/assetcache.h"
 #include "io/controls.h"
 #include "io/file.h"
 #include "io/gfx/font.h"
 #include "io/gfx/paletteeffects.h"
 #include "io/gfx/sprite.h"
 #include "io/gfx/video.h"
+#include "io/profiler.h"
 #include "io/sound.h"
 #include "io/log.h"
+#include "loop.h"
 #include "util.h"
 
 #include <string.h>
@@ -84,7 +88,7 @@ int JJ1BonusLevel::loadSprites () {
 
 			// Read scrambled, masked pixel data
 			pixels = file->loadPixels(width * height, 0);
-			spriteSet[i].setPixels(pixels, width, height, 0);
+			spriteAtlas.add(spriteSet + i, pixels, width, height, 0);
 
 			delete[] pixels;
 
@@ -96,7 +100,7 @@ int JJ1BonusLevel::loadSprites () {
 
 			// Read pixel data
 			pixels = file->loadBlock(width * height);
-			spriteSet[i].setPixels(pixels, width, height, 0);
+			spriteAtlas.add(spriteSet + i, pixels, width, height, 0);
 
 			delete[] pixels;
 
@@ -111,6 +115,8 @@ int JJ1BonusLevel::loadSprites () {
 
 	}
 
+	spriteAtlas.pack();
+
 	return E_NONE;
 
 }
@@ -201,15 +207,12 @@ JJ1BonusLevel::JJ1BonusLevel (Game* owner, char * fileName, bool multi) : Level(
 	char *string, *fileString;
 	int count, x, y;
 
-	try {
-
-		font = new Font(true);
-
-	} catch (int e) {
+	FontAsset* fontAsset = static_cast<FontAsset*>(assetCache.acquire(JJ1_BONUS_FONT_ASSET));
 
-		throw;
+	if (!fontAsset)
+		fontAsset = static_cast<FontAsset*>(assetCache.add(JJ1_BONUS_FONT_ASSET, new FontAsset(true)));
 
-	}
+	font = fontAsset->font;
 	#if DEBUG_FONTS
 	font->saveAtlasAsBMP("bonusfont.bmp");
 	#endif
@@ -220,7 +223,7 @@ JJ1BonusLevel::JJ1BonusLevel (Game* owner, char * fileName, bool multi) : Level(
 
 	} catch (int e) {
 
-		delete font;
+		assetCache.release(JJ1_BONUS_FONT_ASSET);
 
 		throw;
 
@@ -231,7 +234,7 @@ JJ1BonusLevel::JJ1BonusLevel (Game* owner, char * fileName, bool multi) : Level(
 
 	if (count < 0) {
 
-		delete font;
+		assetCache.release(JJ1_BONUS_FONT_ASSET);
 
 		throw count;
 
@@ -247,7 +250,13 @@ JJ1BonusLevel::JJ1BonusLevel (Game* owner, char * fileName, bool multi) : Level(
 	delete[] string;
 	delete[] fileString;
 
-	if (x != E_NONE) throw x;
+	if (x != E_NONE) {
+
+		assetCache.release(JJ1_BONUS_FONT_ASSET);
+
+		throw x;
+
+	}
 
 	// Skip Editor tileset files
 	file->seek(9 + 13);
@@ -380,6 +389,7 @@ JJ1BonusLevel::JJ1BonusLevel (Game* owner, char * fileName, bool multi) : Level(
 	// Unknown marker
 	if(file->loadShort() != 0xFFFF) {
 		LOG_WARN("Invalid bonus level");
+		assetCache.release(JJ1_BONUS_FONT_ASSET);
 		throw E_FILE;
 	}
 
@@ -440,7 +450,7 @@ JJ1BonusLevel::~JJ1BonusLevel () {
 
 	delete[] spriteSet;
 
-	delete font;
+	assetCache.release(JJ1_BONUS_FONT_ASSET);
 
 	resampleSounds();
 
@@ -532,6 +542,9 @@ void JJ1BonusLevel::receive (unsigned char* buffer) {
  * @return Error code
  */
 int JJ1BonusLevel::step () {
+
+	ProfileTimer stepTimer(PP_STEP);
+
 	// Check if time has run out
 	if (ticks > endTime) {
 		playSound(SE::OW);
@@ -539,9 +552,9 @@ int JJ1BonusLevel::step () {
 		return LOST;
 	}
 
-	// Apply controls to local player
+	// Apply controls (or replayed controls) to local player
 	for (int i = 0; i < PCONTROLS; i++)
-		localPlayer->setControl(i, controls.getState(i));
+		localPlayer->setControl(i, replay.isPlaying()? replay.getControl(i): controls.getState(i));
 
 	// Process players
 	for (int i = 0; i < nPlayers; i++) {
@@ -776,7 +789,16 @@ int JJ1BonusLevel::play () {
 
 		// Process frame-by-frame activity
 
-		while ((getTimeChange() >= T_STEP) && (stage == LS_NORMAL)) {
+		while (stepDue()) {
+
+			// Once the level has ended, time passes without any steps
+			if (stage != LS_NORMAL) {
+
+				steps++;
+
+				continue;
+
+			}
 
 			ret = step();
 			steps++;
@@ -789,6 +811,8 @@ int JJ1BonusLevel::play () {
 
 			}
 
+			if (countStep() == E_QUIT) return E_QUIT;
+
 		}
 
 
@@ -796,6 +820,9 @@ int JJ1BonusLevel::play () {
 
 		if ((ticks < returnTime) && !paused) direction += (ticks - prevTicks) * T_BONUS_END / (returnTime - ticks);
 
+		// Nothing is shown in headless mode
+		if (headless) continue;
+
 		draw();
 
 		// If paused, draw "PAUSE"
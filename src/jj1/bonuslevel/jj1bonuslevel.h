@@ -36,6 +36,9 @@
 
 #define T_BONUS_END 2000
 
+// Asset cache key
+#define JJ1_BONUS_FONT_ASSET "BONUS.000/font"
+
 
 // Datatype
 
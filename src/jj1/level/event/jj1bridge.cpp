@@ -59,7 +59,7 @@ JJ1Bridge::JJ1Bridge (unsigned char gX, unsigned char gY) : JJ1Event(gX, gY) {
  *
  * @param ticks Time
  *
- * @return Remaining event
+ * @return The event (NULL if it is to be deleted)
  */
 JJ1Event* JJ1Bridge::step (unsigned int ticks) {
 
@@ -114,8 +114,6 @@ void JJ1Bridge::draw (unsigned int ticks, int change) {
 
 	int count;
 
-	if (next) next->draw(ticks, change);
-
 	// If the event has been removed from the grid, do not show it
 	if (!set) return;
 
@@ -35,6 +35,7 @@
 
 #include "../jj1level.h"
 #include "jj1event.h"
+#include "jj1eventgrid.h"
 
 #include "io/gfx/video.h"
 #include "io/sound.h"
@@ -56,11 +57,12 @@ JJ1Event::JJ1Event (unsigned char gX, unsigned char gY) {
 	dx = 0;
 	dy = 0;
 
-	next = level->getEvents();
 	gridX = gX;
 	gridY = gY;
 	flashTime = 0;
 
+	level->trackEvent(gX, gY);
+
 	animType = E_NOANIM;
 	anim = NULL;
 	noAnimOffset = false;
@@ -70,49 +72,33 @@ JJ1Event::JJ1Event (unsigned char gX, unsigned char gY) {
 	width = F32;
 	height = F32;
 
+	gridGeneration = gridOrder = gridSearch = 0;
+
 }
 
 
 /**
- * Delete all events
+ * Delete event
  */
 JJ1Event::~JJ1Event () {
 
-	if (next) delete next;
-
 }
 
 
 /**
- * Delete this event
+ * Detach this event from the level, ready for deletion
  *
  * @param permanently Whether or not to delete the event from the level
  *
- * @return The next event
+ * @return NULL, so the level deletes the event
  */
 JJ1Event* JJ1Event::remove (bool permanently) {
 
-	JJ1Event *oldNext;
-
 	if (permanently) level->clearEvent(gridX, gridY);
 
-	oldNext = next;
-	next = NULL;
-	delete this;
-
-	return oldNext;
-
-}
-
-
-/**
- * Get the next event
- *
- * @return The next event
- */
-JJ1Event * JJ1Event::getNext () {
+	level->untrackEvent(gridX, gridY);
 
-	return next;
+	return NULL;
 
 }
 
@@ -213,6 +199,8 @@ void JJ1Event::calcDimensions () {
 
 	}
 
+	level->getEventGrid()->update(this);
+
 }
 
 
@@ -282,9 +270,6 @@ void JJ1Event::setAnimFrame (int frame, bool looping) {
  */
 JJ1EventType* JJ1Event::prepareStep (unsigned int ticks) {
 
-	// Process the next event
-	if (next) next = next->step(ticks);
-
 	// If the event has been removed from the grid, destroy it
 	if (!set) return NULL;
 
@@ -304,20 +289,20 @@ JJ1EventType* JJ1Event::prepareStep (unsigned int ticks) {
 
 
 /**
- * Draw the event's energy bar
+ * Draw the event's energy bar, if it is a guardian
  *
  * @param ticks Time
+ *
+ * @return Whether or not the event is a guardian
  */
-void JJ1Event::drawEnergy (unsigned int ticks) {
+bool JJ1Event::drawEnergy (unsigned int ticks) {
 
 	Anim* miscAnim;
 	int hits;
 
 	if (!set || set->modifier != 8) {
 
-		if (next) next->drawEnergy(ticks);
-
-		return;
+		return false;
 
 	} else if (set->strength) {
 
@@ -343,4 +328,6 @@ void JJ1Event::drawEnergy (unsigned int ticks) {
 
 	}
 
+	return true;
+
 }
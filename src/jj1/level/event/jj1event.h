@@ -63,10 +63,15 @@ class JJ1LevelPlayer;
 class JJ1Event : public Movable {
 
 	private:
+		unsigned int gridGeneration; ///< Event grid generation the event was added to
+		unsigned int gridOrder; ///< Position among the active events when the event grid was built
+		unsigned int gridSearch; ///< Last event grid search that returned the event
+
 		void calcDimensions ();
 
+		friend class JJ1EventGrid;
+
 	protected:
-		JJ1Event*     next; ///< Next event
 		JJ1EventType* set; ///< Type
 		Anim*         anim; ///< Current animation
 		fixed         drawnX, drawnY; ///< Current drawing co-ordinates
@@ -89,7 +94,6 @@ class JJ1Event : public Movable {
 	public:
 		virtual ~JJ1Event ();
 
-		JJ1Event*      getNext        ();
 		bool           hit            (JJ1LevelPlayer *source, int hits, unsigned int ticks);
 		bool           isEnemy        ();
 		bool           isFrom         (unsigned char gX, unsigned char gY);
@@ -97,7 +101,7 @@ class JJ1Event : public Movable {
 
 		virtual JJ1Event* step        (unsigned int ticks) = 0;
 		virtual void      draw        (unsigned int ticks, int change) = 0;
-		void              drawEnergy  (unsigned int ticks);
+		bool              drawEnergy  (unsigned int ticks);
 
 };
 
@@ -0,0 +1,200 @@
+/**
+ *
+ * @file jj1eventgrid.cpp
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ * @par Description:
+ * Broad phase for collisions between events and bullets, birds and players.
+ *
+ */
+
+
+#include "jj1eventgrid.h"
+#include "jj1event.h"
+
+#include <algorithm>
+
+
+/**
+ * Create an empty event grid.
+ */
+JJ1EventGrid::JJ1EventGrid () {
+
+	indexed = 0;
+	generation = 1;
+	search = 0;
+	valid = false;
+
+}
+
+
+/**
+ * Add an event to all cells touched by its current bounds.
+ *
+ * @param event The event to add
+ */
+void JJ1EventGrid::insert (JJ1Event* event) {
+
+	// Anything off the edge of the map goes into the edge cells
+	int x1 = CLAMP(event->drawnX >> EGSHIFT, 0, EGW - 1);
+	int y1 = CLAMP(event->drawnY >> EGSHIFT, 0, EGH - 1);
+	int x2 = CLAMP((event->drawnX + event->width) >> EGSHIFT, 0, EGW - 1);
+	int y2 = CLAMP((event->drawnY + event->height) >> EGSHIFT, 0, EGH - 1);
+
+	for (int y = y1; y <= y2; y++) {
+
+		for (int x = x1; x <= x2; x++) cells[y][x].push_back(event);
+
+	}
+
+}
+
+
+/**
+ * Re-build the grid from the list of active events.
+ *
+ * Must be called after events have been created or removed, before searching.
+ *
+ * @param events The active events
+ */
+void JJ1EventGrid::build (JJ1EventPool* events) {
+
+	// Cells keep their capacity, so re-building does not usually allocate
+	for (int y = 0; y < EGH; y++) {
+
+		for (int x = 0; x < EGW; x++) cells[y][x].clear();
+
+	}
+
+	generation++;
+
+	indexed = events->getCount();
+
+	for (int i = 0; i < indexed; i++) {
+
+		JJ1Event* event = events->get(i);
+
+		event->gridGeneration = generation;
+		event->gridOrder = i;
+		insert(event);
+
+	}
+
+	valid = true;
+
+}
+
+
+/**
+ * Account for a change in an event's bounds since the grid was built.
+ *
+ * @param event The changed event
+ */
+void JJ1EventGrid::update (JJ1Event* event) {
+
+	// Stale entries are harmless, as candidates are always tested for overlap,
+	// so the event only needs adding to any newly touched cells
+	if (valid && (event->gridGeneration == generation)) insert(event);
+
+}
+
+
+/**
+ * Mark the grid as out of date, e.g. because events are about to be removed.
+ *
+ * Until the grid is re-built, searches return all active events.
+ */
+void JJ1EventGrid::invalidate () {
+
+	valid = false;
+	indexed = 0;
+
+}
+
+
+/**
+ * Find the events that may overlap the given area.
+ *
+ * The candidates are ordered from newest to oldest, matching a search of all
+ * active events, so the results of collision tests do not depend on the grid.
+ *
+ * @param x The x-coordinate of the left of the area
+ * @param y The y-coordinate of the top of the area
+ * @param width The width of the area
+ * @param height The height of the area
+ *
+ * @return The number of candidates
+ */
+int JJ1EventGrid::find (fixed x, fixed y, fixed width, fixed height) {
+
+	JJ1EventPool* events = level->getEvents();
+
+	candidates.clear();
+
+	// Events created since the grid was built are the newest
+	for (int i = events->getCount() - 1; i >= indexed; i--) {
+
+		if (events->get(i)) candidates.push_back(events->get(i));
+
+	}
+
+	if (!valid) return candidates.size();
+
+	size_t first = candidates.size();
+
+	search++;
+
+	int x1 = CLAMP(x >> EGSHIFT, 0, EGW - 1);
+	int y1 = CLAMP(y >> EGSHIFT, 0, EGH - 1);
+	int x2 = CLAMP((x + width) >> EGSHIFT, 0, EGW - 1);
+	int y2 = CLAMP((y + height) >> EGSHIFT, 0, EGH - 1);
+
+	for (int cellY = y1; cellY <= y2; cellY++) {
+
+		for (int cellX = x1; cellX <= x2; cellX++) {
+
+			for (JJ1Event* cellEvent: cells[cellY][cellX]) {
+
+				// Events spanning several cells are only returned once
+				if (cellEvent->gridSearch != search) {
+
+					cellEvent->gridSearch = search;
+					candidates.push_back(cellEvent);
+
+				}
+
+			}
+
+		}
+
+	}
+
+	// Restore the order of the active events, newest first
+	std::sort(candidates.begin() + first, candidates.end(),
+		[](JJ1Event* a, JJ1Event* b) { return a->gridOrder > b->gridOrder; });
+
+	return candidates.size();
+
+}
+
+
+/**
+ * Get a candidate from the last search.
+ *
+ * @param index The candidate's index
+ *
+ * @return The candidate
+ */
+JJ1Event* JJ1EventGrid::getCandidate (int index) {
+
+	return candidates[index];
+
+}
+
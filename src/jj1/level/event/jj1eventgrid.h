@@ -0,0 +1,63 @@
+/**
+ *
+ * @file jj1eventgrid.h
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ */
+
+#ifndef OJ_JJ1EVENTGRID_H
+#define OJ_JJ1EVENTGRID_H
+
+
+#include "../jj1level.h"
+
+#include "OpenJazz.h"
+
+#include <vector>
+
+
+// Constants
+
+// Each cell covers 4 * 4 grid elements
+#define EGSHIFT 17 /* Fixed to cell */
+#define EGW     (LW >> 2) /* Width, in cells */
+#define EGH     (LH >> 2) /* Height, in cells */
+
+
+// Class
+
+class JJ1Event;
+
+/// Uniform grid of active JJ1 events, used to find collision candidates
+class JJ1EventGrid {
+
+	private:
+		std::vector<JJ1Event*> cells[EGH][EGW]; ///< Events overlapping each cell
+		std::vector<JJ1Event*> candidates; ///< Results of the last search
+		int                    indexed; ///< Number of active events when the grid was built
+		unsigned int           generation; ///< Incremented every time the grid is built
+		unsigned int           search; ///< Incremented on every search
+		bool                   valid; ///< Whether or not the grid matches the active events
+
+		void insert (JJ1Event* event);
+
+	public:
+		JJ1EventGrid ();
+
+		void      build        (JJ1EventPool* events);
+		void      update       (JJ1Event* event);
+		void      invalidate   ();
+		int       find         (fixed x, fixed y, fixed width, fixed height);
+		JJ1Event* getCandidate (int index);
+
+};
+
+#endif
+
@@ -67,7 +67,7 @@ DeckGuardian::DeckGuardian (unsigned char gX, unsigned char gY) : Guardian(gX, g
  *
  * @param ticks Time
  *
- * @return Remaining event
+ * @return The event (NULL if it is to be deleted)
  */
 JJ1Event* DeckGuardian::step (unsigned int ticks) {
 
@@ -116,8 +116,6 @@ JJ1Event* DeckGuardian::step (unsigned int ticks) {
  */
 void DeckGuardian::draw (unsigned int ticks, int change) {
 
-	if (next) next->draw(ticks, change);
-
 	// If the event has been removed from the grid, do not show it
 	if (!set) return;
 
@@ -181,7 +179,7 @@ MedGuardian::MedGuardian(unsigned char gX, unsigned char gY) : Guardian(gX, gY)
  *
  * @param ticks Time
  *
- * @return Remaining event
+ * @return The event (NULL if it is to be deleted)
  */
 JJ1Event* MedGuardian::step(unsigned int ticks) {
 
@@ -400,8 +398,6 @@ void MedGuardian::draw(unsigned int ticks, int change) {
 	Anim *stageAnim;
 	unsigned char frame;
 
-	if (next) next->draw(ticks, change);
-
 	fixed xChange = getDrawX(change);
 	fixed yChange = getDrawY(change);
 
@@ -562,7 +562,7 @@ void JJ1StandardEvent::move (unsigned int ticks) {
  *
  * @param ticks Time
  *
- * @return Remaining event
+ * @return The event (NULL if it is to be deleted)
  */
 JJ1Event* JJ1StandardEvent::step (unsigned int ticks) {
 
@@ -1008,8 +1008,6 @@ JJ1Event* JJ1StandardEvent::step (unsigned int ticks) {
  */
 void JJ1StandardEvent::draw (unsigned int ticks, int change) {
 
-	if (next) next->draw(ticks, change);
-
 	// Uncomment the following to see the raw location
 	/*drawRect(FTOI(getDrawX(change)),
 		FTOI(getDrawY(change) - height), FTOI(width),
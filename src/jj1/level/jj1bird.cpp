@@ -23,6 +23,7 @@
 
 #include "jj1bullet.h"
 #include "event/jj1event.h"
+#include "event/jj1eventgrid.h"
 #include "jj1level.h"
 #include "jj1bird.h"
 #include "jj1levelplayer.h"
@@ -236,27 +237,15 @@ JJ1Bird* JJ1Bird::step (unsigned int ticks) {
 			// Check for nearby targets
 
 			bool target = false;
-			event = level->getEvents();
+			fixed targetX = player->getFacing()? x: x - F160;
 
-			if (player->getFacing()) {
+			JJ1EventGrid* eventGrid = level->getEventGrid();
+			int candidates = eventGrid->find(targetX, y, F160, F100);
 
-				while (event && !target) {
+			for (int i = 0; (i < candidates) && !target; i++) {
 
-					target = event->isEnemy() && event->overlap(x, y, F160, F100);
-
-					event = event->getNext();
-
-				}
-
-			} else {
-
-				while (event && !target) {
-
-					target = event->isEnemy() && event->overlap(x - F160, y, F160, F100);
-
-					event = event->getNext();
-
-				}
+				event = eventGrid->getCandidate(i);
+				target = event->isEnemy() && event->overlap(targetX, y, F160, F100);
 
 			}
 
@@ -23,6 +23,7 @@
 
 #include "jj1bullet.h"
 #include "event/jj1event.h"
+#include "event/jj1eventgrid.h"
 #include "jj1level.h"
 #include "jj1bird.h"
 #include "jj1levelplayer.h"
@@ -38,7 +39,6 @@
 /**
  * Generic bullet constructor.
  *
- * @param nextBullet The next bullet
  * @param sourcePlayer The player that fired the bullet (if any)
  * @param startX The starting x-coordinate of the bullet
  * @param startY The starting y-coordinate of the bullet
@@ -46,9 +46,8 @@
  * @param newDirection The direction of the bullet
  * @param ticks Time
  */
-JJ1Bullet::JJ1Bullet (JJ1Bullet* nextBullet, JJ1LevelPlayer* sourcePlayer, fixed startX, fixed startY, signed char* bullet, int newDirection, unsigned int ticks) {
+JJ1Bullet::JJ1Bullet (JJ1LevelPlayer* sourcePlayer, fixed startX, fixed startY, signed char* bullet, int newDirection, unsigned int ticks) {
 
-	next = nextBullet;
 	source = sourcePlayer;
 	set = bullet;
 	direction = newDirection;
@@ -82,29 +81,13 @@ JJ1Bullet::JJ1Bullet (JJ1Bullet* nextBullet, JJ1LevelPlayer* sourcePlayer, fixed
 
 
 /**
- * Delete all bullets.
- */
-JJ1Bullet::~JJ1Bullet () {
-
-	if (next) delete next;
-
-}
-
-
-/**
- * Delete this bullet.
+ * Mark this bullet for deletion.
  *
- * @return The next bullet
+ * @return NULL, so the level deletes the bullet
  */
 JJ1Bullet* JJ1Bullet::remove () {
 
-	JJ1Bullet* oldNext;
-
-	oldNext = next;
-	next = NULL;
-	delete this;
-
-	return oldNext;
+	return NULL;
 
 }
 
@@ -126,14 +109,10 @@ JJ1LevelPlayer* JJ1Bullet::getSource () {
  *
  * @param ticks Time
  *
- * @return Remaining bullet
+ * @return The bullet (NULL if it is to be deleted)
  */
 JJ1Bullet* JJ1Bullet::step (unsigned int ticks) {
 
-	// Process the next bullet
-	if (next) next = next->step(ticks);
-
-
 	if (level->getStage() != LS_END) {
 
 		// If the time has expired, destroy the bullet
@@ -158,9 +137,13 @@ JJ1Bullet* JJ1Bullet::step (unsigned int ticks) {
 
 			// Check if an event has been hit
 
-			JJ1Event* event = level->getEvents();
+			JJ1EventGrid* eventGrid = level->getEventGrid();
+			int candidates = eventGrid->find(x, y,
+				ITOF(sprite->getWidth()), ITOF(sprite->getHeight()));
 
-			while (event) {
+			for (int i = 0; i < candidates; i++) {
+
+				JJ1Event* event = eventGrid->getCandidate(i);
 
 				// Check if the event has been hit
 				if (event->overlap(x, y,
@@ -171,8 +154,6 @@ JJ1Bullet* JJ1Bullet::step (unsigned int ticks) {
 
 				}
 
-				event = event->getNext();
-
 			}
 
 		}
@@ -251,8 +232,6 @@ JJ1Bullet* JJ1Bullet::step (unsigned int ticks) {
  */
 void JJ1Bullet::draw (int change) {
 
-	if (next) next->draw(change);
-
 	// Show the bullet
 	sprite->draw(FTOI(getDrawX(change)), FTOI(getDrawY(change)), false);
 
@@ -59,7 +59,6 @@ class Sprite;
 class JJ1Bullet : public Movable {
 
 	private:
-		JJ1Bullet*      next; ///< The next bullet
 		JJ1LevelPlayer* source; ///< Source player. If NULL, was fired by an event
 		Sprite*         sprite; ///< Sprite
 		signed char*    set; ///< Bullet type properties
@@ -69,8 +68,7 @@ class JJ1Bullet : public Movable {
 		JJ1Bullet* remove ();
 
 	public:
-		JJ1Bullet  (JJ1Bullet* nextBullet, JJ1LevelPlayer* sourcePlayer, fixed startX, fixed startY, signed char *bullet, int newDirection, unsigned int ticks);
-		~JJ1Bullet ();
+		JJ1Bullet (JJ1LevelPlayer* sourcePlayer, fixed startX, fixed startY, signed char *bullet, int newDirection, unsigned int ticks);
 
 		JJ1LevelPlayer* getSource ();
 		JJ1Bullet*      step      (unsigned int ticks);
@@ -168,7 +168,7 @@ int JJ1DemoLevel::play () {
 		// Process frame-by-frame activity
 
 		// Process step
-		while (getTimeChange() >= T_STEP) {
+		while (stepDue()) {
 
 			int ret = step();
 			steps++;
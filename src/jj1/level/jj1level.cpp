@@ -36,12 +36,15 @@
 
 #include "jj1bullet.h"
 #include "event/jj1event.h"
+#include "event/jj1eventgrid.h"
 #include "jj1level.h"
 #include "jj1levelplayer.h"
+#include "jj1tilecache.h"
 #include "jj1/jj1episodeutils.h"
 
 #include "game/game.h"
 #include "game/gamemode.h"
+#include "game/replay.h"
 #include "io/controls.h"
 #include "io/file.h"
 #include "io/gfx/font.h"
@@ -50,6 +53,7 @@
 #include "io/gfx/video.h"
 #include "io/sound.h"
 #include "io/log.h"
+#include "loop.h"
 #include "util.h"
 
 #include <string.h>
@@ -67,7 +71,9 @@ JJ1Level::JJ1Level (Game* owner) : Level(owner) {
 	for (int i = 0; i < 2; i++)
 		panelBG[i] = nullptr;
 	events = nullptr;
+	eventGrid = nullptr;
 	bullets = nullptr;
+	tileCache = nullptr;
 	sceneFile = nullptr;
 	spriteSet = nullptr;
 	sky = false;
@@ -88,12 +94,13 @@ JJ1Level::JJ1Level (Game* owner) : Level(owner) {
  * @param fileName Name of the file containing the level data.
  * @param checkpoint Whether or not the player(s) will start at a checkpoint
  * @param multi Whether or not the level will be multi-player
+ * @param planet Planet approach to show while the level loads (nullptr for none)
  */
-JJ1Level::JJ1Level (Game* owner, char* fileName, bool checkpoint, bool multi) :
+JJ1Level::JJ1Level (Game* owner, char* fileName, bool checkpoint, bool multi, JJ1Planet* planet) :
 	Level (owner) {
 
 	// Load level data
-	int ret = load(fileName, checkpoint);
+	int ret = load(fileName, checkpoint, planet);
 	if (ret < 0) throw ret;
 
 	multiplayer = multi;
@@ -102,15 +109,33 @@ JJ1Level::JJ1Level (Game* owner, char* fileName, bool checkpoint, bool multi) :
 
 
 /**
- * Delete HUD graphical data.
+ * Stop using the HUD graphical data.
  */
 void JJ1Level::deletePanel () {
 
-	video.destroySurface(panel);
+	if (!panel) return;
+
+	assetCache.release(JJ1_PANEL_ASSET);
+
+	panel = nullptr;
 	for (int i = 0; i < 6; i++)
-		video.destroySurface(panelAmmo[i]);
+		panelAmmo[i] = nullptr;
 	for (int i = 0; i < 2; i++)
-		video.destroySurface(panelBG[i]);
+		panelBG[i] = nullptr;
+
+}
+
+
+/**
+ * Stop using the on-screen message font.
+ */
+void JJ1Level::deleteFont () {
+
+	if (!font) return;
+
+	assetCache.release(JJ1_FONT_ASSET);
+
+	font = nullptr;
 
 }
 
@@ -123,9 +148,13 @@ JJ1Level::~JJ1Level () {
 	// Free events
 	if (events) delete events;
 
+	delete eventGrid;
+
 	// Free bullets
 	if (bullets) delete bullets;
 
+	delete tileCache;
+
 	for (int i = 0; i < PATHS; i++) {
 
 		delete[] path[i].x;
@@ -142,7 +171,7 @@ JJ1Level::~JJ1Level () {
 
 	deletePanel();
 
-	delete font;
+	deleteFont();
 
 	resampleSounds();
 
@@ -280,6 +309,7 @@ void JJ1Level::setNext (int nextLevel, int nextWorld) {
 void JJ1Level::setTile (unsigned char gridX, unsigned char gridY, unsigned char tile) {
 
 	grid[gridY][gridX].tile = tile;
+	tileCache->invalidate(gridX, gridY);
 
 	if (multiplayer) {
 
@@ -306,15 +336,27 @@ difficultyType JJ1Level::getDifficulty () {
 /**
  * Get the active events.
  *
- * @return The first active event
+ * @return The active events, oldest first
  */
-JJ1Event* JJ1Level::getEvents () {
+JJ1EventPool* JJ1Level::getEvents () {
 
 	return events;
 
 }
 
 
+/**
+ * Get the broad phase for collisions with the active events.
+ *
+ * @return The event grid
+ */
+JJ1EventGrid* JJ1Level::getEventGrid () {
+
+	return eventGrid;
+
+}
+
+
 /**
  * Get the event data for the event from the given tile.
  *
@@ -334,6 +376,32 @@ JJ1EventType* JJ1Level::getEvent (unsigned char gridX, unsigned char gridY) {
 }
 
 
+/**
+ * Register a newly-created active event from the given tile.
+ *
+ * @param gridX X-coordinate of the tile
+ * @param gridY Y-coordinate of the tile
+ */
+void JJ1Level::trackEvent (unsigned char gridX, unsigned char gridY) {
+
+	grid[gridY][gridX].active++;
+
+}
+
+
+/**
+ * Unregister a removed active event from the given tile.
+ *
+ * @param gridX X-coordinate of the tile
+ * @param gridY Y-coordinate of the tile
+ */
+void JJ1Level::untrackEvent (unsigned char gridX, unsigned char gridY) {
+
+	if (grid[gridY][gridX].active) grid[gridY][gridX].active--;
+
+}
+
+
 /**
  * Get the hits incurred by the event from the given tile.
  *
@@ -377,6 +445,7 @@ void JJ1Level::clearEvent (unsigned char gridX, unsigned char gridY) {
 		eventSet[grid[gridY][gridX].event].strength) return;
 
 	grid[gridY][gridX].event = 0;
+	tileCache->invalidate(gridX, gridY);
 
 	if (multiplayer) {
 
@@ -616,13 +685,12 @@ void JJ1Level::createBullet (JJ1LevelPlayer* sourcePlayer, unsigned char gridX,
 
 	if (set[B_GRAVITY | direction] == 4) {
 
-		events = new JJ1StandardEvent(eventSet + set[B_SPRITE | direction], gridX, gridY, startX, startY + F32);
+		events->create<JJ1StandardEvent>(eventSet + set[B_SPRITE | direction], gridX, gridY, startX, startY + F32);
 
 	} else if (set[B_SPRITE | direction] != 0) {
 
 		// Create new bullet
-		level->bullets = new JJ1Bullet(level->bullets,
-			sourcePlayer,
+		bullets->create<JJ1Bullet>(sourcePlayer,
 			startX,
 			startY,
 			set,
@@ -632,8 +700,7 @@ void JJ1Level::createBullet (JJ1LevelPlayer* sourcePlayer, unsigned char gridX,
 		if (set[B_XSPEED | direction | 2] != 0) {
 
 			// Create the other bullet
-			level->bullets = new JJ1Bullet(level->bullets,
-				sourcePlayer,
+			bullets->create<JJ1Bullet>(sourcePlayer,
 				startX,
 				startY,
 				set,
@@ -730,6 +797,9 @@ void JJ1Level::receive (unsigned char* buffer) {
 			else if (buffer[4] == 3)
 				grid[buffer[3]][buffer[2]].hits = buffer[5];
 
+			// Tiles and events both decide what is drawn
+			tileCache->invalidate(buffer[2], buffer[3]);
+
 			break;
 
 		case MT_L_STAGE:
@@ -803,33 +873,43 @@ int JJ1Level::play () {
 
 		// Process frame-by-frame activity
 
-		while (getTimeChange() >= T_STEP) {
+		while (stepDue()) {
 
 			bool playerWasAlive = (localPlayer->getJJ1LevelPlayer()->getEnergy() != 0);
 
-			// Apply controls to local player
+			// Apply controls (or replayed controls) to local player
 			for (int i = 0; i < PCONTROLS; i++)
-				localPlayer->setControl(i, controls.getState(i));
+				localPlayer->setControl(i, replay.isPlaying()? replay.getControl(i): controls.getState(i));
 
 			ret = step();
 			steps++;
 
 			if (ret) return ret;
 
+			if (countStep() == E_QUIT) return E_QUIT;
+
 			if (!multiplayer && playerWasAlive && (localPlayer->getJJ1LevelPlayer()->getEnergy() == 0))
 				flash(0, 0, 0, T_END << 1);
 
 		}
 
 
-		// Draw the graphics
+		if (headless) {
 
-		draw();
+			// Nothing is shown, but events are still activated relative to
+			// the viewport
+			updateView(getTimeChange());
 
+		} else {
 
-		// If paused, draw "PAUSE"
-		if (pmessage && !pmenu)
-			font->showString("pause", (canvasW >> 1) - 44, 32);
+			// Draw the graphics
+			draw();
+
+			// If paused, draw "PAUSE"
+			if (pmessage && !pmenu)
+				font->showString("pause", (canvasW >> 1) - 44, 32);
+
+		}
 
 		// If paused, silence music
 		pauseMusic(pmessage && !pmenu);
@@ -898,28 +978,32 @@ int JJ1Level::play () {
 
 			// Display statistics & bonuses
 
-			font->showString("time", (canvasW >> 1) - 152, (canvasH >> 1) - 60);
-			font->showNumber(timeBonus, (canvasW >> 1) + 124, (canvasH >> 1) - 60);
+			if (!headless) {
 
-			font->showString("enemies", (canvasW >> 1) - 152, (canvasH >> 1) - 40);
-			font->showNumber(enemyPercent, (canvasW >> 1) + 124, (canvasH >> 1) - 40);
-			font->showString("%", (canvasW >> 1) + 124, (canvasH >> 1) - 40);
+				font->showString("time", (canvasW >> 1) - 152, (canvasH >> 1) - 60);
+				font->showNumber(timeBonus, (canvasW >> 1) + 124, (canvasH >> 1) - 60);
 
-			font->showString("items", (canvasW >> 1) - 152, (canvasH >> 1) - 20);
-			font->showNumber(itemPercent, (canvasW >> 1) + 124, (canvasH >> 1) - 20);
-			font->showString("%", (canvasW >> 1) + 124, (canvasH >> 1) - 20);
+				font->showString("enemies", (canvasW >> 1) - 152, (canvasH >> 1) - 40);
+				font->showNumber(enemyPercent, (canvasW >> 1) + 124, (canvasH >> 1) - 40);
+				font->showString("%", (canvasW >> 1) + 124, (canvasH >> 1) - 40);
 
-			font->showString("perfect", (canvasW >> 1) - 152, canvasH >> 1);
-			font->showNumber(perfect, (canvasW >> 1) + 124, canvasH >> 1);
+				font->showString("items", (canvasW >> 1) - 152, (canvasH >> 1) - 20);
+				font->showNumber(itemPercent, (canvasW >> 1) + 124, (canvasH >> 1) - 20);
+				font->showString("%", (canvasW >> 1) + 124, (canvasH >> 1) - 20);
 
-			font->showString("score", (canvasW >> 1) - 152, (canvasH >> 1) + 40);
-			font->showNumber(localPlayer->getScore(), (canvasW >> 1) + 124, (canvasH >> 1) + 40);
+				font->showString("perfect", (canvasW >> 1) - 152, canvasH >> 1);
+				font->showNumber(perfect, (canvasW >> 1) + 124, canvasH >> 1);
+
+				font->showString("score", (canvasW >> 1) - 152, (canvasH >> 1) + 40);
+				font->showNumber(localPlayer->getScore(), (canvasW >> 1) + 124, (canvasH >> 1) + 40);
+
+			}
 
 		}
 
 
 		// Draw statistics, menu etc.
-		drawOverlay(LEVEL_BLACK, pmenu, option, 15, 47, -16);
+		if (!headless) drawOverlay(LEVEL_BLACK, pmenu, option, 15, 47, -16);
 
 	}
 
@@ -32,7 +32,9 @@
 #define _LEVEL_H
 
 
+#include "jj1pool.h"
 #include "level/level.h"
+#include "io/assetcache.h"
 #include "io/gfx/anim.h"
 #include "OpenJazz.h"
 
@@ -55,6 +57,8 @@
 #define TSETS       4 /* Maximum number of tilesets (each 60 entries) */
 #define TKEY      127 /* Tileset colour key */
 #define MASKS     (TNUM * TSETS + 16) << 3
+#define AEVENTS  1024 /* Maximum number of active events */
+#define ABULLETS  256 /* Maximum number of active bullets */
 
 // Player animations
 #define PA_LWALK    0
@@ -140,6 +144,11 @@
 #define T_START 500
 #define T_END   1000
 
+// Asset cache keys
+#define JJ1_FONT_ASSET     "FONTS.000/font"
+#define JJ1_PANEL_ASSET    "PANEL.000/panel"
+#define JJ1_MAINCHAR_ASSET "MAINCHAR.000/sprites"
+
 
 // Datatypes
 
@@ -150,6 +159,7 @@ typedef struct {
 	unsigned char bg; ///< 0 = Effect background, 1 = Black background
 	unsigned char event; ///< Indexes the event set
 	unsigned char hits; ///< Number of times the event has been shot
+	unsigned char active; ///< Number of active events originating from this grid element
 	int           time; ///< Point at which the event will do something, e.g. terminate
 
 } GridElement;
@@ -193,54 +203,110 @@ typedef struct {
 class Font;
 class JJ1Bullet;
 class JJ1Event;
+class JJ1EventGrid;
+class JJ1Level;
 class JJ1LevelPlayer;
+class JJ1Planet;
+class JJ1TileCache;
+class Loader;
+
+typedef JJ1Pool<JJ1Event> JJ1EventPool;
+typedef JJ1Pool<JJ1Bullet> JJ1BulletPool;
+
+/// JJ1 HUD graphical data, the same in every level
+class JJ1PanelAsset : public Asset {
+
+	public:
+		SDL_Surface* panel; ///< HUD background image
+		SDL_Surface* panelBG[2]; ///< HUD background image borders
+		SDL_Surface* panelAmmo[6]; ///< HUD ammo type images
+
+		JJ1PanelAsset  ();
+		~JJ1PanelAsset ();
+
+		int getSize ();
+
+};
+
+/// The player's sprites from MAINCHAR.000, decoded as far as levels have needed
+class JJ1SpriteAsset : public SpriteImageAsset {
+
+	private:
+		int position; ///< Where decoding continues in the file (-1 once complete)
+
+	public:
+		JJ1SpriteAsset ();
+
+		int load (int count);
+
+};
+
+/// JJ1 level data decoded by the loader thread, waiting for the main thread
+struct JJ1LevelData {
+
+	JJ1Level*                level; ///< The level being loaded
+	char*                    fileName; ///< Name of the level file
+	Loader*                  loader; ///< Receives progress reports
+	File*                    file; ///< The level file
+	unsigned char*           tilePixels; ///< Tile images
+	int                      tiles; ///< Number of tiles
+	std::vector<SpriteImage> spriteImages; ///< Level-specific sprite images (no pixels to use mainchar.000's)
+	JJ1SpriteAsset*          mainSprites; ///< The player's sprites
+
+};
 
 /// JJ1 level
 class JJ1Level : public Level {
 
 	private:
-		SDL_Surface*  tileSet; ///< Tile images
-		SDL_Surface*  panel; ///< HUD background image
-		SDL_Surface*  panelBG[2]; ///< HUD background image borders
-		SDL_Surface*  panelAmmo[6]; ///< HUD ammo type images
-		JJ1Event*     events; ///< Active events
-		JJ1Bullet*    bullets; ///< Active bullets
-		char*         sceneFile; ///< File name of cutscene to play when level has been completed
-		Sprite*       spriteSet; ///< Sprites
-		Anim          animSet[ANIMS]; ///< Animations
-		char          miscAnims[JJ1MANIMS]; ///< Further animations
-		char          levelAnims[JJ1LANIMS]; ///< Level animations
-		char          playerAnims[JJ1PANIMS]; ///< Default player animations
-		signed char   bulletSet[BULLETS][BLENGTH]; ///< Bullet types
-		char          levelSounds[JJ1LSOUNDS]; ///< Level sounds
-		JJ1EventType  eventSet[EVENTS]; ///< Event types
-		char          mask[240][64]; ///< Tile masks. At most 240 tiles, all with 8 * 8 masks
-		GridElement   grid[LH][LW]; ///< Level grid. All levels are the same size
-		SDL_Color     skyPalette[MAX_PALETTE_COLORS]; ///< Full palette for sky background
-		bool          sky; ///< Whether or not to use sky background
-		unsigned char skyOrb; ///< The tile to use as the background sun/moon/etc.
-		int           levelNum; ///< Number of current level
-		int           worldNum; ///< Number of current world
-		int           nextLevelNum; ///< Number of next level
-		int           nextWorldNum; ///< Number of next world
-		int           enemies; ///< Number of enemies to kill
-		fixed         waterLevel; ///< Height of water
-		fixed         waterLevelTarget; ///< Future height of water
-		fixed         waterLevelSpeed; ///< Rate of water level change
-		fixed         energyBar; ///< HUD energy bar fullness
-		int           ammoType; ///< HUD ammo type
-		fixed         ammoOffset; ///< HUD ammo offset
-		int           nEnemies[4]; // Easy, Medium, Hard, Turbo
-		int           nItems;
+		SDL_Surface*   tileSet; ///< Tile images
+		SDL_Surface*   panel; ///< HUD background image
+		SDL_Surface*   panelBG[2]; ///< HUD background image borders
+		SDL_Surface*   panelAmmo[6]; ///< HUD ammo type images
+		JJ1EventPool*  events; ///< Active events
+		JJ1EventGrid*  eventGrid; ///< Broad phase for collisions with active events
+		JJ1BulletPool* bullets; ///< Active bullets
+		JJ1TileCache*  tileCache; ///< Pre-rendered background and foreground tiles
+		char*          sceneFile; ///< File name of cutscene to play when level has been completed
+		Sprite*        spriteSet; ///< Sprites
+		Anim           animSet[ANIMS]; ///< Animations
+		char           miscAnims[JJ1MANIMS]; ///< Further animations
+		char           levelAnims[JJ1LANIMS]; ///< Level animations
+		char           playerAnims[JJ1PANIMS]; ///< Default player animations
+		signed char    bulletSet[BULLETS][BLENGTH]; ///< Bullet types
+		char           levelSounds[JJ1LSOUNDS]; ///< Level sounds
+		JJ1EventType   eventSet[EVENTS]; ///< Event types
+		char           mask[240][64]; ///< Tile masks. At most 240 tiles, all with 8 * 8 masks
+		GridElement    grid[LH][LW]; ///< Level grid. All levels are the same size
+		SDL_Color      skyPalette[MAX_PALETTE_COLORS]; ///< Full palette for sky background
+		bool           sky; ///< Whether or not to use sky background
+		unsigned char  skyOrb; ///< The tile to use as the background sun/moon/etc.
+		int            levelNum; ///< Number of current level
+		int            worldNum; ///< Number of current world
+		int            nextLevelNum; ///< Number of next level
+		int            nextWorldNum; ///< Number of next world
+		int            enemies; ///< Number of enemies to kill
+		fixed          waterLevel; ///< Height of water
+		fixed          waterLevelTarget; ///< Future height of water
+		fixed          waterLevelSpeed; ///< Rate of water level change
+		fixed          energyBar; ///< HUD energy bar fullness
+		int            ammoType; ///< HUD ammo type
+		fixed          ammoOffset; ///< HUD ammo offset
+		int            nEnemies[4]; // Easy, Medium, Hard, Turbo
+		int            nItems;
 		// FIXME: actually use these
 		int animSpeed, jumpHeight;
 
-		void deletePanel  ();
-		int  loadPanel    ();
-		void loadSprite   (File* file, Sprite* sprite);
-		int  loadSprites  (char* fileName);
-		int  loadTiles    (char* fileName);
-		int  playBonus    ();
+		void deleteFont    ();
+		void deletePanel   ();
+		int  loadFont      ();
+		int  loadPanel     ();
+		int  decodeSprites (JJ1LevelData* data, char* fileName);
+		int  decodeTiles   (JJ1LevelData* data, char* fileName);
+		void createSprites (JJ1LevelData* data);
+		int  playBonus     ();
+
+		static int decode (void* data);
 
 	protected:
 		Font* font; ///< On-screen message font
@@ -248,14 +314,15 @@ class JJ1Level : public Level {
 
 		explicit JJ1Level(Game* owner);
 
-		int  load (char* fileName, bool checkpoint);
-		int  step ();
-		void draw ();
+		int  load       (char* fileName, bool checkpoint, JJ1Planet* planet = nullptr);
+		int  step       ();
+		int  updateView (unsigned int change);
+		void draw       ();
 
 	public:
 		JJ1EventPath path[PATHS]; ///< Pre-defined event movement paths
 
-		JJ1Level (Game* owner, char* fileName, bool checkpoint, bool multi);
+		JJ1Level (Game* owner, char* fileName, bool checkpoint, bool multi, JJ1Planet* planet = nullptr);
 		~JJ1Level () override;
 
 		bool           checkMaskUp   (fixed x, fixed y);
@@ -265,8 +332,11 @@ class JJ1Level : public Level {
 		void           setNext       (int nextLevel, int nextWorld);
 		void           setTile       (unsigned char gridX, unsigned char gridY, unsigned char tile);
 		difficultyType getDifficulty ();
-		JJ1Event*      getEvents     ();
+		JJ1EventPool*  getEvents     ();
+		JJ1EventGrid*  getEventGrid  ();
 		JJ1EventType*  getEvent      (unsigned char gridX, unsigned char gridY);
+		void           trackEvent    (unsigned char gridX, unsigned char gridY);
+		void           untrackEvent  (unsigned char gridX, unsigned char gridY);
 		unsigned char  getEventHits  (unsigned char gridX, unsigned char gridY);
 		unsigned int   getEventTime  (unsigned char gridX, unsigned char gridY);
 		void           clearEvent    (unsigned char gridX, unsigned char gridY);
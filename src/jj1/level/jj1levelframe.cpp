@@ -28,15 +28,18 @@
 
 #include "jj1bullet.h"
 #include "event/jj1event.h"
+#include "event/jj1eventgrid.h"
 #include "event/jj1guardians.h"
 #include "jj1level.h"
 #include "jj1levelplayer.h"
+#include "jj1tilecache.h"
 
 #include "game/game.h"
 #include "game/gamemode.h"
 #include "io/controls.h"
 #include "io/gfx/font.h"
 #include "io/gfx/video.h"
+#include "io/profiler.h"
 #include "util.h"
 
 
@@ -47,9 +50,10 @@
  */
 int JJ1Level::step () {
 
-	JJ1Event *event;
+	ProfileTimer stepTimer(PP_STEP);
+	ProfileTimer phaseTimer(PP_SPAWN);
 	int viewH = canvasH;
-	int x, y;
+	int x, y, count;
 
 	if(setup.hudStyle == hudType::Classic) {
 		// Can we see below the panel?
@@ -60,79 +64,104 @@ int JJ1Level::step () {
 		viewH = canvasH - 33;
 	}
 
-	// Search for active events
+	// Search for inactive events
 	for (y = FTOT(viewY) - 5; y < ITOT(FTOI(viewY) + viewH) + 5; y++) {
 
 		for (x = FTOT(viewX) - 5; x < ITOT(FTOI(viewX) + canvasW) + 5; x++) {
 
+			// Grid elements keep count of their active events, so there is no
+			// need to search the list of active events
 			if ((x >= 0) && (y >= 0) && (x < LW) && (y < LH) &&
 				grid[y][x].event && (grid[y][x].event < 121) &&
+				!grid[y][x].active &&
 				(+eventSet[grid[y][x].event].difficulty <= +getDifficulty())) {
 
-				event = events;
+				// The event hasn't been created yet, so create it
+				switch (getEvent(x, y)->movement) {
 
-				while (event) {
+					case 28:
 
-					// If the event has been found, stop searching
-					if (event->isFrom(x, y)) break;
+						events->create<JJ1Bridge>(x, y);
 
-					event = event->getNext();
+						break;
 
-				}
+					case 41:
 
-				// If the event wasn't found, create it
-				if (!event) {
+						events->create<MedGuardian>(x, y);
 
-					switch (getEvent(x, y)->movement) {
+						break;
 
-						case 28:
+					case 60:
 
-							events = new JJ1Bridge(x, y);
+						events->create<DeckGuardian>(x, y);
 
-							break;
+						break;
 
-						case 41:
+					default:
 
-							events = new MedGuardian(x, y);
+						events->create<JJ1StandardEvent>(eventSet + grid[y][x].event, x, y, TTOF(x), TTOF(y + 1));
 
-							break;
+						break;
 
-						case 60:
+				}
 
-							events = new DeckGuardian(x, y);
+			}
 
-							break;
+		}
 
-						default:
+	}
 
-							events = new JJ1StandardEvent(eventSet + grid[y][x].event, x, y, TTOF(x), TTOF(y + 1));
 
-							break;
+	// Bullets, birds and players find the events they hit through the grid
+	eventGrid->build(events);
 
-					}
+	phaseTimer.next(PP_BULLETS);
 
-				}
+	// Process bullets, oldest first
+	count = bullets->getCount();
 
-			}
+	for (x = 0; x < count; x++) {
 
-		}
+		JJ1Bullet* bullet = bullets->get(x);
+
+		if (bullet && !bullet->step(ticks)) bullets->destroy(x);
 
 	}
 
+	bullets->compact();
 
-	// Process bullets
-	if (bullets) bullets = bullets->step(ticks);
+	phaseTimer.next(PP_CONTROL);
 
 	// Determine the players' trajectories
 	for (x = 0; x < nPlayers; x++) players[x].getJJ1LevelPlayer()->control(ticks);
 
-	// Process active events
-	if (events) events = events->step(ticks);
+	phaseTimer.next(PP_EVENTS);
+
+	// Events may be removed from here on
+	eventGrid->invalidate();
+
+	// Process active events, oldest first. Events created in the process, e.g.
+	// dropped by other events, are first processed on the next step
+	count = events->getCount();
+
+	for (x = 0; x < count; x++) {
+
+		JJ1Event* event = events->get(x);
+
+		if (event && !event->step(ticks)) events->destroy(x);
+
+	}
+
+	events->compact();
+
+	phaseTimer.next(PP_MOVE);
 
 	// Apply as much of those trajectories as possible, without going into the
 	// scenery
 	for (x = 0; x < nPlayers; x++) players[x].getJJ1LevelPlayer()->move(ticks);
 
+	phaseTimer.stop();
+
 
 	// Check if time has run out
 	if (ticks > endTime) {
@@ -208,20 +237,16 @@ int JJ1Level::step () {
 
 
 /**
- * Draw the level.
+ * Move the viewport. Events are activated and removed relative to the
+ * viewport, so this is needed even when nothing is drawn.
+ *
+ * @param change Time since last step
+ *
+ * @return Height of the viewport
  */
-void JJ1Level::draw () {
+int JJ1Level::updateView (unsigned int change) {
 
-	GridElement *ge;
-	SDL_Rect src, dst;
 	int viewH = canvasH;
-	int vX, vY;
-	int x, y;
-	unsigned int change;
-
-
-	// Calculate change since last step
-	change = getTimeChange();
 
 
 	// Calculate viewport
@@ -243,6 +268,30 @@ void JJ1Level::draw () {
 	if (FTOI(viewY) + viewH >= TTOI(LH)) viewY = ITOF(TTOI(LH) - viewH);
 	if (viewY < 0) viewY = 0;
 
+	return viewH;
+
+}
+
+
+/**
+ * Draw the level.
+ */
+void JJ1Level::draw () {
+
+	ProfileTimer drawTimer(PP_DRAW);
+	ProfileTimer phaseTimer(PP_SKY);
+	SDL_Rect src, dst;
+	int viewH;
+	int vX, vY;
+	int x, y;
+	unsigned int change;
+
+
+	// Calculate change since last step
+	change = getTimeChange();
+
+	viewH = updateView(change);
+
 	// Use the viewport
 	dst.x = 0;
 	dst.y = 0;
@@ -290,100 +339,35 @@ void JJ1Level::draw () {
 	}
 
 
+	phaseTimer.next(PP_BACKGROUND);
 
-	// Show background tiles
-
-	for (y = 0; y <= ITOT(viewH - 1) + 1; y++) {
-
-		for (x = 0; x <= ITOT(canvasW - 1) + 1; x++) {
-
-			if ((x + ITOT(vX) >= 256) || (y + ITOT(vY) >= 64)) {
-
-				video.drawRect(TTOI(x) - (vX & 31), TTOI(y) - (vY & 31), 32, 32, LEVEL_BLACK);
-
-				continue;
-
-			}
-
-			// Get the grid element from the given coordinates
-			ge = grid[y + ITOT(vY)] + x + ITOT(vX);
-
-			// If this tile uses a black background, draw it
-			if (ge->bg)
-				video.drawRect(TTOI(x) - (vX & 31), TTOI(y) - (vY & 31), 32, 32, LEVEL_BLACK);
-
-
-			// If this is not a foreground tile, draw it
-			if ((ge->event != 124) &&
-				(ge->event != 125) &&
-				(eventSet[ge->event].movement != 37) &&
-				(eventSet[ge->event].movement != 38)) {
-
-				dst.x = TTOI(x) - (vX & 31);
-				dst.y = TTOI(y) - (vY & 31);
-				src.y = TTOI(ge->tile);
-				SDL_BlitSurface(tileSet, &src, canvas, &dst);
-
-			}
+	// Show background tiles, rendering only those that have come into view
+	tileCache->update(vX, vY, canvasW, viewH);
+	tileCache->drawBackground(vX, vY, canvasW, viewH);
 
-		}
 
-	}
+	phaseTimer.next(PP_DRAWEVENTS);
 
+	// Show active events, oldest first
+	for (x = 0; x < events->getCount(); x++) events->get(x)->draw(ticks, change);
 
-	// Show active events
-	if (events) events->draw(ticks, change);
 
+	phaseTimer.next(PP_PLAYERS);
 
 	// Show the players
 	for (x = 0; x < nPlayers; x++) players[x].getJJ1LevelPlayer()->draw(ticks, change);
 
 
 	// Show bullets
-	if (bullets) bullets->draw(change);
+	for (x = 0; x < bullets->getCount(); x++) bullets->get(x)->draw(change);
 
 
+	phaseTimer.next(PP_FOREGROUND);
 
 	// Show foreground tiles
+	tileCache->drawForeground(vX, vY, canvasW, viewH, ticks);
 
-	for (y = 0; y <= ITOT(viewH - 1) + 1; y++) {
-
-		for (x = 0; x <= ITOT(canvasW - 1) + 1; x++) {
-
-			if ((x + ITOT(vX) >= 256) || (y + ITOT(vY) >= 64)) continue;
-
-			// Get the grid element from the given coordinates
-			ge = grid[y + ITOT(vY)] + x + ITOT(vX);
-
-			// If this is an "animated" foreground tile, draw it
-			if (ge->event == 123) {
-
-				dst.x = TTOI(x) - (vX & 31);
-				dst.y = TTOI(y) - (vY & 31);
-				if (ticks & 64) src.y = TTOI(eventSet[ge->event].multiB);
-				else src.y = TTOI(eventSet[ge->event].multiA);
-				SDL_BlitSurface(tileSet, &src, canvas, &dst);
-
-				//video.drawRect(dst.x, dst.y, TTOI(1), TTOI(1), 44, false);
-			}
-
-			// If this is a foreground tile, draw it
-			if ((ge->event == 124) ||
-				(ge->event == 125) ||
-				(eventSet[ge->event].movement == 37) ||
-				(eventSet[ge->event].movement == 38)) {
-
-				dst.x = TTOI(x) - (vX & 31);
-				dst.y = TTOI(y) - (vY & 31);
-				src.y = TTOI(ge->tile);
-				SDL_BlitSurface(tileSet, &src, canvas, &dst);
-
-				//video.drawRect(dst.x, dst.y, TTOI(1), TTOI(1), 33, false);
-			}
-
-		}
-
-	}
+	phaseTimer.stop();
 
 	// FIXME: Temporary lines showing the water level
 	video.drawRect(0, FTOI(waterLevel - viewY), canvasW, 2, 24);
@@ -391,8 +375,12 @@ void JJ1Level::draw () {
 	video.drawRect(0, FTOI(waterLevel - viewY) + 6, canvasW, 1, 24);
 	video.drawRect(0, FTOI(waterLevel - viewY) + 10, canvasW, 1, 24);
 
-	// Show active guardian's energy bar
-	if (events) events->drawEnergy(ticks);
+	// Show the newest active guardian's energy bar
+	for (x = events->getCount() - 1; x >= 0; x--) {
+
+		if (events->get(x)->drawEnergy(ticks)) break;
+
+	}
 
 
 	// If this is a competitive game, draw the score
@@ -29,14 +29,20 @@
 
 #include "jj1bullet.h"
 #include "event/jj1event.h"
+#include "event/jj1eventgrid.h"
+#include "event/jj1guardians.h"
 #include "jj1level.h"
 #include "jj1levelplayer.h"
+#include "jj1tilecache.h"
+#include "jj1/planet/jj1planet.h"
 
 #include "game/game.h"
+#include "io/assetcache.h"
 #include "io/file.h"
 #include "io/gfx/font.h"
 #include "io/gfx/sprite.h"
 #include "io/gfx/video.h"
+#include "io/loader.h"
 #include "io/sound.h"
 #include "loop.h"
 #include "util.h"
@@ -50,21 +56,10 @@
 
 /**
  * Load the HUD graphical data.
- *
- * @return Error code
  */
-int JJ1Level::loadPanel () {
-
-	FilePtr file;
-	try {
+JJ1PanelAsset::JJ1PanelAsset () {
 
-		file = std::make_unique<File>("PANEL.000", PATH_TYPE_GAME);
-
-	} catch (int e) {
-
-		return e;
-
-	}
+	FilePtr file = std::make_unique<File>("PANEL.000", PATH_TYPE_GAME);
 
 	unsigned char* pixels = file->loadRLE(46272);
 
@@ -131,23 +126,118 @@ int JJ1Level::loadPanel () {
 		dst.y = 24;
 		SDL_BlitSurface(panel, &src, panelBG[1], &dst);
 	}
+}
+
+
+/**
+ * Delete the HUD graphical data.
+ */
+JJ1PanelAsset::~JJ1PanelAsset () {
+
+	video.destroySurface(panel);
+	for (int i = 0; i < 6; i++)
+		video.destroySurface(panelAmmo[i]);
+	for (int i = 0; i < 2; i++)
+		video.destroySurface(panelBG[i]);
+
+}
+
+
+/**
+ * Get the memory used by the HUD graphical data.
+ *
+ * @return The size, in bytes
+ */
+int JJ1PanelAsset::getSize () {
+
+	int size = panel->pitch * panel->h;
+
+	for (int i = 0; i < 6; i++)
+		size += panelAmmo[i]->pitch * panelAmmo[i]->h;
+	for (int i = 0; i < 2; i++)
+		size += panelBG[i]->pitch * panelBG[i]->h;
+
+	return size;
+
+}
+
+
+/**
+ * Load the HUD graphical data, or reuse it from a previous level.
+ *
+ * @return Error code
+ */
+int JJ1Level::loadPanel () {
+
+	JJ1PanelAsset* asset = static_cast<JJ1PanelAsset*>(assetCache.acquire(JJ1_PANEL_ASSET));
+
+	if (!asset) {
+
+		try {
+
+			asset = static_cast<JJ1PanelAsset*>(assetCache.add(JJ1_PANEL_ASSET, new JJ1PanelAsset()));
+
+		} catch (int e) {
+
+			return e;
+
+		}
+
+	}
+
+	panel = asset->panel;
+	for (int i = 0; i < 6; i++)
+		panelAmmo[i] = asset->panelAmmo[i];
+	for (int i = 0; i < 2; i++)
+		panelBG[i] = asset->panelBG[i];
+
+	return E_NONE;
+}
+
+
+/**
+ * Load the on-screen message font, or reuse it from a previous level.
+ *
+ * @return Error code
+ */
+int JJ1Level::loadFont () {
+
+	FontAsset* asset = static_cast<FontAsset*>(assetCache.acquire(JJ1_FONT_ASSET));
+
+	if (!asset) {
+
+		try {
+
+			asset = static_cast<FontAsset*>(assetCache.add(JJ1_FONT_ASSET, new FontAsset(false)));
+
+		} catch (int e) {
+
+			return e;
+
+		}
+
+	}
+
+	font = asset->font;
 
 	return E_NONE;
+
 }
 
 
 /**
- * Load a sprite.
+ * Load a sprite's image.
  *
  * @param file File from which to load the sprite data
- * @param sprite Sprite that will receive the loaded data
+ * @param image Image that will receive the loaded data (no pixels if blank)
  */
-void JJ1Level::loadSprite (File* file, Sprite* sprite) {
+static void loadSprite (File* file, SpriteImage& image) {
 
-	unsigned char* pixels;
 	int pos, maskOffset;
 	int width, height;
 
+	image.pixels = nullptr;
+
 	// Load dimensions
 	width = file->loadShort() << 2;
 	height = file->loadShort();
@@ -172,10 +262,7 @@ void JJ1Level::loadSprite (File* file, Sprite* sprite) {
 		pos += file->tell() + ((width >> 2) * height);
 
 		// Read scrambled, masked pixel data
-		pixels = file->loadPixels(width * height, SKEY);
-		sprite->setPixels(pixels, width, height, SKEY);
-
-		delete[] pixels;
+		if (width) image.pixels = file->loadPixels(width * height, SKEY);
 
 		file->seek(pos, true);
 
@@ -184,30 +271,42 @@ void JJ1Level::loadSprite (File* file, Sprite* sprite) {
 		// Not masked
 
 		// Read scrambled pixel data
-		pixels = file->loadPixels(width * height);
-		sprite->setPixels(pixels, width, height, SKEY);
-
-		delete[] pixels;
+		image.pixels = file->loadPixels(width * height);
 
 	}
 
+	image.width = width;
+	image.height = height;
+
+}
+
+
+/**
+ * Create an empty set of the player's sprites.
+ */
+JJ1SpriteAsset::JJ1SpriteAsset () {
+
+	// Skip to where the sprites start in mainchar.000
+	position = 2;
+
 }
 
 
 /**
- * Load sprites.
+ * Decode the player's sprites, up to the given number.
  *
- * @param fileName Name of the file containing the level-specific sprites
+ * @param count The number of sprites needed
  *
  * @return Error code
  */
-int JJ1Level::loadSprites (char * fileName) {
+int JJ1SpriteAsset::load (int count) {
 
-	// Open fileName
-	FilePtr specFile;
+	if ((position < 0) || (static_cast<int>(images.size()) >= count)) return E_NONE;
+
+	FilePtr file;
 	try {
 
-		specFile = std::make_unique<File>(fileName, PATH_TYPE_GAME);
+		file = std::make_unique<File>("MAINCHAR.000", PATH_TYPE_GAME);
 
 	} catch (int e) {
 
@@ -215,12 +314,62 @@ int JJ1Level::loadSprites (char * fileName) {
 
 	}
 
+	file->seek(position, true);
 
-	// This function loads all the sprites, not just those in fileName
-	FilePtr mainFile;
+	while (static_cast<int>(images.size()) < count) {
+
+		SpriteImage image = {nullptr, 0, 0};
+
+		if (file->tell() >= file->getSize()) {
+
+			// There are no more sprites
+			position = -1;
+
+			return E_NONE;
+
+		}
+
+		if (file->loadChar() == 0xFF) {
+
+			// Go to the next sprite/file indicator
+			file->seek(1, false);
+
+		} else {
+
+			// Return to the start of the sprite
+			file->seek(-1, false);
+
+			// Load the individual sprite data
+			loadSprite(file.get(), image);
+
+		}
+
+		images.push_back(image);
+
+	}
+
+	position = file->tell();
+
+	return E_NONE;
+
+}
+
+
+/**
+ * Decode the level's sprites, and the player's sprites it needs.
+ *
+ * @param data Receives the level-specific sprite images
+ * @param fileName Name of the file containing the level-specific sprites
+ *
+ * @return Error code
+ */
+int JJ1Level::decodeSprites (JJ1LevelData* data, char* fileName) {
+
+	// Open fileName
+	FilePtr specFile;
 	try {
 
-		mainFile = std::make_unique<File>("MAINCHAR.000", PATH_TYPE_GAME);
+		specFile = std::make_unique<File>(fileName, PATH_TYPE_GAME);
 
 	} catch (int e) {
 
@@ -231,6 +380,13 @@ int JJ1Level::loadSprites (char * fileName) {
 
 	sprites = specFile->loadShort(256);
 
+
+	// This function loads all the sprites, not just those in fileName
+	int res = data->mainSprites->load(sprites);
+
+	if (res < 0) return res;
+
+
 	// Include space in the sprite set for the blank sprite at the end
 	spriteSet = new Sprite[sprites + 1];
 
@@ -244,84 +400,86 @@ int JJ1Level::loadSprites (char * fileName) {
 	delete[] buffer;
 
 
-	// Skip to where the sprites start in mainchar.000
-	mainFile->seek(2, true);
-
-
 	// Loop through all the sprites to be loaded
 	for (int i = 0; i < sprites; i++) {
 
-		bool loaded = false;
+		SpriteImage image = {nullptr, 0, 0};
 
-		if (mainFile->loadChar() == 0xFF) {
+		if (specFile->loadChar() == 0xFF) {
 
 			// Go to the next sprite/file indicator
-			mainFile->seek(1, false);
+			specFile->seek(1, false);
 
 		} else {
 
 			// Return to the start of the sprite
-			mainFile->seek(-1, false);
-
-			// Load the individual sprite data
-			loadSprite(mainFile.get(), spriteSet + i);
+			specFile->seek(-1, false);
 
-			loaded = true;
+			// Load the individual sprite data, which replaces mainchar.000's
+			loadSprite(specFile.get(), image);
 
 		}
 
-		if (specFile->loadChar() == 0xFF) {
+		data->spriteImages.push_back(image);
 
-			// Go to the next sprite/file indicator
-			specFile->seek(1, false);
 
-		} else {
+		// Check if the next sprite exists
+		// If not, the remainder will be blank
+		if (specFile->tell() >= specFile->getSize()) break;
 
-			// Return to the start of the sprite
-			specFile->seek(-1, false);
+	}
 
-			// Load the individual sprite data
-			loadSprite(specFile.get(), spriteSet + i);
+	return E_NONE;
 
-			loaded = true;
+}
 
-		}
 
-		/* If both fileName and mainchar.000 have file indicators, create a
-		blank sprite */
-		if (!loaded) spriteSet[i].clearPixels();
+/**
+ * Give the sprites their decoded images.
+ *
+ * @param data The decoded sprite images
+ */
+void JJ1Level::createSprites (JJ1LevelData* data) {
 
+	std::vector<SpriteImage>& mainImages = data->mainSprites->images;
 
-		// Check if the next sprite exists
-		// If not, create blank sprites for the remainder
-		if (specFile->tell() >= specFile->getSize()) {
+	for (int i = 0; i < sprites; i++) {
 
-			for (i++; i < sprites; i++) {
+		SpriteImage* image = nullptr;
 
-				spriteSet[i].clearPixels();
+		if (i < static_cast<int>(data->spriteImages.size())) {
 
-			}
+			if (data->spriteImages[i].pixels)
+				image = &(data->spriteImages[i]);
+			else if ((i < static_cast<int>(mainImages.size())) && mainImages[i].pixels)
+				image = &(mainImages[i]);
 
 		}
 
+		/* If both fileName and mainchar.000 have file indicators, or fileName
+		has ended, create a blank sprite */
+		if (image) spriteAtlas.add(spriteSet + i, image->pixels, image->width, image->height, SKEY);
+		else spriteSet[i].clearPixels();
+
 	}
 
 	// Include a blank sprite at the end
 	spriteSet[sprites].clearPixels();
 
-	return E_NONE;
+	spriteAtlas.pack();
 
 }
 
 
 /**
- * Load the tileset.
+ * Decode the tileset.
  *
+ * @param data Receives the tile images
  * @param fileName Name of the file containing the tileset
  *
  * @return The number of tiles loaded
  */
-int JJ1Level::loadTiles (char* fileName) {
+int JJ1Level::decodeTiles (JJ1LevelData* data, char* fileName) {
 
 	FilePtr file;
 
@@ -377,55 +535,213 @@ int JJ1Level::loadTiles (char* fileName) {
 	LOG_DEBUG("Loaded %d tiles", tiles);
 
 	// Create combined buffer
-	unsigned char* buffer = new unsigned char[TTOI(1) * TTOI(tiles)];
+	data->tilePixels = new unsigned char[TTOI(1) * TTOI(tiles)];
 	for (int i = 0; i < tiles; i++) {
-		memcpy(buffer + TTOI(1) * TTOI(1) * i,
+		memcpy(data->tilePixels + TTOI(1) * TTOI(1) * i,
 			pixels[i], TTOI(1) * TTOI(1));
 		delete[] pixels[i];
 	}
 
-	tileSet = video.createSurface(buffer, TTOI(1), TTOI(tiles));
-	video.enableColorKey(tileSet, TKEY);
-	delete[] buffer;
-
 	return tiles;
 }
 
 
 /**
- * Load the level.
+ * Decode the level file, tileset and sprites. Runs on the loader thread, so
+ * must not create surfaces or use the asset cache.
  *
- * @param fileName Name of the file containing the level data
- * @param checkpoint Whether or not the player(s) will start at a checkpoint
+ * @param levelData The level data to decode
  *
  * @return Error code
  */
-int JJ1Level::load (char* fileName, bool checkpoint) {
-	unsigned char* buffer;
+int JJ1Level::decode (void* levelData) {
 
-	// Load font
+	JJ1LevelData* data = static_cast<JJ1LevelData*>(levelData);
+	JJ1Level* level = data->level;
+	File* file;
+
+	// Open level file
 	try {
 
-		font = new Font(false);
+		if (!strcmp(data->fileName, LEVEL_FILE))
+			// use downloaded file
+			file = new File(data->fileName, PATH_TYPE_TEMP);
+		else
+			file = new File(data->fileName, PATH_TYPE_GAME);
 
 	} catch (int e) {
 
 		return e;
 
 	}
+
+	data->file = file;
+
+	// Checking level file header
+	char *identifier1 = file->loadString(2);
+	char identifier2 = file->loadChar();
+	if (strncmp(identifier1, "DD", 2) != 0 || identifier2 != 0x1A) {
+		LOG_ERROR("Level not valid!");
+		delete[] identifier1;
+		return E_FILE;
+	}
+	delete[] identifier1;
+
+	// Load the blocks.### extension
+
+	// Skip past all level data
+	file->seek(39, true);
+	file->skipRLE();
+	file->skipRLE();
+	file->skipRLE();
+	file->skipRLE();
+	file->skipRLE();
+	file->skipRLE();
+	file->skipRLE();
+	file->skipRLE();
+	file->seek(598, false);
+	file->skipRLE();
+	file->seek(4, false);
+	file->skipRLE();
+	file->skipRLE();
+	file->seek(25, false);
+	file->skipRLE();
+	file->seek(3, false);
+
+	// Load the level number
+	level->levelNum = file->loadChar() ^ 210;
+
+	// Load the world number
+	level->worldNum = file->loadChar() ^ 4;
+
+	// Load 100% counters
+	level->nEnemies[0] = file->loadShort(); // Easy
+	level->nEnemies[1] = level->nEnemies[0]; // Medium is same as Easy
+	level->nEnemies[2] = file->loadShort(); // Hard
+	level->nEnemies[3] = file->loadShort(); // Turbo
+	level->nItems = file->loadShort();
+
+	data->loader->setProgress(10);
+
+	// Load tile set from appropriate blocks.###
+
+	// Load tile set extension
+	char *ext = file->loadTerminatedString(3);
+	char *string;
+
+	// Create tile set file name
+	if (!strcmp(ext, "999")) string = createFileName("BLOCKS", level->worldNum);
+	else string = createFileName("BLOCKS", ext);
+
+	delete[] ext;
+
+	data->tiles = level->decodeTiles(data, string);
+
+	delete[] string;
+
+	if (data->tiles < 0) return data->tiles;
+
+	data->loader->setProgress(60);
+
+
+	// Load sprite set from corresponding Sprites.###
+
+	string = createFileName("SPRITES", level->worldNum);
+	int res = level->decodeSprites(data, string);
+
+	delete[] string;
+
+	return res;
+
+}
+
+
+/**
+ * Delete decoded level data that has not been used.
+ *
+ * @param data The decoded level data
+ */
+static void deleteLevelData (JJ1LevelData* data) {
+
+	delete data->file;
+	delete[] data->tilePixels;
+
+	for (SpriteImage& image: data->spriteImages) delete[] image.pixels;
+
+	data->spriteImages.clear();
+
+	if (data->mainSprites) assetCache.release(JJ1_MAINCHAR_ASSET);
+
+}
+
+
+/**
+ * Load the level.
+ *
+ * @param fileName Name of the file containing the level data
+ * @param checkpoint Whether or not the player(s) will start at a checkpoint
+ * @param planet Planet approach to show while the level loads (nullptr for none)
+ *
+ * @return Error code
+ */
+int JJ1Level::load (char* fileName, bool checkpoint, JJ1Planet* planet) {
+	unsigned char* buffer;
+
+	tileSet = nullptr;
+	spriteSet = nullptr;
+
+	// Load font
+	int res = loadFont();
+	if (res < 0) return res;
 	#if DEBUG_FONTS
 	font->saveAtlasAsBMP("levelfont.bmp");
 	#endif
 
 	// Load panel
-	int res = loadPanel();
+	res = loadPanel();
 	if (res < 0) {
-		delete font;
+		deleteFont();
 
 		return res;
 	}
 
 
+	// Decode the level's files on the loader thread
+
+	Loader loader;
+	JJ1LevelData data;
+
+	data.level = this;
+	data.fileName = fileName;
+	data.loader = &loader;
+	data.file = nullptr;
+	data.tilePixels = nullptr;
+	data.tiles = 0;
+
+	data.mainSprites = static_cast<JJ1SpriteAsset*>(assetCache.acquire(JJ1_MAINCHAR_ASSET));
+
+	if (!data.mainSprites)
+		data.mainSprites = static_cast<JJ1SpriteAsset*>(assetCache.add(JJ1_MAINCHAR_ASSET, new JJ1SpriteAsset()));
+
+	loader.start(decode, &data);
+
+
+	// Show the planet approach while loading
+	if (planet && (planet->play() == E_QUIT)) {
+
+		loader.wait();
+
+		deleteLevelData(&data);
+		delete[] spriteSet;
+		spriteSet = nullptr;
+		deletePanel();
+		deleteFont();
+
+		return E_QUIT;
+
+	}
+
+
 	// Show loading screen
 
 	// Open planet.### file
@@ -502,111 +818,35 @@ int JJ1Level::load (char* fileName, bool checkpoint) {
 	video.setTitle(levelname);
 	delete[] levelname;
 
-	if (::loop(NORMAL_LOOP) == E_QUIT) return E_QUIT;
-
-
-	// Open level file
-	FilePtr file;
-	try {
+	// Show progress until the loader thread is done
+	res = loader.finish();
 
-		if (!strcmp(fileName, LEVEL_FILE))
-			// use downloaded file
-			file = std::make_unique<File>(fileName, PATH_TYPE_TEMP);
-		else
-			file = std::make_unique<File>(fileName, PATH_TYPE_GAME);
-
-	} catch (int e) {
+	if (res < 0) {
 
+		deleteLevelData(&data);
+		delete[] spriteSet;
+		spriteSet = nullptr;
 		deletePanel();
-		delete font;
+		deleteFont();
 
-		return e;
-
-	}
+		return res;
 
-	// Checking level file header
-	char *identifier1 = file->loadString(2);
-	char identifier2 = file->loadChar();
-	if (strncmp(identifier1, "DD", 2) != 0 || identifier2 != 0x1A) {
-		LOG_ERROR("Level not valid!");
-		delete[] identifier1;
-		return E_FILE;
 	}
-	delete[] identifier1;
-
-	// Load the blocks.### extension
-
-	// Skip past all level data
-	file->seek(39, true);
-	file->skipRLE();
-	file->skipRLE();
-	file->skipRLE();
-	file->skipRLE();
-	file->skipRLE();
-	file->skipRLE();
-	file->skipRLE();
-	file->skipRLE();
-	file->seek(598, false);
-	file->skipRLE();
-	file->seek(4, false);
-	file->skipRLE();
-	file->skipRLE();
-	file->seek(25, false);
-	file->skipRLE();
-	file->seek(3, false);
-
-	// Load the level number
-	levelNum = file->loadChar() ^ 210;
-
-	// Load the world number
-	worldNum = file->loadChar() ^ 4;
-
-	// Load 100% counters
-	nEnemies[0] = file->loadShort(); // Easy
-	nEnemies[1] = nEnemies[0]; // Medium is same as Easy
-	nEnemies[2] = file->loadShort(); // Hard
-	nEnemies[3] = file->loadShort(); // Turbo
-	nItems = file->loadShort();
-
-	// Load tile set from appropriate blocks.###
-
-	// Load tile set extension
-	char *ext = file->loadTerminatedString(3);
 
-	// Create tile set file name
-	if (!strcmp(ext, "999")) string = createFileName("BLOCKS", worldNum);
-	else string = createFileName("BLOCKS", ext);
-
-	delete[] ext;
-
-	int tiles = loadTiles(string);
-
-	delete[] string;
-
-	if (tiles < 0) {
-
-		deletePanel();
-		delete font;
-
-		return tiles;
 
-	}
+	// Create the tileset and sprite images
 
+	int tiles = data.tiles;
 
-	// Load sprite set from corresponding Sprites.###
+	tileSet = video.createSurface(data.tilePixels, TTOI(1), TTOI(tiles));
+	video.enableColorKey(tileSet, TKEY);
 
-	string = createFileName("SPRITES", worldNum);
-	res = loadSprites(string);
+	createSprites(&data);
 
-	delete[] string;
+	FilePtr file(data.file);
+	data.file = nullptr;
 
-	if (res < 0) {
-		video.destroySurface(tileSet);
-		deletePanel();
-		delete font;
-
-		return res;
-	}
+	deleteLevelData(&data);
 
 
 	// Skip to tile and event reference data
@@ -625,6 +865,7 @@ int JJ1Level::load (char* fileName, bool checkpoint) {
 			grid[y][x].bg = buffer[((y + (x * LH)) << 1) + 1] >> 7;
 			grid[y][x].event = buffer[((y + (x * LH)) << 1) + 1] & 127;
 			grid[y][x].hits = 0;
+			grid[y][x].active = 0;
 			grid[y][x].time = 0;
 
 		}
@@ -1079,8 +1320,18 @@ int JJ1Level::load (char* fileName, bool checkpoint) {
 	endTime = (5 - +getDifficulty()) * 2 * 60 * 1000;
 
 
-	events = nullptr;
-	bullets = nullptr;
+	// Active events and bullets live in fixed slots, so that creating them
+	// during play does not allocate memory. Each slot fits any type of event.
+	size_t eventSize = sizeof(JJ1StandardEvent);
+	if (sizeof(JJ1Bridge) > eventSize) eventSize = sizeof(JJ1Bridge);
+	if (sizeof(MedGuardian) > eventSize) eventSize = sizeof(MedGuardian);
+	if (sizeof(DeckGuardian) > eventSize) eventSize = sizeof(DeckGuardian);
+
+	events = new JJ1EventPool(AEVENTS, eventSize);
+	eventGrid = new JJ1EventGrid();
+	bullets = new JJ1BulletPool(ABULLETS, sizeof(JJ1Bullet));
+
+	tileCache = new JJ1TileCache(grid, eventSet, tileSet);
 
 	energyBar = 0;
 	ammoType = 0;
@@ -31,6 +31,7 @@
 
 #include "jj1bullet.h"
 #include "event/jj1event.h"
+#include "event/jj1eventgrid.h"
 #include "jj1level.h"
 #include "jj1bird.h"
 #include "jj1levelplayer.h"
@@ -426,13 +427,14 @@ void JJ1LevelPlayer::control (unsigned int ticks) {
 
 			if (player->ammoType == 4) {
 
-				JJ1Event* event;
-
 				// TNT
 
-				event = level->getEvents();
+				JJ1EventGrid* eventGrid = level->getEventGrid();
+				int candidates = eventGrid->find(x - F160, y - F100, 2 * F160, 2 * F100);
+
+				for (int i = 0; i < candidates; i++) {
 
-				while (event) {
+					JJ1Event* event = eventGrid->getCandidate(i);
 
 					// If the event is within range, hit it
 					if (event->overlap(x - F160, y - F100, 2 * F160, 2 * F100)) {
@@ -441,8 +443,6 @@ void JJ1LevelPlayer::control (unsigned int ticks) {
 
 					}
 
-					event = event->getNext();
-
 				}
 
 				// Red flash
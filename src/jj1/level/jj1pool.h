@@ -0,0 +1,185 @@
+/**
+ *
+ * @file jj1pool.h
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ * @par Description:
+ * Fixed-capacity storage for active events and bullets.
+ *
+ */
+
+#ifndef OJ_JJ1POOL_H
+#define OJ_JJ1POOL_H
+
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+
+// Class
+
+/// Fixed number of slots for objects of a class hierarchy, kept in order of creation
+template <class T> class JJ1Pool {
+
+	private:
+		unsigned char* storage; ///< Memory for all slots
+		size_t         slotSize; ///< Size of each slot, in bytes
+		int            capacity; ///< Number of slots
+		int*           freeSlots; ///< Indices of unused slots
+		int            nFreeSlots; ///< Number of unused slots
+		T**            objects; ///< Live objects, oldest first. May contain gaps until compacted
+		int*           objectSlots; ///< Slot occupied by each live object
+		int            nObjects; ///< Number of entries in objects, including gaps
+
+	public:
+		/**
+		 * Allocate all slots up-front.
+		 *
+		 * @param slots The number of slots
+		 * @param size The size of the largest object to be stored
+		 */
+		JJ1Pool (int slots, size_t size) {
+
+			// Keep every slot suitably aligned
+			slotSize = (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+			capacity = slots;
+
+			storage = new unsigned char[slotSize * capacity];
+			freeSlots = new int[capacity];
+			objects = new T*[capacity];
+			objectSlots = new int[capacity];
+
+			// Hand out low slots first
+			for (int i = 0; i < capacity; i++) freeSlots[i] = capacity - 1 - i;
+
+			nFreeSlots = capacity;
+			nObjects = 0;
+
+		}
+
+
+		/**
+		 * Delete all remaining objects and free the slots.
+		 */
+		~JJ1Pool () {
+
+			for (int i = 0; i < nObjects; i++) {
+
+				if (objects[i]) objects[i]->~T();
+
+			}
+
+			delete[] objectSlots;
+			delete[] objects;
+			delete[] freeSlots;
+			delete[] storage;
+
+		}
+
+
+		/**
+		 * Construct a new object in an unused slot, after all existing objects.
+		 *
+		 * @param args Arguments for the object's constructor
+		 *
+		 * @return The new object (NULL if there are no unused slots)
+		 */
+		template <class U, class... Args> U* create (Args&&... args) {
+
+			U* object;
+			int slot;
+
+			if ((sizeof(U) > slotSize) || !nFreeSlots || (nObjects == capacity))
+				return NULL;
+
+			slot = freeSlots[--nFreeSlots];
+
+			object = new(storage + (slot * slotSize)) U(std::forward<Args>(args)...);
+
+			objects[nObjects] = object;
+			objectSlots[nObjects] = slot;
+			nObjects++;
+
+			return object;
+
+		}
+
+
+		/**
+		 * Delete an object, leaving a gap until the pool is compacted.
+		 *
+		 * @param index The object's index
+		 */
+		void destroy (int index) {
+
+			if (!objects[index]) return;
+
+			objects[index]->~T();
+			objects[index] = NULL;
+			freeSlots[nFreeSlots++] = objectSlots[index];
+
+		}
+
+
+		/**
+		 * Close the gaps left by deleted objects, preserving the order of the
+		 * remaining objects.
+		 */
+		void compact () {
+
+			int count = 0;
+
+			for (int i = 0; i < nObjects; i++) {
+
+				if (objects[i]) {
+
+					objects[count] = objects[i];
+					objectSlots[count] = objectSlots[i];
+					count++;
+
+				}
+
+			}
+
+			nObjects = count;
+
+		}
+
+
+		/**
+		 * Get the number of objects, including gaps.
+		 *
+		 * @return The number of objects
+		 */
+		int getCount () {
+
+			return nObjects;
+
+		}
+
+
+		/**
+		 * Get an object.
+		 *
+		 * @param index The object's index. Older objects have lower indices
+		 *
+		 * @return The object (NULL if it has been deleted since the pool was last compacted)
+		 */
+		T* get (int index) {
+
+			return objects[index];
+
+		}
+
+};
+
+#endif
+
@@ -0,0 +1,352 @@
+/**
+ *
+ * @file jj1tilecache.cpp
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ * @par Description:
+ * Keeps the tiles around the view pre-rendered, so that drawing a level's tile
+ * layers takes a few large blits instead of one blit per tile.
+ *
+ */
+
+
+#include "jj1tilecache.h"
+
+#include "io/gfx/video.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+
+/**
+ * Fill an area of a surface with a colour.
+ *
+ * @param surface The surface
+ * @param rect The area
+ * @param index Palette index of the colour
+ */
+static void fillRect (SDL_Surface* surface, SDL_Rect rect, int index) {
+
+#if OJ_SDL3
+	SDL_FillSurfaceRect(surface, &rect, index);
+#else
+	SDL_FillRect(surface, &rect, index);
+#endif
+
+}
+
+
+/**
+ * Copy an area of one surface to another.
+ *
+ * @param src The source surface
+ * @param x X-coordinate of the area in the source surface
+ * @param y Y-coordinate of the area in the source surface
+ * @param w Width of the area
+ * @param h Height of the area
+ * @param dst The destination surface
+ * @param dstX X-coordinate of the area in the destination surface
+ * @param dstY Y-coordinate of the area in the destination surface
+ */
+static void blit (SDL_Surface* src, int x, int y, int w, int h, SDL_Surface* dst, int dstX, int dstY) {
+
+	SDL_Rect srcRect;
+
+	srcRect.x = x;
+	srcRect.y = y;
+	srcRect.w = w;
+	srcRect.h = h;
+
+	video.blitSurface(src, &srcRect, dst, dstX, dstY);
+
+}
+
+
+/**
+ * Create an empty tile cache.
+ *
+ * @param levelGrid The level grid
+ * @param levelEventSet The level's event types
+ * @param levelTileSet The level's tile images
+ */
+JJ1TileCache::JJ1TileCache (GridElement (*levelGrid)[LW], JJ1EventType* levelEventSet, SDL_Surface* levelTileSet) {
+
+	grid = levelGrid;
+	eventSet = levelEventSet;
+	tileSet = levelTileSet;
+	background = foreground = nullptr;
+	width = height = 0;
+	gridX = gridY = 0;
+	valid = false;
+
+	// Animated foreground tiles change every few frames, so are drawn over the
+	// foreground layer instead
+	for (int y = 0; y < LH; y++) {
+
+		for (int x = 0; x < LW; x++) {
+
+			if (grid[y][x].event == 123) animated.push_back((y * LW) + x);
+
+		}
+
+	}
+
+}
+
+
+/**
+ * Delete the tile cache.
+ */
+JJ1TileCache::~JJ1TileCache () {
+
+	video.destroySurface(background);
+	video.destroySurface(foreground);
+
+}
+
+
+/**
+ * Determine whether or not a grid element's tile is drawn in front of the
+ * level's contents.
+ *
+ * @param ge The grid element
+ *
+ * @return Whether or not the tile is in the foreground
+ */
+bool JJ1TileCache::isForeground (GridElement* ge) {
+
+	return (ge->event == 124) ||
+		(ge->event == 125) ||
+		(eventSet[ge->event].movement == 37) ||
+		(eventSet[ge->event].movement == 38);
+
+}
+
+
+/**
+ * Render a tile into both layers.
+ *
+ * @param x X-coordinate of the tile
+ * @param y Y-coordinate of the tile
+ */
+void JJ1TileCache::renderTile (int x, int y) {
+
+	GridElement* ge;
+	SDL_Rect dst;
+
+	dst.x = TTOI(x % width);
+	dst.y = TTOI(y % height);
+	dst.w = TTOI(1);
+	dst.h = TTOI(1);
+
+	fillRect(foreground, dst, TKEY);
+
+	// Beyond the level, there is only black
+	if ((x >= LW) || (y >= LH)) {
+
+		fillRect(background, dst, LEVEL_BLACK);
+
+		return;
+
+	}
+
+	ge = grid[y] + x;
+
+	fillRect(background, dst, ge->bg? LEVEL_BLACK: TKEY);
+
+	if (!isForeground(ge))
+		blit(tileSet, 0, TTOI(ge->tile), TTOI(1), TTOI(1), background, dst.x, dst.y);
+	else if (ge->event != 123)
+		blit(tileSet, 0, TTOI(ge->tile), TTOI(1), TTOI(1), foreground, dst.x, dst.y);
+
+}
+
+
+/**
+ * Render an area of tiles into both layers.
+ *
+ * @param x X-coordinate of the first tile
+ * @param y Y-coordinate of the first tile
+ * @param w Width of the area, in tiles
+ * @param h Height of the area, in tiles
+ */
+void JJ1TileCache::renderTiles (int x, int y, int w, int h) {
+
+	for (int tileY = y; tileY < y + h; tileY++) {
+
+		for (int tileX = x; tileX < x + w; tileX++) renderTile(tileX, tileY);
+
+	}
+
+}
+
+
+/**
+ * Bring the layers up to date with the view, rendering any newly exposed
+ * columns and rows of tiles.
+ *
+ * @param viewX X-coordinate of the view
+ * @param viewY Y-coordinate of the view
+ * @param viewW Width of the view
+ * @param viewH Height of the view
+ */
+void JJ1TileCache::update (int viewX, int viewY, int viewW, int viewH) {
+
+	int w, h, x, y;
+
+	// Cover the view, whatever its alignment to the tiles
+	w = ITOT(viewW - 1) + 2;
+	h = ITOT(viewH - 1) + 2;
+
+	if (!background || (w != width) || (h != height)) {
+
+		video.destroySurface(background);
+		video.destroySurface(foreground);
+
+		background = video.createSurface(nullptr, TTOI(w), TTOI(h));
+		video.enableColorKey(background, TKEY);
+		foreground = video.createSurface(nullptr, TTOI(w), TTOI(h));
+		video.enableColorKey(foreground, TKEY);
+
+		width = w;
+		height = h;
+		valid = false;
+
+	}
+
+	x = ITOT(viewX);
+	y = ITOT(viewY);
+
+	if (!valid || (abs(x - gridX) >= width) || (abs(y - gridY) >= height)) {
+
+		renderTiles(x, y, width, height);
+
+	} else {
+
+		// Newly exposed columns
+		if (x > gridX) renderTiles(gridX + width, y, x - gridX, height);
+		else if (x < gridX) renderTiles(x, y, gridX - x, height);
+
+		// Newly exposed rows
+		if (y > gridY) renderTiles(x, gridY + height, width, y - gridY);
+		else if (y < gridY) renderTiles(x, y, width, gridY - y);
+
+	}
+
+	gridX = x;
+	gridY = y;
+	valid = true;
+
+}
+
+
+/**
+ * Re-render a tile after its grid element has changed.
+ *
+ * @param x X-coordinate of the tile
+ * @param y Y-coordinate of the tile
+ */
+void JJ1TileCache::invalidate (unsigned char x, unsigned char y) {
+
+	int position = (y * LW) + x;
+	std::vector<int>::iterator it = std::find(animated.begin(), animated.end(), position);
+
+	if ((grid[y][x].event == 123) && (it == animated.end())) animated.push_back(position);
+	else if ((grid[y][x].event != 123) && (it != animated.end())) animated.erase(it);
+
+	if (valid && (x >= gridX) && (x < gridX + width) && (y >= gridY) && (y < gridY + height))
+		renderTile(x, y);
+
+}
+
+
+/**
+ * Draw the visible part of a layer, which may wrap around its edges.
+ *
+ * @param layer The layer
+ * @param viewX X-coordinate of the view
+ * @param viewY Y-coordinate of the view
+ * @param viewW Width of the view
+ * @param viewH Height of the view
+ */
+void JJ1TileCache::drawLayer (SDL_Surface* layer, int viewX, int viewY, int viewW, int viewH) {
+
+	int x, y, w, h;
+
+	x = viewX % TTOI(width);
+	y = viewY % TTOI(height);
+	w = std::min(TTOI(width) - x, viewW);
+	h = std::min(TTOI(height) - y, viewH);
+
+	blit(layer, x, y, w, h, canvas, 0, 0);
+
+	if (w < viewW) blit(layer, 0, y, viewW - w, h, canvas, w, 0);
+
+	if (h < viewH) blit(layer, x, 0, w, viewH - h, canvas, 0, h);
+
+	if ((w < viewW) && (h < viewH))
+		blit(layer, 0, 0, viewW - w, viewH - h, canvas, w, h);
+
+}
+
+
+/**
+ * Draw the background tiles.
+ *
+ * @param viewX X-coordinate of the view
+ * @param viewY Y-coordinate of the view
+ * @param viewW Width of the view
+ * @param viewH Height of the view
+ */
+void JJ1TileCache::drawBackground (int viewX, int viewY, int viewW, int viewH) {
+
+	drawLayer(background, viewX, viewY, viewW, viewH);
+
+}
+
+
+/**
+ * Draw the foreground tiles, including animated ones.
+ *
+ * @param viewX X-coordinate of the view
+ * @param viewY Y-coordinate of the view
+ * @param viewW Width of the view
+ * @param viewH Height of the view
+ * @param ticks Time
+ */
+void JJ1TileCache::drawForeground (int viewX, int viewY, int viewW, int viewH, unsigned int ticks) {
+
+	GridElement* ge;
+	int x, y;
+
+	drawLayer(foreground, viewX, viewY, viewW, viewH);
+
+	for (int position: animated) {
+
+		x = position % LW;
+		y = position / LW;
+
+		if ((x < gridX) || (x >= gridX + width) || (y < gridY) || (y >= gridY + height))
+			continue;
+
+		ge = grid[y] + x;
+
+		blit(tileSet, 0,
+			TTOI((ticks & 64)? eventSet[ge->event].multiB: eventSet[ge->event].multiA),
+			TTOI(1), TTOI(1), canvas, TTOI(x) - viewX, TTOI(y) - viewY);
+
+		// Foreground tiles are still drawn over the animation
+		if (isForeground(ge))
+			blit(tileSet, 0, TTOI(ge->tile), TTOI(1), TTOI(1), canvas, TTOI(x) - viewX, TTOI(y) - viewY);
+
+	}
+
+}
+
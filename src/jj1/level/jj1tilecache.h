@@ -0,0 +1,61 @@
+/**
+ *
+ * @file jj1tilecache.h
+ *
+ * Part of the OpenJazz project
+ *
+ * @par Licence:
+ * Copyright (c) 2015-2026 Carsten Teibes
+ *
+ * OpenJazz is distributed under the terms of
+ * the GNU General Public License, version 2.0
+ *
+ */
+
+#ifndef OJ_JJ1TILECACHE_H
+#define OJ_JJ1TILECACHE_H
+
+
+#include "jj1level.h"
+
+#include <vector>
+
+
+// Class
+
+/// Pre-rendered background and foreground tile layers of a JJ1 level.
+/// Both layers wrap around as the view scrolls, so only newly exposed columns
+/// and rows, and changed tiles, need to be rendered.
+class JJ1TileCache {
+
+	private:
+		GridElement      (*grid)[LW]; ///< Level grid
+		JJ1EventType*    eventSet; ///< Event types
+		SDL_Surface*     tileSet; ///< Tile images
+		SDL_Surface*     background; ///< Background tiles, on the colour key
+		SDL_Surface*     foreground; ///< Foreground tiles, on the colour key
+		std::vector<int> animated; ///< Grid positions of animated foreground tiles
+		int              width; ///< Width of the layers, in tiles
+		int              height; ///< Height of the layers, in tiles
+		int              gridX; ///< X-coordinate of the first cached tile
+		int              gridY; ///< Y-coordinate of the first cached tile
+		bool             valid; ///< Whether or not the layers hold any tiles
+
+		bool isForeground (GridElement* ge);
+		void renderTile   (int x, int y);
+		void renderTiles  (int x, int y, int w, int h);
+		void drawLayer    (SDL_Surface* layer, int viewX, int viewY, int viewW, int viewH);
+
+	public:
+		JJ1TileCache  (GridElement (*levelGrid)[LW], JJ1EventType* levelEventSet, SDL_Surface* levelTileSet);
+		~JJ1TileCache ();
+
+		void update         (int viewX, int viewY, int viewW, int viewH);
+		void invalidate     (unsigned char x, unsigned char y);
+		void drawBackground (int viewX, int viewY, int viewW, int viewH);
+		void drawForeground (int viewX, int viewY, int viewW, int viewH, unsigned int ticks);
+
+};
+
+#endif
+
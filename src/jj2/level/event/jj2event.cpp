@@ -234,6 +234,56 @@ unsigned char JJ2Event::getType () {
 }
 
 
+/**
+ * Mark the animation sets the pickup draws from
+ *
+ * @param sets Array of flags, indexed by animation set
+ */
+void PickupJJ2Event::markAnimSets (bool* sets) {
+
+	sets[animSet] = true;
+
+}
+
+
+/**
+ * Mark the animation sets the ammo pickup draws from
+ *
+ * @param sets Array of flags, indexed by animation set
+ */
+void AmmoJJ2Event::markAnimSets (bool* sets) {
+
+	// Ammo animations are in set 0, the destruction animation is not
+	sets[0] = true;
+	PickupJJ2Event::markAnimSets(sets);
+
+}
+
+
+/**
+ * Mark the animation sets the spring draws from
+ *
+ * @param sets Array of flags, indexed by animation set
+ */
+void SpringJJ2Event::markAnimSets (bool* sets) {
+
+	sets[animSet] = true;
+
+}
+
+
+/**
+ * Mark the animation sets the placeholder event draws from
+ *
+ * @param sets Array of flags, indexed by animation set
+ */
+void OtherJJ2Event::markAnimSets (bool* sets) {
+
+	sets[animSet] = true;
+
+}
+
+
 /**
  * Delete this event
  *
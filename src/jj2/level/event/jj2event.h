@@ -57,6 +57,7 @@ class JJ2Event : public Movable {
 
 		virtual JJ2Event* step    (unsigned int ticks, int msps) = 0;
 		virtual void      draw    (unsigned int ticks, int change) = 0;
+		virtual void      markAnimSets (bool* sets) = 0;
 
 };
 
@@ -74,6 +75,9 @@ class PickupJJ2Event : public JJ2Event {
 
 		JJ2Event* step (unsigned int ticks, int msps);
 
+	public:
+		void      markAnimSets (bool* sets);
+
 };
 
 /// JJ2 level ammo
@@ -84,6 +88,7 @@ class AmmoJJ2Event : public PickupJJ2Event {
 		~AmmoJJ2Event ();
 
 		void      draw (unsigned int ticks, int change);
+		void      markAnimSets (bool* sets);
 
 };
 
@@ -124,6 +129,7 @@ class SpringJJ2Event : public JJ2Event {
 
 		JJ2Event* step (unsigned int ticks, int msps);
 		void      draw (unsigned int ticks, int change);
+		void      markAnimSets (bool* sets);
 
 };
 
@@ -140,6 +146,7 @@ class OtherJJ2Event : public JJ2Event {
 
 		JJ2Event* step (unsigned int ticks, int msps);
 		void      draw (unsigned int ticks, int change);
+		void      markAnimSets (bool* sets);
 
 };
 
@@ -29,22 +29,47 @@
 #include "io/gfx/video.h"
 
 
+/**
+ * Allocate blank tiles.
+ *
+ * @param newWidth The width of the layer (in tiles)
+ * @param newHeight The height of the layer (in tiles)
+ */
+void JJ2Layer::create (int newWidth, int newHeight) {
+
+	int row;
+
+	width = newWidth;
+	height = newHeight;
+
+	grid = new JJ2Tile[width * height]();
+	rowStart = new int[height];
+	rowEnd = new int[height];
+
+	for (row = 0; row < height; row++) {
+
+		rowStart[row] = width;
+		rowEnd[row] = 0;
+
+	}
+
+	empty = true;
+
+}
+
+
 /**
  * Create a blank 1-by-1 layer.
  */
 JJ2Layer::JJ2Layer () {
 
-	width = height = 1;
+	create(1, 1);
+
 	tileX = tileY = 0;
 	limit = true;
 	warp = false;
 	xSpeed = ySpeed = 0;
 
-	grid = new JJ2Tile *[1];
-	*grid = new JJ2Tile[1];
-
-	(*grid)->tile = 0;
-
 }
 
 
@@ -59,15 +84,7 @@ JJ2Layer::JJ2Layer () {
  */
 JJ2Layer::JJ2Layer (int flags, int newWidth, int newHeight, fixed newXSpeed, fixed newYSpeed) {
 
-	int row;
-
-	width = newWidth;
-	height = newHeight;
-
-	grid = new JJ2Tile *[height];
-	*grid = new JJ2Tile[width * height];
-
-	for (row = 0; row < height; row++) grid[row] = *grid + (row * width);
+	create(newWidth, newHeight);
 
 	tileX = flags & 1;
 	tileY = flags & 2;
@@ -85,7 +102,8 @@ JJ2Layer::JJ2Layer (int flags, int newWidth, int newHeight, fixed newXSpeed, fix
  */
 JJ2Layer::~JJ2Layer () {
 
-	delete[] *grid;
+	delete[] rowEnd;
+	delete[] rowStart;
 	delete[] grid;
 
 }
@@ -103,7 +121,7 @@ bool JJ2Layer::getFlipped (int x, int y) {
 
 	if ((x < 0) || (y < 0) || (x >= width) || (y >= height)) return false;
 
-	return grid[y][x].flipped;
+	return grid[(y * width) + x].flipped;
 
 }
 
@@ -135,7 +153,7 @@ int JJ2Layer::getTile (int x, int y) {
 	if ((x >= width) && !tileX) return 0;
 	if ((y >= height) && !tileY) return 0;
 
-	return grid[y % height][x % width].tile;
+	return grid[((y % height) * width) + (x % width)].tile;
 
 }
 
@@ -161,7 +179,7 @@ int JJ2Layer::getWidth () {
  */
 void JJ2Layer::setFrame (int x, int y, unsigned char frame) {
 
-	grid[y][x].frame = frame;
+	grid[(y * width) + x].frame = frame;
 
 }
 
@@ -179,7 +197,7 @@ void JJ2Layer::setTile (int x, int y, unsigned short int tile, bool TSF, int til
 
 	JJ2Tile* ge;
 
-	ge = grid[y] + x;
+	ge = grid + (y * width) + x;
 
 	if (TSF) {
 
@@ -197,6 +215,16 @@ void JJ2Layer::setTile (int x, int y, unsigned short int tile, bool TSF, int til
 
 	ge->frame = 0;
 
+	// Track which parts of the layer need drawing
+	if (ge->tile) {
+
+		if (x < rowStart[y]) rowStart[y] = x;
+		if (x >= rowEnd[y]) rowEnd[y] = x + 1;
+
+		empty = false;
+
+	}
+
 }
 
 
@@ -209,8 +237,14 @@ void JJ2Layer::setTile (int x, int y, unsigned short int tile, bool TSF, int til
 void JJ2Layer::draw (SDL_Surface* tileSet, SDL_Surface* flippedTileSet) {
 
 	SDL_Rect src, dst;
-	int vX, vY;
-	int x, y;
+	JJ2Tile* row;
+	JJ2Tile* ge;
+	int vX, vY, tX, tY;
+	int columns, rows;
+	int x, y, gX, gY;
+	int start, end;
+
+	if (empty) return;
 
 	// Set tile drawing dimensions
 	src.w = TTOI(1);
@@ -239,14 +273,62 @@ void JJ2Layer::draw (SDL_Surface* tileSet, SDL_Surface* flippedTileSet) {
 
 	}
 
-	for (y = 0; y <= ITOT(canvasH - 1) + 1; y++) {
+	tX = ITOT(vX);
+	tY = ITOT(vY);
+	columns = ITOT(canvasW - 1) + 2;
+	rows = ITOT(canvasH - 1) + 2;
+
+	// Skip layers that do not repeat and are out of view
+	if (!tileX && ((tX + columns <= 0) || (tX >= width))) return;
+	if (!tileY && ((tY + rows <= 0) || (tY >= height))) return;
+
+	for (y = 0; y < rows; y++) {
+
+		gY = y + tY;
+
+		if (gY < 0) continue;
+
+		if (gY >= height) {
+
+			if (!tileY) break;
+
+			gY %= height;
+
+		}
+
+		// Skip empty rows
+		if (rowStart[gY] >= rowEnd[gY]) continue;
+
+		// Only visit the occupied span of rows that do not repeat
+		start = (tX < 0)? -tX: 0;
+		end = columns;
+
+		if (!tileX) {
+
+			if (rowStart[gY] - tX > start) start = rowStart[gY] - tX;
+			if (rowEnd[gY] - tX < end) end = rowEnd[gY] - tX;
+
+		}
+
+		row = grid + (gY * width);
+		gX = (start + tX) % width;
+
+		for (x = start; x < end; x++) {
+
+			ge = row + gX;
+
+			if (ge->tile) {
+
+				src.y = TTOI(ge->tile);
+				dst.x = TTOI(x) - (vX & 31);
+				dst.y = TTOI(y) - (vY & 31);
+
+				// Repeated tiles keep their flip, like the rest of the layer
+				SDL_BlitSurface(ge->flipped? flippedTileSet: tileSet, &src, canvas, &dst);
 
-		for (x = 0; x <= ITOT(canvasW - 1) + 1; x++) {
+			}
 
-			dst.x = TTOI(x) - (vX & 31);
-			dst.y = TTOI(y) - (vY & 31);
-			src.y = TTOI(getTile(x + ITOT(vX), y + ITOT(vY)));
-			if (src.y) SDL_BlitSurface(getFlipped(x + ITOT(vX), y + ITOT(vY))? flippedTileSet: tileSet, &src, canvas, &dst);
+			if (++gX == width) gX = 0;
 
 		}
 
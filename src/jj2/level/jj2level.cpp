@@ -80,7 +80,6 @@ JJ2Level::~JJ2Level () {
 
 	for (count = 0; count < LAYERS; count++) delete layers[count];
 
-	delete[] flippedMask;
 	delete[] mask;
 
 	delete[] musicFile;
@@ -88,12 +87,15 @@ JJ2Level::~JJ2Level () {
 
 	for (count = 0; count < nAnimSets; count++) {
 
-		if (animSets[count]) delete[] animSets[count];
+		delete[] animSets[count].anims;
+		delete[] animSets[count].flippedAnims;
+		delete[] animSets[count].sprites;
+		delete[] animSets[count].flippedSprites;
 
 	}
 
 	delete[] animSets;
-	delete[] spriteSet;
+	delete animFile;
 
 	SDL_FreeSurface(flippedTileSet);
 	SDL_FreeSurface(tileSet);
@@ -107,6 +109,32 @@ JJ2Level::~JJ2Level () {
 }
 
 
+/**
+ * Get a row of the mask of a tile in layer 4.
+ *
+ * @param tX X-coordinate of the tile
+ * @param tY Y-coordinate of the tile
+ * @param row Row of the mask
+ *
+ * @return The row, as bits with the leftmost pixel in the lowest bit
+ */
+unsigned int JJ2Level::getMaskRow (int tX, int tY, int row) {
+
+	unsigned int bits = mask[(layer->getTile(tX, tY) << 5) + row];
+
+	if (!layer->getFlipped(tX, tY)) return bits;
+
+	// Reverse the bits to flip the row
+	bits = ((bits >> 1) & 0x55555555) | ((bits & 0x55555555) << 1);
+	bits = ((bits >> 2) & 0x33333333) | ((bits & 0x33333333) << 2);
+	bits = ((bits >> 4) & 0x0F0F0F0F) | ((bits & 0x0F0F0F0F) << 4);
+	bits = ((bits >> 8) & 0x00FF00FF) | ((bits & 0x00FF00FF) << 8);
+
+	return (bits >> 16) | (bits << 16);
+
+}
+
+
 /**
  * Determine whether or not the given point is solid when travelling upwards.
  *
@@ -132,7 +160,7 @@ bool JJ2Level::checkMaskUp (fixed x, fixed y) {
 	if ((mods[tY][tX].type == 1) || (mods[tY][tX].type == 3) || (mods[tY][tX].type == 4)) return false;
 
 	// Check the mask in the tile in question
-	return (layer->getFlipped(tX, tY)? flippedMask: mask)[(layer->getTile(tX, tY) << 10) + ((y >> 5) & 992) + ((x >> 10) & 31)];
+	return (getMaskRow(tX, tY, (y >> 10) & 31) >> ((x >> 10) & 31)) & 1;
 
 }
 
@@ -162,7 +190,61 @@ bool JJ2Level::checkMaskDown (fixed x, fixed y, bool drop) {
 	if (drop && ((mods[tY][tX].type == 3) || (mods[tY][tX].type == 4))) return false;
 
 	// Check the mask in the tile in question
-	return (layer->getFlipped(tX, tY)? flippedMask: mask)[(layer->getTile(tX, tY) << 10) + ((y >> 5) & 992) + ((x >> 10) & 31)];
+	return (getMaskRow(tX, tY, (y >> 10) & 31) >> ((x >> 10) & 31)) & 1;
+
+}
+
+
+/**
+ * Find how far down a set of columns is clear, checking all the columns of
+ * each row at once. Equivalent to calling checkMaskDown() for each column,
+ * one row at a time.
+ *
+ * @param x X-coordinate of the leftmost column
+ * @param columns The columns to check, as bits with column x in the lowest bit
+ * @param y Y-coordinate of the first row to check
+ * @param rows Number of rows to check
+ * @param drop Whether or not the player is dropping
+ *
+ * @return Number of clear rows before the first solid one (rows if all clear)
+ */
+int JJ2Level::findMaskDown (fixed x, unsigned int columns, fixed y, int rows, bool drop) {
+
+	// Anything off the edge of the map is solid
+	if ((x < 0) || (y < 0)) return 0;
+
+	int pX = x >> 10;
+	int pY = y >> 10;
+	int tX = pX >> 5;
+
+	// The columns can cover two tiles
+	int shift = pX & 31;
+	unsigned int leftColumns = columns << shift;
+	unsigned int rightColumns = shift? columns >> (32 - shift): 0;
+
+	for (int row = 0; row < rows; row++, pY++) {
+
+		int tY = pY >> 5;
+
+		if ((tX >= layer->getWidth()) || (tY >= layer->getHeight())) return row;
+
+		// Event 3 is vine
+		// Event 4 is hook
+		if (!(drop && ((mods[tY][tX].type == 3) || (mods[tY][tX].type == 4))) &&
+			(getMaskRow(tX, tY, pY & 31) & leftColumns)) return row;
+
+		if (rightColumns) {
+
+			if (tX + 1 >= layer->getWidth()) return row;
+
+			if (!(drop && ((mods[tY][tX + 1].type == 3) || (mods[tY][tX + 1].type == 4))) &&
+				(getMaskRow(tX + 1, tY, pY & 31) & rightColumns)) return row;
+
+		}
+
+	}
+
+	return rows;
 
 }
 
@@ -238,20 +320,6 @@ JJ2Modifier* JJ2Level::getModifier (int gridX, int gridY) {
 }
 
 
-/**
- * Get a sprite.
- *
- * @param sprite Sprite number
- *
- * @return Sprite
- */
-Sprite* JJ2Level::getSprite (unsigned char sprite) {
-
-	return spriteSet + sprite;
-
-}
-
-
 /**
  * Get an animation.
  *
@@ -263,7 +331,9 @@ Sprite* JJ2Level::getSprite (unsigned char sprite) {
  */
 Anim* JJ2Level::getAnim (int set, int anim, bool flipped) {
 
-	return (flipped? flippedAnimSets: animSets)[set] + anim;
+	if (!animSets[set].loaded) loadAnimSet(set);
+
+	return (flipped? animSets[set].flippedAnims: animSets[set].anims) + anim;
 
 }
 
@@ -458,7 +528,7 @@ int JJ2Level::play () {
 
 		// Process frame-by-frame activity
 
-		while (getTimeChange() >= T_STEP) {
+		while (stepDue()) {
 
 			// Apply controls to local player
 			for (count = 0; count < PCONTROLS; count++)
@@ -39,6 +39,9 @@
 // Number of layers
 #define LAYERS 8
 
+// Number of animation sets that events can ask to be loaded with the level
+#define JJ2WARMSETS 256
+
 // Player animations
 #define JJ2PA_BOARD        0
 #define JJ2PA_BOARDSW      1
@@ -144,24 +147,42 @@ typedef struct {
 
 } JJ2Modifier;
 
+/// JJ2 animation set, loaded from anims.j2a when first used
+typedef struct {
+
+	Anim*   anims; ///< Animations
+	Anim*   flippedAnims; ///< Animations (flipped)
+	Sprite* sprites; ///< Sprite images
+	Sprite* flippedSprites; ///< Sprite images (flipped)
+	int     offset; ///< Position of the set in anims.j2a
+	bool    loaded; ///< Whether or not the set has been loaded
+
+} JJ2AnimSet;
+
 
 // Classes
 
+class File;
 class Font;
 
 ///< JJ2 level parallaxing layer
 class JJ2Layer {
 
 	private:
-		JJ2Tile** grid; ///< Layer tiles
-		int       width; ///< Width (in tiles)
-		int       height; ///< Height (in tiles)
-		bool      tileX; ///< Repeat horizontally
-		bool      tileY; ///< Repeat vertically
-		bool      limit; ///< Do not view beyond edges
-		bool      warp; ///< Warp effect
-		fixed     xSpeed; ///< Relative horizontal speed
-		fixed     ySpeed; ///< Relative vertical speed
+		JJ2Tile* grid; ///< Layer tiles, row by row
+		int*     rowStart; ///< First occupied column of each row (width if none)
+		int*     rowEnd; ///< Column after the last occupied column of each row (0 if none)
+		int      width; ///< Width (in tiles)
+		int      height; ///< Height (in tiles)
+		bool     tileX; ///< Repeat horizontally
+		bool     tileY; ///< Repeat vertically
+		bool     limit; ///< Do not view beyond edges
+		bool     warp; ///< Warp effect
+		bool     empty; ///< No tiles to draw
+		fixed    xSpeed; ///< Relative horizontal speed
+		fixed    ySpeed; ///< Relative vertical speed
+
+		void create (int newWidth, int newHeight);
 
 		JJ2Layer(const JJ2Layer&); // non construction-copyable
 		JJ2Layer& operator=(const JJ2Layer&); // non copyable
@@ -193,14 +214,12 @@ class JJ2Level : public Level {
 		SDL_Surface*  flippedTileSet; ///< Tile images (flipped)
 		JJ2Event*     events; ///< "Movable" events
 		Font*         font; ///< On-screen message font
-		char*         mask; ///< Tile masks
-		char*         flippedMask; ///< Tile masks (flipped)
+		unsigned int* mask; ///< Tile masks, as 32 rows of 32 bits per tile
 		char*         musicFile; ///< Music file name
 		char*         nextLevel; ///< Next level file name
-		Sprite*       spriteSet; ///< Sprite images
-		Sprite*       flippedSpriteSet; ///< Sprite images (flipped)
-		Anim**        animSets; ///< Animation sets
-		Anim**        flippedAnimSets; ///< Animation sets (flipped)
+		File*         animFile; ///< anims.j2a, from which animation sets are loaded
+		JJ2AnimSet*   animSets; ///< Animation sets
+		bool          warmAnimSets[JJ2WARMSETS]; ///< Animation sets used by events
 		char          playerAnims[JJ2PANIMS]; ///< Player animations
 		JJ2Layer*     layers[LAYERS]; ///< All layers
 		JJ2Layer*     layer; ///< Layer 4
@@ -211,14 +230,16 @@ class JJ2Level : public Level {
 		fixed         waterLevelTarget; ///< Future height of water
 		fixed         waterLevelSpeed; ///< Rate of water level change
 
-		void createEvent (int x, int y, const unsigned char* data);
-		int  load        (char* fileName, bool checkpoint);
-		void loadSprite  (unsigned char* parameters, unsigned char* compressedPixels, Sprite* sprite, Sprite* flippedSprite);
-		int  loadSprites ();
-		int  loadTiles   (char* fileName);
+		void         createEvent (int x, int y, const unsigned char* data);
+		unsigned int getMaskRow  (int tX, int tY, int row);
+		int          load        (char* fileName, bool checkpoint);
+		void         loadAnimSet (int set);
+		void         loadSprite  (unsigned char* parameters, unsigned char* compressedPixels, Sprite* sprite, Sprite* flippedSprite);
+		int          loadSprites ();
+		int          loadTiles   (char* fileName);
 
-		int  step        ();
-		void draw        ();
+		int          step        ();
+		void         draw        ();
 
 	public:
 		JJ2Level  (Game* owner, char* fileName, bool checkpoint, bool multi);
@@ -226,10 +247,10 @@ class JJ2Level : public Level {
 
 		bool         checkMaskDown (fixed x, fixed y, bool drop);
 		bool         checkMaskUp   (fixed x, fixed y);
+		int          findMaskDown  (fixed x, unsigned int columns, fixed y, int rows, bool drop);
 		Anim*        getAnim       (int set, int anim, bool flipped);
 		Anim*        getPlayerAnim (int character, int anim, bool flipped);
 		JJ2Modifier* getModifier   (int gridX, int gridY);
-		Sprite*      getSprite     (unsigned char sprite);
 		fixed        getWaterLevel ();
 		void         setFrame      (int gridX, int gridY, unsigned char frame);
 		void         setNext       (char* fileName);
@@ -34,6 +34,7 @@
 #include "io/gfx/sprite.h"
 #include "io/gfx/video.h"
 #include "io/sound.h"
+#include "io/log.h"
 #include "loop.h"
 #include "util.h"
 
@@ -65,6 +66,7 @@ void JJ2Level::loadSprite (unsigned char* parameters, unsigned char* compressedP
 	if ((width == 0) || (height == 0)) {
 
 		sprite->clearPixels();
+		flippedSprite->clearPixels();
 
 		return;
 
@@ -112,7 +114,7 @@ void JJ2Level::loadSprite (unsigned char* parameters, unsigned char* compressedP
 	// Set sprite data
 	sprite->setOffset(createShort(parameters + 8),
 		createShort(parameters + 10));
-	sprite->setPixels(pixels, width, height, 0);
+	spriteAtlas.add(sprite, pixels, width, height, 0);
 
 	// Flip sprite
 	for (y = 0; y < height; y++) {
@@ -130,7 +132,7 @@ void JJ2Level::loadSprite (unsigned char* parameters, unsigned char* compressedP
 	// Set flipped sprite data
 	flippedSprite->setOffset(-createShort(parameters + 8) - width,
 		createShort(parameters + 10));
-	flippedSprite->setPixels(pixels, width, height, 0);
+	spriteAtlas.add(flippedSprite, pixels, width, height, 0);
 
 	delete[] pixels;
 
@@ -138,131 +140,144 @@ void JJ2Level::loadSprite (unsigned char* parameters, unsigned char* compressedP
 
 
 /**
- * Load sprites.
+ * Load an animation set, and its flipped copy, from anims.j2a.
  *
- * @return Error code
+ * @param set Animation set number
  */
-int JJ2Level::loadSprites () {
+void JJ2Level::loadAnimSet (int set) {
 
-	File* file;
-	int* setOffsets;
-	int set;
+	JJ2AnimSet* animSet = animSets + set;
 
-	// Thanks to Neobeo for working out the .j2a format
+	animSet->loaded = true;
 
+	animFile->seek(animSet->offset + 4, true);
 
-	try {
+	int setAnims = animFile->loadChar();
 
-		file = new File("anims.j2a", PATH_TYPE_GAME);
+	animFile->seek(1, false);
 
-	} catch (int e) {
+	int setSprites = animFile->loadShort();
 
-		return e;
+	if (!setAnims) return;
 
-	}
+	animSet->anims = new Anim[setAnims];
+	animSet->flippedAnims = new Anim[setAnims];
+	animSet->sprites = new Sprite[setSprites];
+	animSet->flippedSprites = new Sprite[setSprites];
 
-	file->seek(24, true);
+	animFile->seek(4, false);
 
-	nAnimSets = file->loadInt();
+	int aCLength = animFile->loadInt();
+	int aLength = animFile->loadInt();
+	int bCLength = animFile->loadInt();
+	int bLength = animFile->loadInt();
+	int cCLength = animFile->loadInt();
+	int cLength = animFile->loadInt();
+	animFile->loadInt(); // Don't need this compressed block length
+	animFile->loadInt(); // Don't need this block length
 
-	setOffsets = new int[nAnimSets];
+	unsigned char* aBuffer = animFile->loadLZ(aCLength, aLength);
+	unsigned char* bBuffer = animFile->loadLZ(bCLength, bLength);
+	unsigned char* cBuffer = animFile->loadLZ(cCLength, cLength);
 
-	for (set = 0; set < nAnimSets; set++) setOffsets[set] = file->loadInt();
+	int setSprite = 0;
 
+	for (int anim = 0; anim < setAnims; anim++) {
 
-	// Count number of sprites
+		int animSprites = createShort(aBuffer + (anim * 8));
 
-	int nSprites = 0;
+		// Fonts are loaded separately
+		if (animSprites == 224) animSprites = 1;
 
-	for (set = 0; set < nAnimSets; set++) {
+		animSet->anims[anim].setData(animSprites, 0, 0, 0, 0, 0, 0);
+		animSet->flippedAnims[anim].setData(animSprites, 0, 0, 0, 0, 0, 0);
 
-		file->seek(setOffsets[set] + 6, true);
+		for (int sprite = 0; sprite < animSprites; sprite++) {
 
-		nSprites += file->loadShort();
+			loadSprite(bBuffer + (setSprite * 24), cBuffer,
+				animSet->sprites + setSprite, animSet->flippedSprites + setSprite);
 
-	}
+			animSet->anims[anim].setFrame(sprite, false);
+			animSet->anims[anim].setFrameData(animSet->sprites + setSprite, 0, 0);
+			animSet->flippedAnims[anim].setFrame(sprite, false);
+			animSet->flippedAnims[anim].setFrameData(animSet->flippedSprites + setSprite, 0, 0);
 
-	spriteSet = new Sprite[nSprites];
-	flippedSpriteSet = new Sprite[nSprites];
-	animSets = new Anim *[nAnimSets];
-	flippedAnimSets = new Anim *[nAnimSets];
+			setSprite++;
 
+		}
 
-	// Load animations and sprites
+	}
 
-	nSprites = 0;
+	delete[] cBuffer;
+	delete[] bBuffer;
+	delete[] aBuffer;
 
-	for (set = 0; set < nAnimSets; set++) {
+	spriteAtlas.pack();
 
-		file->seek(setOffsets[set] + 4, true);
+	LOG_TRACE("Loaded animation set %d (%d sprites)", set, setSprite);
 
-		int setAnims = file->loadChar();
+}
 
-		if (setAnims) {
 
-			animSets[set] = new Anim[setAnims];
-			flippedAnimSets[set] = new Anim[setAnims];
+/**
+ * Read the index of animation sets in anims.j2a, and load the sets the level
+ * is known to use. Other sets are loaded when first used.
+ *
+ * @return Error code
+ */
+int JJ2Level::loadSprites () {
 
-		} else {
+	int set;
 
-			animSets[set] = NULL;
-			flippedAnimSets[set] = NULL;
+	// Thanks to Neobeo for working out the .j2a format
 
-		}
 
-		file->seek(7, false);
+	try {
+
+		animFile = new File("anims.j2a", PATH_TYPE_GAME);
+
+	} catch (int e) {
 
-		int aCLength = file->loadInt();
-		int aLength = file->loadInt();
-		int bCLength = file->loadInt();
-		int bLength = file->loadInt();
-		int cCLength = file->loadInt();
-		int cLength = file->loadInt();
-		file->loadInt(); // Don't need this compressed block length
-		file->loadInt(); // Don't need this block length
+		return e;
 
-		unsigned char* aBuffer = file->loadLZ(aCLength, aLength);
-		unsigned char* bBuffer = file->loadLZ(bCLength, bLength);
-		unsigned char* cBuffer = file->loadLZ(cCLength, cLength);
+	}
 
-		int setSprite = 0;
+	animFile->seek(24, true);
 
-		for (int anim = 0; anim < setAnims; anim++) {
+	nAnimSets = animFile->loadInt();
 
-			int animSprites = createShort(aBuffer + (anim * 8));
+	animSets = new JJ2AnimSet[nAnimSets];
 
-			// Fonts are loaded separately
-			if (animSprites == 224) animSprites = 1;
+	for (set = 0; set < nAnimSets; set++) {
 
-			animSets[set][anim].setData(animSprites, 0, 0, 0, 0, 0, 0);
-			flippedAnimSets[set][anim].setData(animSprites, 0, 0, 0, 0, 0, 0);
+		animSets[set].anims = NULL;
+		animSets[set].flippedAnims = NULL;
+		animSets[set].sprites = NULL;
+		animSets[set].flippedSprites = NULL;
+		animSets[set].offset = animFile->loadInt();
+		animSets[set].loaded = false;
 
-			for (int sprite = 0; sprite < animSprites; sprite++) {
+	}
 
-				loadSprite(bBuffer + (setSprite * 24), cBuffer, spriteSet + nSprites, flippedSpriteSet + nSprites);
 
-				animSets[set][anim].setFrame(sprite, false);
-				animSets[set][anim].setFrameData(spriteSet + nSprites, 0, 0);
-				flippedAnimSets[set][anim].setFrame(sprite, false);
-				flippedAnimSets[set][anim].setFrameData(flippedSpriteSet + nSprites, 0, 0);
+	// Load the sets used by events and players now, to avoid pauses later
 
-				setSprite++;
-				nSprites++;
+	warmAnimSets[TSF? 55: 54] = true;
 
-			}
+	int loaded = 0;
 
-		}
+	for (set = 0; (set < nAnimSets) && (set < JJ2WARMSETS); set++) {
 
-		delete[] cBuffer;
-		delete[] bBuffer;
-		delete[] aBuffer;
+		if (warmAnimSets[set]) {
 
-	}
+			loadAnimSet(set);
+			loaded++;
 
+		}
 
-	delete[] setOffsets;
+	}
 
-	delete file;
+	LOG_DEBUG("Loaded %d of %d animation sets", loaded, nAnimSets);
 
 
 	return E_NONE;
@@ -376,31 +391,14 @@ int JJ2Level::loadTiles (char* fileName) {
 
 	// Load mask
 
-	mask = new char[tiles << 10];
+	mask = new unsigned int[tiles << 5];
 
-	// Unpack bits
+	// Each row is stored as 32 bits, with the leftmost pixel in the lowest
+	// bit. Flipped masks are not loaded, as reversing the bits gives them.
 	for (count = 0; count < tiles; count++) {
 
-		for (y = 0; y < 32; y++) {
-
-			for (x = 0; x < 32; x++)
-				mask[(count << 10) + (y << 5) + x] = (dBuffer[createInt(aBuffer + 1028 + (maxTiles * 18) + (count << 2)) + (y << 2) + (x >> 3)] >> (x & 7)) & 1;
-
-		}
-
-	}
-
-	flippedMask = new char[tiles << 10];
-
-	// Unpack bits
-	for (count = 0; count < tiles; count++) {
-
-		for (y = 0; y < 32; y++) {
-
-			for (x = 0; x < 32; x++)
-				flippedMask[(count << 10) + (y << 5) + x] = (dBuffer[createInt(aBuffer + 1028 + (maxTiles * 22) + (count << 2)) + (y << 2) + (x >> 3)] >> (x & 7)) & 1;
-
-		}
+		for (y = 0; y < 32; y++)
+			mask[(count << 5) + y] = createInt(dBuffer + createInt(aBuffer + 1028 + (maxTiles * 18) + (count << 2)) + (y << 2));
 
 	}
 
@@ -421,11 +419,12 @@ int JJ2Level::loadTiles (char* fileName) {
 
 			for (x = 0; x < 32; x++) {
 
-				if (mask[(count << 10) + (y << 5) + x] == 1)
+				if ((mask[(count << 5) + y] >> x) & 1) {
+
 					((char *)(tileSet->pixels))[(count << 10) + (y << 5) + x] = 43;
+					((char *)(flippedTileSet->pixels))[(count << 10) + (y << 5) + 31 - x] = 88;
 
-				if (flippedMask[(count << 10) + (y << 5) + x] == 1)
-					((char *)(flippedTileSet->pixels))[(count << 10) + (y << 5) + x] = 88;
+				}
 
 			}
 
@@ -514,6 +513,9 @@ void JJ2Level::createEvent (int x, int y, const unsigned char* data) {
 
 	}
 
+	// Note the animation sets the event will use
+	events->markAnimSets(warmAnimSets);
+
 }
 
 
@@ -702,6 +704,8 @@ int JJ2Level::load (char *fileName, bool checkpoint) {
 
 	events = NULL;
 
+	memset(warmAnimSets, 0, sizeof(warmAnimSets));
+
 	for (y = 0; y < height; y++) {
 
 		mods[y] = *mods + (y * width);
@@ -742,7 +746,6 @@ int JJ2Level::load (char *fileName, bool checkpoint) {
 
 		for (x = 0; x < LAYERS; x++) delete layers[x];
 
-		delete[] flippedMask;
 		delete[] mask;
 
 		delete[] musicFile;
@@ -788,8 +791,8 @@ int JJ2Level::load (char *fileName, bool checkpoint) {
 		for (count = 0; count < JJ2PANIMS; count++) {
 
 			playerAnims[count] = count;
-			pAnims[count] = animSets[55] + count;
-			pFlippedAnims[count] = flippedAnimSets[55] + count;
+			pAnims[count] = getAnim(55, count, false);
+			pFlippedAnims[count] = getAnim(55, count, true);
 
 		}
 
@@ -876,8 +879,8 @@ int JJ2Level::load (char *fileName, bool checkpoint) {
 
 		for (count = 0; count < JJ2PANIMS; count++) {
 
-			pAnims[count] = animSets[54] + playerAnims[count];
-			pFlippedAnims[count] = flippedAnimSets[54] + playerAnims[count];
+			pAnims[count] = getAnim(54, playerAnims[count], false);
+			pFlippedAnims[count] = getAnim(54, playerAnims[count], true);
 
 		}
 
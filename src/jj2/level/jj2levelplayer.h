@@ -86,6 +86,7 @@
 #define JJ2PXO_ML   (JJ2PXO_MID - F4)
 #define JJ2PXO_MR   (JJ2PXO_MID + F4)
 #define JJ2PXO_R    (JJ2PXO_MID + F10)
+#define JJ2PXM_FEET 0x111 /* Columns checked for ground, from JJ2PXO_ML: ML, MID and MR */
 #define JJ2PYO_TOP  (-F20)
 #define JJ2PYO_MID  (-F10)
 #define JJ2PYO_JUMP ITOF(92)
@@ -668,19 +668,15 @@ void JJ2LevelPlayer::move (unsigned int ticks, int msps) {
 
 			count = pdy >> 10;
 
-			while (count > 0) {
+			// Move down until the ground is reached
+			int clear = jj2Level->findMaskDown(x + JJ2PXO_ML, JJ2PXM_FEET, y + F1, count, drop);
 
-				if (checkMaskDown(F1, drop)) {
+			y += clear * F1;
 
-					y |= 1023;
-					dy = 0;
+			if (clear < count) {
 
-					break;
-
-				}
-
-				y += F1;
-				count--;
+				y |= 1023;
+				dy = 0;
 
 			}
 
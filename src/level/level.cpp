@@ -30,10 +30,12 @@
 #include "level.h"
 
 #include "game/game.h"
+#include "game/replay.h"
 #include "io/controls.h"
 #include "io/gfx/font.h"
 #include "io/gfx/sprite.h"
 #include "io/gfx/video.h"
+#include "io/profiler.h"
 #include "io/sound.h"
 #include "player/player.h"
 #include "jj1/scene/jj1scene.h"
@@ -62,6 +64,7 @@ Level::Level (Game* owner) {
 	// Set the level stage
 	stage = LS_NORMAL;
 	sprites = tickOffset = steps = prevTicks = ticks = endTime = items = stats = 0;
+	frameSteps = 0;
 	multiplayer = false;
 }
 
@@ -120,6 +123,10 @@ int Level::playScene (const char* file) {
 	delete paletteEffects;
 	paletteEffects = NULL;
 
+	// Cutscenes wait for key presses, so cannot be simulated or shown by a
+	// dedicated server
+	if (headless || dedicated) return E_NONE;
+
 	try {
 
 		scene = new JJ1Scene(file);
@@ -164,24 +171,62 @@ void Level::timeCalcs () {
 
 	// Track number of ticks of gameplay since the level started
 
-	if (paused) {
+	unsigned int oldTicks = ticks;
+	frameSteps = 0;
 
-		tickOffset = globalTicks - ticks;
+	if (replay.isPlaying()) {
 
-	} else if (globalTicks - tickOffset > ticks + 100) {
+		// Use the recorded time, regardless of how long the frame took
+		int change = replay.loadFrame();
 
 		prevTicks = ticks;
-		ticks += 100;
+		if (change > 0) ticks += change;
+
+		tickOffset = globalTicks - ticks;
+
+	} else if (paused) {
 
 		tickOffset = globalTicks - ticks;
 
 	} else {
 
+		// Let the time run at most MAX_FRAME_STEPS steps ahead of the last
+		// step, so that slow steps make the level fall behind real time
+		// instead of making frames longer and longer
+		unsigned int limit = getStepTime(steps + MAX_FRAME_STEPS);
+		if (limit < ticks) limit = ticks;
+
 		prevTicks = ticks;
-		ticks = globalTicks - tickOffset;
+
+		if (globalTicks - tickOffset > limit) {
+
+			ticks = limit;
+			tickOffset = globalTicks - ticks;
+
+		} else {
+
+			ticks = globalTicks - tickOffset;
+
+		}
 
 	}
 
+	replay.storeFrame(ticks - oldTicks);
+
+}
+
+
+/**
+ * Calculate the time at which a number of steps have been completed.
+ *
+ * @param count Number of steps
+ *
+ * @return Time after the steps
+ */
+unsigned int Level::getStepTime (unsigned int count) {
+
+	return (count * (setup.slowMotion? 100: 50)) / 3;
+
 }
 
 
@@ -192,7 +237,71 @@ void Level::timeCalcs () {
  */
 int Level::getTimeChange () {
 
-	return paused? 0: ticks - ((steps * (setup.slowMotion? 100: 50)) / 3);
+	return paused? 0: ticks - getStepTime(steps);
+
+}
+
+
+/**
+ * Determine whether or not another step is due, counting the steps taken
+ * during the frame. timeCalcs() keeps the time from running more than
+ * MAX_FRAME_STEPS steps ahead.
+ *
+ * @return Whether or not to take a step
+ */
+bool Level::stepDue () {
+
+	if ((getTimeChange() < T_STEP) || (frameSteps >= MAX_FRAME_STEPS)) return false;
+
+	frameSteps++;
+
+	return true;
+
+}
+
+
+/**
+ * Display the time spent in each phase of a frame, against the time available
+ * for a step.
+ *
+ * @param bg Palette index of the box
+ * @param barPalIndex Palette index of the bars
+ * @param overPalIndex Palette index of the bars of phases over the budget
+ */
+void Level::drawProfile (unsigned char bg, unsigned char barPalIndex,
+	unsigned char overPalIndex) {
+
+	int phase, y, width;
+
+	video.drawRect(4, 11, 228, (PP_PHASES * 9) + 3, bg);
+
+	// The budget of one step spans 96 pixels
+	video.drawRect(172, 12, 1, (PP_PHASES * 9) + 1, barPalIndex);
+
+	for (phase = 0; phase < PP_PHASES; phase++) {
+
+		ProfilePhase pp = static_cast<ProfilePhase>(phase);
+		y = 14 + (phase * 9);
+
+		// Indent the parts of steps and drawing
+		if ((pp == PP_STEP) || (pp == PP_DRAW) || (pp == PP_FLIP))
+			panelBigFont->showString(profiler.getName(pp), 8, y);
+		else
+			panelBigFont->showString(profiler.getName(pp), 16, y);
+
+		width = (profiler.getAverage(pp) * 96) / (T_STEP * 1000);
+
+		if (width > 0)
+			video.drawRect(76, y, CLAMP(width, 0, 104), 7,
+				(width > 96)? overPalIndex: barPalIndex);
+
+		// Mark the longest recent duration
+		width = (profiler.getPeak(pp) * 96) / (T_STEP * 1000);
+		video.drawRect(76 + CLAMP(width, 0, 104), y, 1, 7, overPalIndex);
+
+		panelBigFont->showNumber(profiler.getAverage(pp), 228, y);
+
+	}
 
 }
 
@@ -216,10 +325,13 @@ void Level::drawOverlay (unsigned char bg, bool menu, int option,
 	// Draw graphics statistics
 
 	if (stats & S_SCREEN) {
+		// Leave room for the present thread's statistics
+		int extra = video.hasPresentThread()? 24: 0;
+
 		if (video.getScaleFactor() > MIN_SCALE)
-			video.drawRect(canvasW - 84, 11, 80, 37, bg);
+			video.drawRect(canvasW - 84, 11, 80, 49 + extra, bg);
 		else
-			video.drawRect(canvasW - 84, 11, 80, 25, bg);
+			video.drawRect(canvasW - 84, 11, 80, 37 + extra, bg);
 
 		panelBigFont->showNumber(video.getWidth(), canvasW - 52, 14);
 		panelBigFont->showString("x", canvasW - 48, 14);
@@ -232,6 +344,21 @@ void Level::drawOverlay (unsigned char bg, bool menu, int option,
 			panelBigFont->showString("x", canvasW - 48, 39);
 			panelBigFont->showNumber(canvasH, canvasW - 12, 38);
 		}
+
+		// Time spent stepping per frame, in microseconds
+		int stepY = (video.getScaleFactor() > MIN_SCALE)? 50: 38;
+		panelBigFont->showString("step", canvasW - 76, stepY);
+		panelBigFont->showNumber(profiler.getAverage(PP_STEP), canvasW - 12, stepY);
+
+		if (video.hasPresentThread()) {
+			// Present duration in microseconds, and frames never shown
+			panelBigFont->showString("pres", canvasW - 76, stepY + 12);
+			panelBigFont->showNumber(video.getPresentTime(), canvasW - 12, stepY + 12);
+			panelBigFont->showString("drop", canvasW - 76, stepY + 24);
+			panelBigFont->showNumber(video.getDroppedFrames(), canvasW - 12, stepY + 24);
+		}
+
+		drawProfile(bg, textPalIndex, selectedTextPalIndex);
 	}
 
 	// Draw player list
@@ -462,6 +589,8 @@ int Level::loop (bool& menu, int& option, bool& message) {
 
 	timeCalcs();
 
+	if (replay.hasEnded()) return E_QUIT;
+
 	return E_NONE;
 
 }
@@ -23,6 +23,7 @@
 #ifndef _BASELEVEL_H
 #define _BASELEVEL_H
 
+#include "io/gfx/spriteatlas.h"
 #include "menu/menu.h"
 
 #ifdef OJ_SDL3
@@ -49,6 +50,9 @@
 // Time interval
 #define T_STEP 16
 
+/// Most steps taken per frame, before the level falls behind real time
+#define MAX_FRAME_STEPS 5
+
 
 // Enums
 
@@ -103,9 +107,11 @@ class Level {
 		Game*          game;
 		PaletteEffect* paletteEffects; ///< Palette effects in use while playing the level
 		SDL_Color      palette[MAX_PALETTE_COLORS]; ///< Palette in use while playing the level
+		SpriteAtlas    spriteAtlas; ///< Images of the level's sprites
 		int            sprites; ///< The number of sprite that have been loaded
 		unsigned int   tickOffset; ///< Level time offset from system time
 		unsigned int   steps; ///< Number of steps taken
+		int            frameSteps; ///< Number of steps taken during the current frame
 		unsigned int   prevTicks; ///< Time the last visual update started
 		unsigned int   ticks; ///< Current time
 		unsigned int   endTime; ///< Tick at which the level will end
@@ -118,13 +124,17 @@ class Level {
 
 		void createLevelPlayers (LevelType levelType, Anim** anims, Anim** flippedAnims, bool checkpoint, unsigned char x, unsigned char y);
 
-		int  playScene     (const char* file);
-		void timeCalcs     ();
-		int  getTimeChange ();
-		void drawOverlay   (unsigned char bg, bool menu, int option,
+		int  playScene      (const char* file);
+		void timeCalcs      ();
+		unsigned int getStepTime (unsigned int count);
+		int  getTimeChange  ();
+		bool stepDue        ();
+		void drawProfile    (unsigned char bg, unsigned char barPalIndex,
+			unsigned char overPalIndex);
+		void drawOverlay    (unsigned char bg, bool menu, int option,
 			unsigned char textPalIndex, unsigned char selectedTextPalIndex,
 			int textPalSpan);
-		int  loop          (bool& menu, int& option, bool& message);
+		int  loop           (bool& menu, int& option, bool& message);
 
 	public:
 		explicit Level(Game* owner);
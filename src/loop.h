@@ -37,9 +37,12 @@
 #define JOYSTICKHDWN 0x700
 
 
-// Variable
+// Variables
 
 EXTERN unsigned int globalTicks;
+EXTERN bool         headless; ///< Whether or not levels are simulated without output or real-time pacing
+EXTERN bool         dedicated; ///< Whether or not a server is being run without output, for network clients
+EXTERN unsigned int stepCount; ///< Number of level steps taken
 
 
 // Enum
@@ -55,9 +58,10 @@ enum LoopType {
 };
 
 
-// Function in main.cpp
+// Functions in main.cpp
 
 EXTERN int loop (LoopType type, PaletteEffect* paletteEffects = nullptr, bool effectsStopped = false);
+EXTERN int countStep ();
 
 #endif
 
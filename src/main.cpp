@@ -30,16 +30,21 @@
 #define EXTERN
 
 #include "game/game.h"
+#include "game/replay.h"
+#include "io/assetcache.h"
 #include "io/controls.h"
 #include "io/file.h"
+#include "io/gfx/blit.h"
 #include "io/gfx/font.h"
 #include "io/gfx/video.h"
 #include "io/network.h"
+#include "io/profiler.h"
 #include "io/sound.h"
 #ifdef ENABLE_JJ2
 #include "jj2/level/jj2level.h"
 #endif
 #include "jj1/level/jj1level.h"
+#include "jj1/planet/jj1planet.h"
 #include "menu/menu.h"
 #include "player/player.h"
 #include "jj1/scene/jj1scene.h"
@@ -77,14 +82,50 @@ static struct CliOptions {
 	bool muteAudio;
 	int fullScreen;
 	int scaleFactor;
+	int assetCache;
+	int netProtocol;
+	int presentThread;
+	char *fpsLimit;
 	int level;
 	int world;
 	char *verboseLevel;
 	int quiet;
+	int headless;
+	char *dedicatedMode;
+	int ticks;
+	char *recordFile;
+	char *replayFile;
+	char *traceFile;
+	int blitBenchmark;
+	int fileBenchmark;
 } cli = {
-	false, -1, -1, -1, -1, NULL, 0
+	false, -1, -1, -1, 0, 0, NULL, -1, -1, NULL, 0, 0, NULL, 0, NULL, NULL, NULL, 0, 0
 };
 
+// Length of a frame on the virtual clock used in headless mode
+#define T_HEADLESS_FRAME 17
+
+// Longest time a dedicated server waits for clients between frames
+#define T_DEDICATED_FRAME 10
+
+// Game mode of a dedicated server
+static GameModeType dedicatedMode = M_COOP;
+
+// Frame rate limits, besides a number of frames per second
+#define FRAME_LIMIT_NONE 0
+#define FRAME_LIMIT_VSYNC -1
+
+// Default frame rate limit, may be overridden by platforms
+#ifndef DEFAULT_FRAME_LIMIT
+	#define DEFAULT_FRAME_LIMIT 250
+#endif
+
+// Highest frame rate limit accepted
+#define MAX_FRAME_LIMIT 1000
+
+// Frame rate limit: FRAME_LIMIT_NONE, FRAME_LIMIT_VSYNC or frames per second
+static int frameLimit = DEFAULT_FRAME_LIMIT;
+
 #ifndef FULLSCREEN_ONLY
 int display_mode_cb(struct argparse *, const struct argparse_option *option) {
 	cli.fullScreen = (option->short_name == 'f') ? 1 : 0;
@@ -119,9 +160,30 @@ int checkOptions (int argc, char *argv[]) {
 			display_mode_cb, 0, OPT_NONEG),
 #endif
 		OPT_INTEGER('s', "scale", &cli.scaleFactor, "Scale graphics <int> times", NULL, 0, 0),
+		OPT_INTEGER('\0', "asset-cache", &cli.assetCache,
+			"Keep up to <int> MiB of unused level assets between levels", NULL, 0, 0),
+		OPT_INTEGER('\0', "net-protocol", &cli.netProtocol,
+			"Network protocol version to offer when hosting (1 or 2)", NULL, 0, 0),
+		OPT_BOOLEAN('\0', "present-thread", &cli.presentThread,
+			"Show frames from a separate thread, while the next one is drawn", NULL, 0, 0),
+		OPT_STRING('\0', "fps-limit", &cli.fpsLimit,
+			"Limit frames per second: <int>, vsync (wait for the display) or none", NULL, 0, 0),
 		OPT_GROUP("Developer options"),
 		OPT_INTEGER('w', "world", &cli.world, "Load specific World", NULL, 0, 0),
 		OPT_INTEGER('l', "level", &cli.level, "Load specific Level", NULL, 0, 0),
+		OPT_STRING('\0', "record", &cli.recordFile, "Record the first game played to a replay file", NULL, 0, 0),
+		OPT_STRING('\0', "replay", &cli.replayFile, "Play back a replay file", NULL, 0, 0),
+		OPT_BOOLEAN('\0', "headless", &cli.headless,
+			"Simulate the level given by --world and --level (or --replay) without output or delays", NULL, 0, 0),
+		OPT_INTEGER('\0', "ticks", &cli.ticks, "Number of steps to simulate in headless mode (0: no limit)", NULL, 0, 0),
+		OPT_STRING('\0', "dedicated", &cli.dedicatedMode,
+			"Host the level given by --world and --level without a window, in mode: coop, battle, teambattle or race",
+			NULL, 0, 0),
+		OPT_STRING('\0', "trace", &cli.traceFile, "Write the duration of each frame phase to a Chrome trace file", NULL, 0, 0),
+		OPT_BOOLEAN('\0', "blit-benchmark", &cli.blitBenchmark,
+			"Compare the speed of the engine's blits with SDL's, then quit", NULL, 0, 0),
+		OPT_BOOLEAN('\0', "file-benchmark", &cli.fileBenchmark,
+			"Time loading the game's levels, planets and scenes, then quit", NULL, 0, 0),
 		OPT_BOOLEAN('q', "quiet", &cli.quiet, "Disable console logging (Enable with --no-quiet)", NULL, 0, 0),
 		OPT_STRING('\0', "verbose", &cli.verboseLevel,
 			"Verbosity level: max, trace, debug, info, warn, error, fatal", NULL, 0, 0),
@@ -155,6 +217,85 @@ int checkOptions (int argc, char *argv[]) {
 	}
 	logger.setLevel(verbosity);
 
+	// headless mode cannot show menus, so needs a level to start with
+	if (cli.headless && !cli.replayFile && ((cli.world < 0) || (cli.level < 0))) {
+
+		fprintf(stderr, "error: option `--headless` requires `--world` and `--level`, or `--replay`\n");
+		exit(EXIT_FAILURE);
+
+	}
+
+	if (cli.dedicatedMode) {
+
+		if (!strcmp(cli.dedicatedMode, "coop"))            dedicatedMode = M_COOP;
+		else if (!strcmp(cli.dedicatedMode, "battle"))     dedicatedMode = M_BATTLE;
+		else if (!strcmp(cli.dedicatedMode, "teambattle")) dedicatedMode = M_TEAMBATTLE;
+		else if (!strcmp(cli.dedicatedMode, "race"))       dedicatedMode = M_RACE;
+		else {
+
+			fprintf(stderr, "error: option `--dedicated` has invalid mode\n");
+			exit(EXIT_FAILURE);
+
+		}
+
+		if ((cli.world < 0) || (cli.level < 0)) {
+
+			fprintf(stderr, "error: option `--dedicated` requires `--world` and `--level`\n");
+			exit(EXIT_FAILURE);
+
+		}
+
+		if (cli.headless || cli.recordFile || cli.replayFile) {
+
+			fprintf(stderr, "error: option `--dedicated` cannot be combined with `--headless`, `--record` or `--replay`\n");
+			exit(EXIT_FAILURE);
+
+		}
+
+	}
+
+	if (cli.fpsLimit) {
+
+		if (!strcmp(cli.fpsLimit, "vsync"))     frameLimit = FRAME_LIMIT_VSYNC;
+		else if (!strcmp(cli.fpsLimit, "none")) frameLimit = FRAME_LIMIT_NONE;
+		else {
+
+			char *end;
+			long rate = strtol(cli.fpsLimit, &end, 10);
+
+			if ((end == cli.fpsLimit) || *end || (rate < 0) || (rate > MAX_FRAME_LIMIT)) {
+
+				fprintf(stderr, "error: option `--fps-limit` must be a number up to %d, `vsync` or `none`\n",
+					MAX_FRAME_LIMIT);
+				exit(EXIT_FAILURE);
+
+			}
+
+			frameLimit = rate;
+
+		}
+
+	}
+
+	if (cli.recordFile && cli.replayFile) {
+
+		fprintf(stderr, "error: options `--record` and `--replay` cannot be combined\n");
+		exit(EXIT_FAILURE);
+
+	}
+
+	if (cli.recordFile) replay.record(cli.recordFile);
+
+	if (cli.ticks < 0) {
+
+		fprintf(stderr, "error: option `--ticks` must not be negative\n");
+		exit(EXIT_FAILURE);
+
+	}
+
+	headless = cli.headless;
+	dedicated = (cli.dedicatedMode != NULL);
+
 	return argc;
 }
 
@@ -220,6 +361,7 @@ void startUp (const char *argv0, int pathCount, char *paths[]) {
 
 	// Create the network address
 	netAddress = createString(NET_ADDRESS);
+	netProtocol = NET_PROTOCOL;
 
 
 	// Load settings from config file
@@ -237,6 +379,9 @@ void startUp (const char *argv0, int pathCount, char *paths[]) {
 	// Apply command-line override
 	if (cli.fullScreen > -1) config.fullScreen = cli.fullScreen;
 	if (cli.scaleFactor > 0) config.videoScale = cli.scaleFactor;
+	if (cli.assetCache > 2047) cli.assetCache = 2047;
+	if (cli.assetCache > -1) assetCache.setBudget(cli.assetCache << 20);
+	if ((cli.netProtocol > 0) && (cli.netProtocol <= NET_PROTOCOL)) netProtocol = cli.netProtocol;
 	if (cli.muteAudio) {
 
 		setMusicVolume(0);
@@ -247,6 +392,8 @@ void startUp (const char *argv0, int pathCount, char *paths[]) {
 
 	// Create the game's window
 	canvas = NULL;
+	if (cli.presentThread && !headless && !dedicated) video.setPresentThread(true);
+	if (frameLimit == FRAME_LIMIT_VSYNC) video.setVSync(true);
 	if (!video.init(config)) {
 
 		throw E_VIDEO;
@@ -331,8 +478,10 @@ void startUp (const char *argv0, int pathCount, char *paths[]) {
 
 	delete[] pixels;
 
-	// Establish arbitrary timing
-	globalTicks = SDL_GetTicks() - 20;
+	// Establish arbitrary timing, which is fixed for reproducible simulations
+	globalTicks = headless? 0: SDL_GetTicks() - 20;
+
+	if (cli.traceFile) profiler.startTrace(cli.traceFile);
 
 
 	// Fill trigonometric function look-up tables
@@ -360,8 +509,13 @@ void startUp (const char *argv0, int pathCount, char *paths[]) {
  */
 void shutDown () {
 
+	replay.stop();
+	profiler.stopTrace();
+
 	delete net;
 
+	assetCache.clear();
+
 	delete panelBigFont;
 	delete panelSmallFont;
 	delete font2;
@@ -376,8 +530,9 @@ void shutDown () {
 
 	video.deinit();
 
-	// Save settings to config file
-	setup.save();
+	// Save settings to config file, unless simulating, so that several
+	// simulations can run at once
+	if (!headless && !dedicated) setup.save();
 
 }
 
@@ -392,6 +547,79 @@ int play () {
 	MainMenu *mainMenu = NULL;
 	JJ1Scene *scene = NULL;
 
+	// Host the user-specified level for network clients, bypassing all menus
+	if (dedicated) {
+
+		Game *game;
+		char *firstLevel = createFileName("LEVEL", cli.level, cli.world);
+
+		try {
+
+			game = new ServerGame(dedicatedMode, firstLevel, difficultyType::Normal);
+
+		} catch (int e) {
+
+			LOG_ERROR("Could not create server: %d", e);
+
+			delete[] firstLevel;
+
+			return e;
+
+		}
+
+		LOG_INFO("Hosting %s on port %d.", firstLevel, NET_PORT);
+
+		delete[] firstLevel;
+
+		int ret = game->play();
+
+		delete game;
+
+		return (ret == E_QUIT)? E_NONE: ret;
+
+	}
+
+	// Simulate the user-specified level or replay, bypassing all menus
+	if (headless || cli.replayFile) {
+
+		Game *game;
+		char *firstLevel;
+		difficultyType difficulty = difficultyType::Normal;
+
+		if (cli.replayFile) {
+
+			int ret = replay.play(cli.replayFile, firstLevel, difficulty);
+
+			if (ret < 0) return ret;
+
+		} else {
+
+			firstLevel = createFileName("LEVEL", cli.level, cli.world);
+
+		}
+
+		try {
+
+			game = new LocalGame(firstLevel, difficulty);
+
+		} catch (int e) {
+
+			delete[] firstLevel;
+
+			return e;
+
+		}
+
+		delete[] firstLevel;
+
+		int ret = game->play();
+
+		delete game;
+
+		return (ret == E_QUIT)? E_NONE: ret;
+
+	}
+
 	// Start the opening music
 
 	playMusic("MENUSNG.PSM");
@@ -489,6 +717,237 @@ int play () {
 }
 
 
+/**
+ * Time loading the JJ1 levels, planet approaches and cutscenes found in the
+ * game data, as the game does, but without waiting on the loading screen.
+ *
+ * @return Error code
+ */
+static int benchmarkLoading () {
+
+	const char* sceneNames[] = {"STARTUP.0SC", "END.0SC", "BONUS.0SC",
+		"INSTRUCT.0SC", "ORDER.0SC"};
+	Game* game;
+	JJ1Level* jj1Level;
+	JJ1Planet* planet;
+	JJ1Scene* scene;
+	char* name;
+	Uint64 start, time, levelTime = 0, planetTime = 0, sceneTime = 0;
+	int levels = 0, planets = 0, scenes = 0;
+	int ret = E_NONE;
+
+	// Decode on this thread, as when simulating, so that the loading screen's
+	// frame limiting and presentation are not timed
+	bool wasHeadless = headless;
+	headless = true;
+
+	try {
+
+		game = new LocalGame("", difficultyType::Normal);
+
+	} catch (int e) {
+
+		headless = wasHeadless;
+
+		return e;
+
+	}
+
+	for (int world = 0; world < 100; world++) {
+
+		for (int levelNum = 0; levelNum < 3; levelNum++) {
+
+			name = createFileName("LEVEL", levelNum, world);
+
+			if (fileExists(name, PATH_TYPE_GAME)) {
+
+				start = profiler.getTime();
+
+				try {
+
+					jj1Level = new JJ1Level(game, name, false, false);
+
+				} catch (int e) {
+
+					LOG_ERROR("Could not load %s", name);
+
+					jj1Level = NULL;
+					ret = e;
+
+				}
+
+				if (jj1Level) {
+
+					time = profiler.toMicroseconds(profiler.getTime() - start);
+					LOG_DEBUG("Loaded %s in %u us", name, (unsigned int)time);
+
+					levelTime += time;
+					levels++;
+
+					delete jj1Level;
+
+				}
+
+			}
+
+			delete[] name;
+
+		}
+
+		name = createFileName("PLANET", world);
+
+		if (fileExists(name, PATH_TYPE_GAME)) {
+
+			start = profiler.getTime();
+
+			try {
+
+				planet = new JJ1Planet(name, -1);
+
+			} catch (int e) {
+
+				LOG_ERROR("Could not load %s", name);
+
+				planet = NULL;
+				ret = e;
+
+			}
+
+			if (planet) {
+
+				time = profiler.toMicroseconds(profiler.getTime() - start);
+				LOG_DEBUG("Loaded %s in %u us", name, (unsigned int)time);
+
+				planetTime += time;
+				planets++;
+
+				delete planet;
+
+			}
+
+		}
+
+		delete[] name;
+
+	}
+
+	delete game;
+
+	for (unsigned int i = 0; i < sizeof(sceneNames) / sizeof(sceneNames[0]); i++) {
+
+		if (!fileExists(sceneNames[i], PATH_TYPE_GAME)) continue;
+
+		start = profiler.getTime();
+
+		try {
+
+			scene = new JJ1Scene(sceneNames[i]);
+
+		} catch (int e) {
+
+			LOG_ERROR("Could not load %s", sceneNames[i]);
+
+			scene = NULL;
+			ret = e;
+
+		}
+
+		if (scene) {
+
+			time = profiler.toMicroseconds(profiler.getTime() - start);
+			LOG_DEBUG("Loaded %s in %u us", sceneNames[i], (unsigned int)time);
+
+			sceneTime += time;
+			scenes++;
+
+			delete scene;
+
+		}
+
+	}
+
+	headless = wasHeadless;
+
+	if (!levels && !planets && !scenes) {
+
+		LOG_ERROR("No JJ1 data files found");
+
+		return E_FILE;
+
+	}
+
+	LOG_INFO("Load benchmark:");
+	LOG_INFO("  %d levels in %u us", levels, (unsigned int)levelTime);
+	LOG_INFO("  %d planets in %u us", planets, (unsigned int)planetTime);
+	LOG_INFO("  %d scenes in %u us", scenes, (unsigned int)sceneTime);
+
+	return ret;
+
+}
+
+
+/**
+ * Wait until the next frame is due, according to the frame rate limit.
+ *
+ * Never busy-waits. Where only millisecond sleeps are available, a frame may
+ * be up to half a millisecond early or late, but frames are still due at
+ * regular intervals, unless one is very late, in which case the interval
+ * starts again.
+ */
+static void waitForFrame () {
+
+	int rate = frameLimit;
+
+	if (rate == FRAME_LIMIT_VSYNC) {
+
+		// Showing the frame waits for the display, unless it is done by the
+		// present thread (or vsync is not available)
+		if (video.hasVSync() && !video.hasPresentThread()) return;
+
+		rate = video.getRefreshRate();
+
+	}
+
+	if (rate <= FRAME_LIMIT_NONE) return;
+
+#if OJ_SDL3 || OJ_SDL2
+	static Uint64 due = 0;
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 period = frequency / rate;
+	Uint64 now = SDL_GetPerformanceCounter();
+
+	if ((now > due + period) || (due > now + period)) due = now;
+
+	if (now < due) {
+
+	#if OJ_SDL3
+		SDL_DelayPrecise(((due - now) * SDL_NS_PER_SECOND) / frequency);
+	#else
+		// Round to the nearest millisecond rather than spinning for the
+		// rest, as frames stay due at regular intervals regardless
+		Uint32 ms = (((due - now) * 1000) + (frequency >> 1)) / frequency;
+
+		if (ms) SDL_Delay(ms);
+	#endif
+
+	}
+
+	due += period;
+#else
+	static Uint32 due = 0;
+	Uint32 period = 1000 / rate;
+	Uint32 now = SDL_GetTicks();
+
+	if ((now > due + period) || (due > now + period)) due = now;
+
+	if (now < due) SDL_Delay(due - now);
+
+	due += period;
+#endif
+
+}
+
+
 /**
  * Process iteration.
  *
@@ -508,18 +967,41 @@ int loop (LoopType type, PaletteEffect* paletteEffects, bool effectsStopped) {
 
 	// Update tick count
 	prevTicks = globalTicks;
-	globalTicks = SDL_GetTicks();
 
-	if (globalTicks - prevTicks < 4) {
+	if (headless) {
+
+		// Advance the virtual clock by one frame, without waiting or showing
+		// anything
+		globalTicks += T_HEADLESS_FRAME;
+
+	} else {
 
-		// Limit framerate
-		SDL_Delay(4 + prevTicks - globalTicks);
 		globalTicks = SDL_GetTicks();
 
+		if (dedicated) {
+
+			// Sleep until a client needs attention or the next frame is due
+			if (globalTicks - prevTicks < T_DEDICATED_FRAME) {
+
+				net->wait(T_DEDICATED_FRAME + prevTicks - globalTicks);
+				globalTicks = SDL_GetTicks();
+
+			}
+
+		} else {
+
+			// Limit framerate
+			waitForFrame();
+			globalTicks = SDL_GetTicks();
+
+			// Show what has been drawn
+			video.flip(globalTicks - prevTicks, paletteEffects, effectsStopped);
+
+		}
+
 	}
 
-	// Show what has been drawn
-	video.flip(globalTicks - prevTicks, paletteEffects, effectsStopped);
+	profiler.endFrame();
 
 
 	// Process system events
@@ -567,6 +1049,26 @@ int loop (LoopType type, PaletteEffect* paletteEffects, bool effectsStopped) {
 
 }
 
+
+/**
+ * Count a completed level step.
+ *
+ * In headless mode, ends the simulation once the requested number of steps
+ * has been taken.
+ *
+ * @return Error code
+ */
+int countStep () {
+
+	stepCount++;
+
+	if (headless && cli.ticks && (stepCount >= (unsigned int)cli.ticks))
+		return E_QUIT;
+
+	return E_NONE;
+
+}
+
 /**
  * Shows version information of used SDL library.
  *
@@ -633,6 +1135,30 @@ int main(int argc, char *argv[]) {
 	// Log current version
 	LOG_INFO("This is OpenJazz %s, built on %s.", oj_version, oj_date);
 
+	// In headless and dedicated server modes, use SDL's dummy drivers, which
+	// neither open a window nor play any sound
+	if (headless || dedicated) {
+
+#if OJ_SDL3
+		SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "dummy");
+		SDL_SetHint(SDL_HINT_AUDIO_DRIVER, "dummy");
+#elif OJ_SDL2
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+#else
+		SDL_putenv("SDL_VIDEODRIVER=dummy");
+		SDL_putenv("SDL_AUDIODRIVER=dummy");
+#endif
+
+		cli.muteAudio = true;
+
+	}
+
+#if OJ_SDL2
+	// The present thread talks to the X server as well
+	if (cli.presentThread) SDL_SetHint(SDL_HINT_VIDEO_X11_XINITTHREADS, "1");
+#endif
+
 	// Initialise SDL
 
 	bool sdlOk = false;
@@ -665,7 +1191,15 @@ int main(int argc, char *argv[]) {
 
 	// Play the opening cutscene, run the main menu, etc.
 
-	ret = play();
+	unsigned int startTicks = SDL_GetTicks();
+
+	if (cli.blitBenchmark) ret = benchmarkBlit();
+	else if (cli.fileBenchmark) ret = benchmarkLoading();
+	else ret = play();
+
+	if (headless)
+		LOG_INFO("Simulated %u steps in %u ms.", stepCount,
+			(unsigned int)(SDL_GetTicks() - startTicks));
 
 
 	// Save configuration and shut down
@@ -29,6 +29,7 @@
 #include "game/game.h"
 #include "game/gamemode.h"
 #include "io/controls.h"
+#include "io/file.h"
 #include "io/gfx/font.h"
 #include "io/gfx/video.h"
 #include "io/sound.h"
@@ -814,6 +815,9 @@ int GameMenu::joinGame () {
  */
 int GameMenu::newGame () {
 
+	// Pick up any episodes installed since the directories were last read
+	gamePaths.refresh();
+
 #if (defined USE_SOCKETS) || (defined USE_SDL_NET)
 	const char *newGameOptions[6] = {"new single player game", "new co-op game",
 		"new battle", "new team battle", "new race", "join game"};
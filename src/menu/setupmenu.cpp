@@ -386,8 +386,7 @@ int SetupMenu::setupVideo () {
 			scaleFactor--;
 	};
 	auto changeScaleMethod = [&] (bool isPositive) {
-		// TODO
-#if 0
+#if OJ_SDL2 && defined(SCALE)
 		if (isPositive && scaleMethod != scalerType::hqx)
 			scaleMethod = static_cast<scalerType>(+scaleMethod + 1);
 		else if(!isPositive && scaleMethod != scalerType::None)
@@ -35,6 +35,7 @@
 #include "level/levelplayer.h"
 
 #include "game/game.h"
+#include "game/replay.h"
 #include "io/controls.h"
 #include "util.h"
 
@@ -51,6 +52,8 @@ Player::Player () {
 	levelPlayerType = LT_JJ1;
 	name = NULL;
 
+	for (int i = 0; i < PCONTROLS; i++) pcontrols[i] = false;
+
 }
 
 
@@ -208,7 +211,8 @@ void Player::createLevelPlayer (LevelType levelType, Anim** anims,
 
 	}
 
-	for (int i = 0; i < PCONTROLS; i++) pcontrols[i] = false;
+	// Released through setControl(), so replays see the change
+	for (int i = 0; i < PCONTROLS; i++) setControl(i, false);
 
 }
 
@@ -302,6 +306,10 @@ JJ2LevelPlayer* Player::getJJ2LevelPlayer () {
  */
 void Player::setControl (int control, bool state) {
 
+	// Record changes to the local player's controls
+	if ((this == localPlayer) && (pcontrols[control] != state))
+		replay.storeControl(control, state);
+
 	pcontrols[control] = state;
 
 }
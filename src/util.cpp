@@ -45,6 +45,9 @@ bool fileExists (const char * fileName, int pathType) {
 
 	File *file;
 
+	// Look the file up without opening it, where possible
+	if (gamePaths.isIndexed(fileName, pathType)) return gamePaths.has(fileName, pathType);
+
 #ifdef VERBOSE
 	printf("Check: ");
 #endif